@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define DT_DRV_COMPAT zephyr_sensor_waveform
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/sensor.h>
+#include <zephyr/drivers/sensor/sensor_waveform.h>
+#include <zephyr/kernel.h>
+
+/* Must match the order of the waveform enum in the binding */
+enum sensor_waveform_type {
+	SENSOR_WAVEFORM_SINE,
+	SENSOR_WAVEFORM_STEP,
+	SENSOR_WAVEFORM_RAMP,
+	SENSOR_WAVEFORM_NOISE,
+};
+
+struct sensor_waveform_config {
+	enum sensor_waveform_type type;
+	uint32_t sample_rate;
+	uint32_t period_ms;
+	int32_t amplitude;
+	int32_t offset;
+	uint32_t fetch_latency_us;
+	uint32_t seed;
+};
+
+struct sensor_waveform_data {
+	const struct device *dev;
+	int64_t start;
+	uint32_t sample;
+	uint32_t fetch_count;
+	int64_t value;
+#ifdef CONFIG_SENSOR_WAVEFORM_TRIGGER
+	struct k_timer timer;
+	struct k_work work;
+	const struct sensor_trigger *trigger;
+	sensor_trigger_handler_t handler;
+#endif
+};
+
+/* First quarter of a sine wave, in Q15 */
+static const int16_t sensor_waveform_sin_table[65] = {
+	0,     804,   1608,  2410,  3212,  4011,  4808,  5602,  6393,  7179,  7962,  8739,  9512,
+	10278, 11039, 11793, 12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530, 18204, 18868,
+	19519, 20159, 20787, 21403, 22005, 22594, 23170, 23731, 24279, 24811, 25329, 25832, 26319,
+	26790, 27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956, 30273, 30571, 30852, 31113,
+	31356, 31580, 31785, 31971, 32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757, 32767,
+};
+
+/* sin(2 * pi * angle / 65536) in Q15, without any float operation */
+static int32_t sensor_waveform_sin(uint16_t angle)
+{
+	const int16_t *table = sensor_waveform_sin_table;
+	uint32_t idx = angle >> 8;
+	uint32_t i = idx & 63;
+	int32_t frac = angle & 0xff;
+	int32_t a, b;
+
+	switch (idx >> 6) {
+	case 0:
+		a = table[i];
+		b = table[i + 1];
+		break;
+	case 1:
+		a = table[64 - i];
+		b = table[63 - i];
+		break;
+	case 2:
+		a = -table[i];
+		b = -table[i + 1];
+		break;
+	default:
+		a = -table[64 - i];
+		b = -table[63 - i];
+		break;
+	}
+
+	return a + ((b - a) * frac) / 256;
+}
+
+static uint32_t sensor_waveform_hash(uint32_t x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352d;
+	x ^= x >> 15;
+	x *= 0x846ca68b;
+	x ^= x >> 16;
+
+	return x;
+}
+
+int64_t sensor_waveform_value(const struct device *dev, uint32_t sample)
+{
+	const struct sensor_waveform_config *config = dev->config;
+	uint64_t period = (uint64_t)config->period_ms * USEC_PER_MSEC;
+	uint64_t t = ((uint64_t)sample * USEC_PER_SEC / config->sample_rate) % period;
+	uint64_t range;
+	int64_t value;
+
+	switch (config->type) {
+	case SENSOR_WAVEFORM_SINE:
+		value = (int64_t)config->amplitude * sensor_waveform_sin(t * 65536 / period) / 32767;
+		break;
+	case SENSOR_WAVEFORM_STEP:
+		value = t < period / 2 ? 0 : config->amplitude;
+		break;
+	case SENSOR_WAVEFORM_RAMP:
+		value = (int64_t)config->amplitude * (int64_t)t / (int64_t)period;
+		break;
+	case SENSOR_WAVEFORM_NOISE:
+	default:
+		range = 2 * (uint64_t)config->amplitude + 1;
+		value = (int64_t)(sensor_waveform_hash(config->seed ^ sensor_waveform_hash(sample)) %
+				  range) -
+			config->amplitude;
+		break;
+	}
+
+	return config->offset + value;
+}
+
+static uint32_t sensor_waveform_current_sample(const struct device *dev)
+{
+	const struct sensor_waveform_config *config = dev->config;
+	struct sensor_waveform_data *data = dev->data;
+	uint64_t elapsed;
+
+	elapsed = k_ticks_to_us_floor64(k_uptime_ticks() - data->start);
+
+	return elapsed * config->sample_rate / USEC_PER_SEC;
+}
+
+#ifdef CONFIG_SENSOR_WAVEFORM_TRIGGER
+static void sensor_waveform_start_timer(const struct device *dev)
+{
+	const struct sensor_waveform_config *config = dev->config;
+	struct sensor_waveform_data *data = dev->data;
+	uint64_t period = USEC_PER_SEC / config->sample_rate;
+	uint64_t elapsed;
+
+	/* Align the trigger on the generation of the samples */
+	elapsed = k_ticks_to_us_floor64(k_uptime_ticks() - data->start);
+	k_timer_start(&data->timer, K_USEC(period - elapsed % period), K_USEC(period));
+}
+
+static void sensor_waveform_timer_expiry(struct k_timer *timer)
+{
+	struct sensor_waveform_data *data = CONTAINER_OF(timer, struct sensor_waveform_data, timer);
+
+	k_work_submit(&data->work);
+}
+
+static void sensor_waveform_work_handler(struct k_work *work)
+{
+	struct sensor_waveform_data *data = CONTAINER_OF(work, struct sensor_waveform_data, work);
+	sensor_trigger_handler_t handler = data->handler;
+
+	if (handler) {
+		handler(data->dev, data->trigger);
+	}
+}
+
+static int sensor_waveform_trigger_set(const struct device *dev,
+				       const struct sensor_trigger *trig,
+				       sensor_trigger_handler_t handler)
+{
+	struct sensor_waveform_data *data = dev->data;
+
+	if (trig->type != SENSOR_TRIG_DATA_READY) {
+		return -ENOTSUP;
+	}
+
+	data->trigger = trig;
+	data->handler = handler;
+
+	if (handler) {
+		sensor_waveform_start_timer(dev);
+	} else {
+		k_timer_stop(&data->timer);
+	}
+
+	return 0;
+}
+#endif /* CONFIG_SENSOR_WAVEFORM_TRIGGER */
+
+void sensor_waveform_reset(const struct device *dev)
+{
+	struct sensor_waveform_data *data = dev->data;
+
+	data->start = k_uptime_ticks();
+	data->sample = 0;
+	data->fetch_count = 0;
+	data->value = sensor_waveform_value(dev, 0);
+
+#ifdef CONFIG_SENSOR_WAVEFORM_TRIGGER
+	if (data->handler) {
+		sensor_waveform_start_timer(dev);
+	}
+#endif
+}
+
+uint32_t sensor_waveform_get_sample(const struct device *dev)
+{
+	struct sensor_waveform_data *data = dev->data;
+
+	return data->sample;
+}
+
+uint32_t sensor_waveform_get_fetch_count(const struct device *dev)
+{
+	struct sensor_waveform_data *data = dev->data;
+
+	return data->fetch_count;
+}
+
+static int sensor_waveform_sample_fetch(const struct device *dev, enum sensor_channel chan)
+{
+	const struct sensor_waveform_config *config = dev->config;
+	struct sensor_waveform_data *data = dev->data;
+
+	ARG_UNUSED(chan);
+
+	if (config->fetch_latency_us) {
+		k_busy_wait(config->fetch_latency_us);
+	}
+
+	data->sample = sensor_waveform_current_sample(dev);
+	data->value = sensor_waveform_value(dev, data->sample);
+	data->fetch_count++;
+
+	return 0;
+}
+
+static int sensor_waveform_channel_get(const struct device *dev, enum sensor_channel chan,
+				       struct sensor_value *val)
+{
+	struct sensor_waveform_data *data = dev->data;
+
+	/* The same signal is reported on every channel */
+	ARG_UNUSED(chan);
+
+	return sensor_value_from_micro(val, data->value);
+}
+
+static DEVICE_API(sensor, sensor_waveform_driver) = {
+	.sample_fetch = sensor_waveform_sample_fetch,
+	.channel_get = sensor_waveform_channel_get,
+#ifdef CONFIG_SENSOR_WAVEFORM_TRIGGER
+	.trigger_set = sensor_waveform_trigger_set,
+#endif
+};
+
+static int sensor_waveform_init(const struct device *dev)
+{
+	struct sensor_waveform_data *data = dev->data;
+
+	data->dev = dev;
+#ifdef CONFIG_SENSOR_WAVEFORM_TRIGGER
+	k_timer_init(&data->timer, sensor_waveform_timer_expiry, NULL);
+	k_work_init(&data->work, sensor_waveform_work_handler);
+#endif
+	sensor_waveform_reset(dev);
+
+	return 0;
+}
+
+#define DEFINE_SENSOR_WAVEFORM(_num)                                                               \
+	BUILD_ASSERT(DT_INST_PROP(_num, sample_rate) > 0, "sample-rate must be positive");         \
+	BUILD_ASSERT(DT_INST_PROP(_num, period_ms) > 0, "period-ms must be positive");             \
+                                                                                                   \
+	static const struct sensor_waveform_config sensor_waveform_config##_num = {                \
+		.type = DT_INST_ENUM_IDX(_num, waveform),                                          \
+		.sample_rate = DT_INST_PROP(_num, sample_rate),                                    \
+		.period_ms = DT_INST_PROP(_num, period_ms),                                        \
+		.amplitude = DT_INST_PROP(_num, amplitude),                                        \
+		.offset = DT_INST_PROP(_num, offset),                                              \
+		.fetch_latency_us = DT_INST_PROP(_num, fetch_latency_us),                          \
+		.seed = DT_INST_PROP(_num, seed),                                                  \
+	};                                                                                         \
+	static struct sensor_waveform_data sensor_waveform_data##_num;                             \
+	SENSOR_DEVICE_DT_INST_DEFINE(_num, sensor_waveform_init, NULL,                             \
+				     &sensor_waveform_data##_num, &sensor_waveform_config##_num,   \
+				     POST_KERNEL, CONFIG_SENSOR_INIT_PRIORITY,                     \
+				     &sensor_waveform_driver);
+
+DT_INST_FOREACH_STATUS_OKAY(DEFINE_SENSOR_WAVEFORM)
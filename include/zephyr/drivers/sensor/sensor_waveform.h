@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ZEPHYR_SENSOR_WAVEFORM_H
+#define ZEPHYR_SENSOR_WAVEFORM_H
+
+#include <stdint.h>
+
+#include <zephyr/device.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Restart the waveform: the next sample generated is the sample 0 */
+void sensor_waveform_reset(const struct device *dev);
+
+/* Index of the sample latched by the last sample_fetch */
+uint32_t sensor_waveform_get_sample(const struct device *dev);
+
+/* Number of sample_fetch calls since the last reset */
+uint32_t sensor_waveform_get_fetch_count(const struct device *dev);
+
+/* Value, in micro-units, of the given sample */
+int64_t sensor_waveform_value(const struct device *dev, uint32_t sample);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ZEPHYR_SENSOR_WAVEFORM_H */
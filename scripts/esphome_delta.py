@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+# Copyright (c) 2025 Alexandre Bailon
+# SPDX-License-Identifier: Apache-2.0
+
+"""Create an OTA delta image, see subsys/net/lib/esphome/components/ota/esphome_delta.h
+
+The blocks of the target found in the source are copied from the running
+image by the device, everything else is sent as is. Compress the patch with
+gzip when the device supports it, the copied regions are mostly zeros.
+"""
+
+import argparse
+import struct
+import zlib
+
+MAGIC = b"ZDLT"
+BLOCK = 16
+
+
+def find_matches(source, target):
+    index = {}
+    for offset in range(len(source) - BLOCK + 1):
+        index.setdefault(source[offset:offset + BLOCK], offset)
+
+    matches = []
+    pos = 0
+    while pos < len(target):
+        src = index.get(target[pos:pos + BLOCK])
+        if src is None:
+            pos += 1
+            continue
+
+        length = BLOCK
+        while (pos + length < len(target) and src + length < len(source)
+               and target[pos + length] == source[src + length]):
+            length += 1
+
+        matches.append((pos, src, length))
+        pos += length
+
+    return matches
+
+
+def create_patch(source, target):
+    patch = bytearray(MAGIC)
+    patch += struct.pack("<III", len(source), zlib.crc32(source), len(target))
+
+    matches = find_matches(source, target)
+    # The records start with the copied part, a first one only sends the extra
+    records = [(0, 0, 0)] + matches
+    for i, (pos, src, length) in enumerate(records):
+        if i + 1 < len(records):
+            extra_end, next_src = records[i + 1][0], records[i + 1][1]
+        else:
+            extra_end, next_src = len(target), src + length
+
+        extra = target[pos + length:extra_end]
+        if not length and not extra:
+            continue
+
+        patch += struct.pack("<IIi", length, len(extra), next_src - src - length)
+        patch += bytes(length)
+        patch += extra
+
+    return bytes(patch)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("source", help="image running on the device")
+    parser.add_argument("target", help="new image")
+    parser.add_argument("patch", help="delta image to create")
+    args = parser.parse_args()
+
+    with open(args.source, "rb") as f:
+        source = f.read()
+    with open(args.target, "rb") as f:
+        target = f.read()
+
+    patch = create_patch(source, target)
+    with open(args.patch, "wb") as f:
+        f.write(patch)
+
+    print(f"{len(target)} bytes image, {len(patch)} bytes patch, "
+          f"{len(zlib.compress(patch, 9))} bytes compressed")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,244 @@
+#!/usr/bin/env python3
+# Copyright (c) 2025 Alexandre Bailon
+# SPDX-License-Identifier: Apache-2.0
+
+"""Upload an image with the ESPHome OTA v2 protocol, see esphome_ota.c
+
+Besides the upload, the client reports the throughput and the latency of the
+CHUNK_OK acks, and can misbehave on purpose to test the device: short writes,
+slow sends, disconnections and corrupted payloads.
+"""
+
+import argparse
+import gzip
+import hashlib
+import random
+import socket
+import statistics
+import struct
+import time
+from dataclasses import dataclass, field
+
+MAGIC = bytes([0x6C, 0x26, 0xF7, 0x5C, 0x45])
+VERSION = 2
+BLOCK_SIZE = 8192
+
+RESPONSE_OK = 0x00
+RESPONSE_HEADER_OK = 0x40
+RESPONSE_AUTH_OK = 0x41
+RESPONSE_UPDATE_PREPARE_OK = 0x42
+RESPONSE_BIN_MD5_OK = 0x43
+RESPONSE_RECEIVE_OK = 0x44
+RESPONSE_UPDATE_END_OK = 0x45
+RESPONSE_SUPPORTS_COMPRESSION = 0x46
+RESPONSE_CHUNK_OK = 0x47
+RESPONSE_SUPPORTS_DELTA = 0x48
+RESPONSE_SUPPORTS_COMPRESSED_DELTA = 0x49
+RESPONSE_BIN_MD5_OK_RESUME = 0x4A
+RESPONSE_ERROR_MAGIC = 0x80
+RESPONSE_ERROR_WRITING_FLASH = 0x83
+RESPONSE_ERROR_MD5_MISMATCH = 0x8B
+
+FEATURE_SUPPORTS_COMPRESSION = 0x01
+FEATURE_SUPPORTS_RESUME = 0x40
+FEATURE_SUPPORTS_DELTA = 0x80
+
+# The resume is not part of the answer, the device reports it with the MD5 ack
+ACCEPTED_FEATURES = {
+    RESPONSE_HEADER_OK: 0,
+    RESPONSE_SUPPORTS_COMPRESSION: FEATURE_SUPPORTS_COMPRESSION,
+    RESPONSE_SUPPORTS_DELTA: FEATURE_SUPPORTS_DELTA,
+    RESPONSE_SUPPORTS_COMPRESSED_DELTA: FEATURE_SUPPORTS_COMPRESSION | FEATURE_SUPPORTS_DELTA,
+}
+
+
+class OtaError(Exception):
+    def __init__(self, message, code=None):
+        super().__init__(message if code is None else f"{message}: 0x{code:02x}")
+        self.code = code
+
+
+@dataclass
+class OtaStats:
+    size: int = 0
+    seconds: float = 0.0
+    # Between the last byte of a block and its CHUNK_OK, in seconds
+    ack_latencies: list = field(default_factory=list)
+
+    @property
+    def mb_per_s(self):
+        return self.size / self.seconds / 1e6 if self.seconds else 0.0
+
+    def summary(self):
+        lat = sorted(self.ack_latencies) or [0.0]
+        p95 = lat[min(len(lat) - 1, int(len(lat) * 0.95))]
+        return (f"{self.size} bytes in {self.seconds:.3f} s ({self.mb_per_s:.3f} MB/s), "
+                f"ack latency median {statistics.median(lat) * 1e3:.2f} ms, "
+                f"p95 {p95 * 1e3:.2f} ms, max {lat[-1] * 1e3:.2f} ms")
+
+
+@dataclass
+class OtaFaults:
+    # Send the data in random pieces of at most this many bytes
+    short_writes: int = 0
+    # Sleep between two blocks, and before reading each ack
+    send_delay: float = 0.0
+    ack_delay: float = 0.0
+    # Close the connection once this many bytes of the image are sent
+    disconnect_at: int = None
+    # Flip a bit of the image at this offset
+    corrupt_at: int = None
+
+
+class OtaClient:
+    def __init__(self, host, port=8266, timeout=30.0):
+        self.sock = socket.create_connection((host, port), timeout=timeout)
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+
+    def close(self):
+        self.sock.close()
+
+    def recv(self, size):
+        data = b""
+        while len(data) < size:
+            chunk = self.sock.recv(size - len(data))
+            if not chunk:
+                raise OtaError("connection closed by the device")
+            data += chunk
+        return data
+
+    def expect(self, expected, what):
+        code = self.recv(1)[0]
+        if code != expected:
+            raise OtaError(f"unexpected {what} response", code)
+        return code
+
+    def negotiate(self, features, magic=MAGIC):
+        """Returns the compression and delta features accepted by the device"""
+        self.sock.sendall(magic)
+        code = self.recv(1)[0]
+        if code != RESPONSE_OK:
+            raise OtaError("magic rejected", code)
+        version = self.recv(1)[0]
+        if version != VERSION:
+            raise OtaError(f"unsupported version {version}")
+
+        self.sock.sendall(bytes([features]))
+        code = self.recv(1)[0]
+        if code not in ACCEPTED_FEATURES:
+            raise OtaError("unexpected features response", code)
+        return ACCEPTED_FEATURES[code]
+
+    def handshake(self, size, md5, features=0, magic=MAGIC):
+        """Negotiate the upload, returns the offset to send the image from
+
+        The size and the MD5 are the ones of the data sent, the compressed
+        stream or the delta when the features request them.
+        """
+        required = features & (FEATURE_SUPPORTS_COMPRESSION | FEATURE_SUPPORTS_DELTA)
+        accepted = self.negotiate(features, magic)
+        if accepted != required:
+            raise OtaError(f"features 0x{required:02x} not supported, the device accepts "
+                           f"0x{accepted:02x}")
+        self.expect(RESPONSE_AUTH_OK, "auth")
+
+        self.sock.sendall(struct.pack(">I", size))
+        self.expect(RESPONSE_UPDATE_PREPARE_OK, "size")
+
+        self.sock.sendall(md5.encode())
+        code = self.recv(1)[0]
+        if code == RESPONSE_BIN_MD5_OK_RESUME:
+            return struct.unpack(">I", self.recv(4))[0]
+        if code != RESPONSE_BIN_MD5_OK:
+            raise OtaError("md5 rejected", code)
+        return 0
+
+    def send(self, data, faults):
+        if not faults.short_writes:
+            self.sock.sendall(data)
+            return
+        pos = 0
+        while pos < len(data):
+            n = random.randint(1, faults.short_writes)
+            self.sock.sendall(data[pos:pos + n])
+            pos += n
+
+    def send_image(self, image, offset=0, faults=None):
+        """Send the image from offset, block by block, waiting for each ack"""
+        faults = faults or OtaFaults()
+        if faults.corrupt_at is not None:
+            image = bytearray(image)
+            image[faults.corrupt_at] ^= 0x01
+
+        stats = OtaStats(size=len(image) - offset)
+        start = time.monotonic()
+        pos = offset
+        while pos < len(image):
+            end = min(pos + BLOCK_SIZE, len(image))
+            if faults.disconnect_at is not None and end > faults.disconnect_at:
+                self.send(image[pos:faults.disconnect_at], faults)
+                self.sock.close()
+                return stats
+            self.send(image[pos:end], faults)
+            sent = time.monotonic()
+            if faults.ack_delay:
+                time.sleep(faults.ack_delay)
+            self.expect(RESPONSE_CHUNK_OK, "chunk")
+            stats.ack_latencies.append(time.monotonic() - sent)
+            pos = end
+            if faults.send_delay:
+                time.sleep(faults.send_delay)
+
+        self.expect(RESPONSE_RECEIVE_OK, "receive")
+        stats.seconds = time.monotonic() - start
+        return stats
+
+    def finish(self, reboot=True):
+        """Without the final ack, the device keeps running the current image"""
+        self.expect(RESPONSE_UPDATE_END_OK, "update end")
+        if reboot:
+            self.sock.sendall(bytes([RESPONSE_OK]))
+
+    def upload(self, image, features=0, faults=None, reboot=True):
+        offset = self.handshake(len(image), hashlib.md5(image).hexdigest(), features)
+        stats = self.send_image(image, offset, faults)
+        self.finish(reboot)
+        return stats
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("host", help="address of the device")
+    parser.add_argument("image", help="image to upload")
+    parser.add_argument("--port", type=int, default=8266)
+    parser.add_argument("--resume", action="store_true",
+                        help="continue an interrupted upload of the same image")
+    parser.add_argument("--compress", action="store_true",
+                        help="send the image compressed with gzip")
+    parser.add_argument("--delta", action="store_true",
+                        help="the image is a patch created by esphome_delta.py")
+    args = parser.parse_args()
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+
+    features = 0
+    if args.resume:
+        features |= FEATURE_SUPPORTS_RESUME
+    if args.compress:
+        features |= FEATURE_SUPPORTS_COMPRESSION
+        image = gzip.compress(image, mtime=0)
+    if args.delta:
+        features |= FEATURE_SUPPORTS_DELTA
+
+    client = OtaClient(args.host, args.port)
+    try:
+        stats = client.upload(image, features)
+    finally:
+        client.close()
+
+    print(stats.summary())
+
+
+if __name__ == "__main__":
+    main()
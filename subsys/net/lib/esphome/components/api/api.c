@@ -85,18 +85,16 @@ int ListEntitiesRequestCb(const struct device *dev)
 int SwitchCommandRequestCb(const struct device *dev, SwitchCommandRequest *request)
 {
 	const struct device *switch_dev;
-	SwitchStateResponse response = SWITCH_STATE_RESPONSE__INIT;
+
+	ARG_UNUSED(dev);
 
 	switch_dev = find_device_entity_by_key(request->key);
 	if (!switch_dev) {
 		return -ENODEV;
 	}
 
-	esphome_switch_set_state(switch_dev, request->state);
-	esphome_switch_get_state(switch_dev, &response.state);
-	response.key = request->key;
-
-	return SwitchStateResponseWrite(dev, &response);
+	/* The driver reports the new state once the switch has reached it */
+	return esphome_switch_set_state(switch_dev, request->state);
 }
 #endif
 
@@ -110,7 +108,40 @@ int ButtonCommandRequestCb(const struct device *dev, ButtonCommandRequest *reque
 		return -ENODEV;
 	}
 
-	return esphome_button_on_press(button_dev);
+	/* on_press may do I/O, don't block the connection with it */
+	return esphome_button_press(button_dev);
+}
+#endif
+
+#ifdef CONFIG_ESPHOME_OTA_UPDATE
+int UpdateCommandRequestCb(const struct device *dev, UpdateCommandRequest *request)
+{
+	const struct device *update_dev;
+
+	ARG_UNUSED(dev);
+
+	update_dev = find_device_entity_by_key(request->key);
+	if (!update_dev) {
+		return -ENODEV;
+	}
+
+	return esphome_update_command(update_dev, request->command);
+}
+
+int ExecuteServiceRequestCb(const struct device *dev, ExecuteServiceRequest *request)
+{
+	int ret;
+
+	/* The upload of the image is the only service */
+	ret = esphome_update_execute_service(dev, request);
+	if (ret == -ENOENT) {
+		LOG_WRN("No service matching key %u", request->key);
+	} else if (ret) {
+		LOG_ERR("Service %u failed [%d]", request->key, ret);
+	}
+
+	/* A failed update is reported by its entity, keep the connection */
+	return 0;
 }
 #endif
 
@@ -122,11 +153,50 @@ int LightCommandRequestCb(const struct device *dev, LightCommandRequest *request
 	return -ENOTSUP;
 }
 
+bool esphome_api_is_subscribed(const struct device *api_dev)
+{
+	const struct esphome_data *data;
+
+	if (!api_dev) {
+		return false;
+	}
+
+	data = api_dev->data;
+	return data->subscribed;
+}
+
+static void esphome_api_subscribe(const struct device *dev)
+{
+	struct esphome_data *data = dev->data;
+
+	data->subscribed = true;
+}
+
 int SubscribeStatesRequestCb(const struct device *dev)
 {
-	ARG_UNUSED(dev);
+#ifdef CONFIG_ESPHOME_SENSOR_BUFFER
+	/* The states buffered while disconnected are sent before the live ones */
+	esphome_sensor_buffer_replay(dev, esphome_api_subscribe);
+#else
+	esphome_api_subscribe(dev);
+#endif
+	return esphome_entity_send_all(dev);
+}
 
-	return 0;
+void ConnectionClosedCb(const struct device *dev)
+{
+	struct esphome_data *data = dev->data;
+
+	data->subscribed = false;
+
+#ifdef CONFIG_ESPHOME_OTA_UPDATE
+	esphome_update_connection_closed(dev);
+#endif
+}
+
+int ConnectionWakeCb(const struct device *dev)
+{
+	return esphome_entity_flush(dev);
 }
 
 int SubscribeHomeassistantServicesRequestCb(const struct device *dev)
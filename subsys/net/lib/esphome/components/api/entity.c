@@ -7,9 +7,11 @@
 #include <errno.h>
 
 #include <zephyr/device.h>
+#include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 LOG_MODULE_DECLARE(ESPHome, CONFIG_ESPHOME_LOG_LEVEL);
 
+#include <esphome/components/api.h>
 #include <esphome/components/entity.h>
 
 uint32_t fnv1_hash(const char *str)
@@ -62,3 +64,91 @@ const struct device *find_device_entity_by_key(uint32_t key)
 	LOG_WRN("No device found matching key %d\n", key);
 	return NULL;
 }
+
+struct esphome_entity *find_entity_by_device(const struct device *dev)
+{
+	STRUCT_SECTION_FOREACH(esphome_entity, entity) {
+		if (entity->dev == dev) {
+			return entity;
+		}
+	}
+
+	return NULL;
+}
+
+/* The bit of the connection in the dirty flags of the entities */
+static int esphome_entity_api_index(const struct device *api_dev)
+{
+	const struct device *const *api_devs;
+	size_t count;
+
+	count = esphome_api_get_devices(&api_devs);
+	for (size_t i = 0; i < count; i++) {
+		if (api_devs[i] == api_dev) {
+			return i;
+		}
+	}
+
+	return -ENODEV;
+}
+
+int esphome_entity_flush(const struct device *api_dev)
+{
+	int index = esphome_entity_api_index(api_dev);
+	int ret;
+
+	if (index < 0) {
+		return index;
+	}
+
+	STRUCT_SECTION_FOREACH(esphome_entity, entity) {
+		if (!entity->send_state) {
+			continue;
+		}
+
+		if (!atomic_test_and_clear_bit(&entity->data->dirty, index) ||
+		    !esphome_api_is_subscribed(api_dev)) {
+			continue;
+		}
+
+		ret = entity->send_state(api_dev, entity);
+		if (ret) {
+			LOG_ERR("Failed to send the state of %s [%d]", entity->config->name, ret);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+void esphome_entity_state_changed(const struct esphome_entity *entity)
+{
+	const struct device *const *api_devs;
+	size_t count;
+
+	/* Every connection, the ones not subscribed are skipped by the flush */
+	atomic_set(&entity->data->dirty, ~(atomic_val_t)0);
+
+	/* A wake up already pending sends this state too */
+	count = esphome_api_get_devices(&api_devs);
+	for (size_t i = 0; i < count; i++) {
+		if (esphome_api_is_subscribed(api_devs[i])) {
+			esphome_api_wake(api_devs[i]);
+		}
+	}
+}
+
+int esphome_entity_send_all(const struct device *api_dev)
+{
+	int index = esphome_entity_api_index(api_dev);
+
+	if (index < 0) {
+		return index;
+	}
+
+	STRUCT_SECTION_FOREACH(esphome_entity, entity) {
+		atomic_set_bit(&entity->data->dirty, index);
+	}
+
+	return esphome_entity_flush(api_dev);
+}
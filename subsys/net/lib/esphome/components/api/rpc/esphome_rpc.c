@@ -16,6 +16,8 @@
 #include <zephyr/kernel.h>
 #include <zephyr/net/socket.h>
 
+#include <esphome/timing.h>
+
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(esphome_rpc, CONFIG_ESPHOME_RPC_LOG_LEVEL);
 
@@ -23,6 +25,8 @@ static int varint_encode(uint64_t val, uint8_t *out);
 static int esphome_header_size(uint32_t rpc_id, size_t len);
 static int esphome_encode_header(uint32_t rpc_id, size_t len, uint8_t *out);
 static int esphome_rpc_send(const struct device *dev, void *out, size_t len);
+static int esphome_handle_request(const struct device *dev, uint32_t msg_id, uint8_t *data,
+				  size_t len);
 static void *zephyr_alloc(void *allocator_data, size_t size);
 static void zephyr_free(void *allocator_data, void *pointer);
 
@@ -3017,6 +3021,18 @@ __weak int UpdateCommandRequestCb(const struct device *dev, UpdateCommandRequest
 	return -1;
 }
 
+__weak void ConnectionClosedCb(const struct device *dev)
+{
+	ARG_UNUSED(dev);
+}
+
+__weak int ConnectionWakeCb(const struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	return 0;
+}
+
 static int esphome_HelloRequestRead(const struct device *dev, uint8_t *data, size_t len)
 {
 	int ret;
@@ -7787,26 +7803,23 @@ static int varint_encode(uint64_t val, uint8_t *out)
 	return i;
 }
 
-static int read_decode_varint(int fd, uint64_t *value)
+/* Decode a varint of up to 32 bits, returns its size, or 0 if more bytes are needed */
+static int esphome_decode_varint(const uint8_t *buf, size_t len, uint32_t *value)
 {
-	uint64_t result = 0;
-	uint8_t bitpos = 0;
-	uint8_t val;
-	int ret;
+	uint32_t result = 0;
 
-	do {
-		ret = zsock_recv(fd, &val, 1, ZSOCK_MSG_WAITALL);
-		if (ret == 0) {
-			return -EOF;
-		}
-		if (bitpos >= 63 && (val & 0xFE) != 0) {
+	for (size_t i = 0; i < len; i++) {
+		if (i == 4 && (buf[i] & 0xF0)) {
 			return -EOVERFLOW;
 		}
-		result |= (uint64_t)(val & 0x7F) << (uint64_t)bitpos;
-		bitpos += 7;
-	} while (val & 0x80);
 
-	*value = result;
+		result |= (uint32_t)(buf[i] & 0x7F) << (7 * i);
+		if (!(buf[i] & 0x80)) {
+			*value = result;
+			return i + 1;
+		}
+	}
+
 	return 0;
 }
 
@@ -7833,76 +7846,168 @@ static int esphome_encode_header(uint32_t rpc_id, size_t len, uint8_t *out)
 static int esphome_rpc_send(const struct device *dev, void *out, size_t len)
 {
 	struct esphome_rpc_data *rpc_data = dev->data;
+	uint8_t *buf = out;
+	ssize_t sent;
+	int ret = 0;
 
-	zsock_send(rpc_data->socket, out, len, 0);
+	/* The messages of two threads must not interleave */
+	k_mutex_lock(&rpc_data->lock, K_FOREVER);
 
-	return 0;
+	while (len) {
+		if (rpc_data->socket < 0) {
+			ret = -ENOTCONN;
+			break;
+		}
+
+		sent = zsock_send(rpc_data->socket, buf, len, 0);
+		if (sent < 0) {
+			ret = -errno;
+			LOG_ERR("Failed to send message (%d)", ret);
+			break;
+		}
+
+		buf += sent;
+		len -= sent;
+	}
+
+	k_mutex_unlock(&rpc_data->lock);
+
+	return ret;
 }
 
-static int esphome_read_header(int fd, uint32_t *rpc_id, uint32_t *len)
+/* Returns 1 once the header received so far is complete */
+static int esphome_parse_header(struct esphome_rpc_data *rpc_data)
 {
-	uint64_t val;
-	uint8_t byte;
+	const uint8_t *header = rpc_data->header;
+	size_t len = rpc_data->header_len;
+	uint32_t body_len;
 	int ret;
 
-	do {
-		ret = zsock_recv(fd, &byte, 1, ZSOCK_MSG_WAITALL);
-	} while (ret == 0);
-
-	if (ret < 0) {
-		return ret;
-	}
-
-	if (byte != 0x00) {
+	if (header[0] != 0x00) {
 		return -EIO;
 	}
 
-	ret = read_decode_varint(fd, &val);
-	if (ret) {
+	ret = esphome_decode_varint(header + 1, len - 1, &body_len);
+	if (ret <= 0) {
 		return ret;
 	}
-	*len = (uint32_t)val;
 
-	ret = read_decode_varint(fd, &val);
-	if (ret) {
+	ret = esphome_decode_varint(header + 1 + ret, len - 1 - ret, &rpc_data->msg_id);
+	if (ret <= 0) {
 		return ret;
 	}
-	*rpc_id = (uint32_t)val;
 
-	return 0;
+	rpc_data->body_len = body_len;
+
+	return 1;
 }
 
-static int esphome_read_request(const struct device *dev)
+#ifdef CONFIG_ESPHOME_TIMING
+/* The highest message id handled by esphome_handle_request() */
+#define ESPHOME_RPC_MAX_MSG_ID 118
+
+#define ESPHOME_RPC_TIMING_NAME(i, _) "API message " STRINGIFY(i)
+
+/* The handlers are accounted per message id, each entry is the component of an id */
+static const char *const esphome_rpc_timing_names[] = {
+	LISTIFY(UTIL_INC(ESPHOME_RPC_MAX_MSG_ID), ESPHOME_RPC_TIMING_NAME, (,))};
+
+static void esphome_rpc_timing_end(uint32_t msg_id, uint32_t start)
+{
+	if (msg_id <= ESPHOME_RPC_MAX_MSG_ID) {
+		esphome_timing_end(&esphome_rpc_timing_names[msg_id],
+				   esphome_rpc_timing_names[msg_id], start);
+	}
+}
+#else
+static inline void esphome_rpc_timing_end(uint32_t msg_id, uint32_t start)
+{
+}
+#endif /* CONFIG_ESPHOME_TIMING */
+
+static void esphome_rx_reset(struct esphome_rpc_data *rpc_data)
+{
+	k_free(rpc_data->body);
+	rpc_data->body = NULL;
+	rpc_data->header_len = 0;
+	rpc_data->in_body = false;
+}
+
+static int esphome_handle_body(const struct device *dev)
 {
 	struct esphome_rpc_data *rpc_data = dev->data;
+	uint32_t start;
 	int ret;
-	uint32_t msg_id;
+
+	start = esphome_timing_start();
+	ret = esphome_handle_request(dev, rpc_data->msg_id, rpc_data->body, rpc_data->body_len);
+	esphome_rpc_timing_end(rpc_data->msg_id, start);
+
+	esphome_rx_reset(rpc_data);
+
+	return ret;
+}
+
+/* Takes the header byte by byte, not to read into the body of the message */
+static int esphome_read_available(const struct device *dev)
+{
+	struct esphome_rpc_data *rpc_data = dev->data;
+	uint8_t *buf;
 	size_t len;
-	uint8_t *data = NULL;
+	ssize_t ret;
 
-	LOG_DBG("Waiting for message");
-	ret = esphome_read_header(rpc_data->socket, &msg_id, &len);
-	if (ret) {
-		LOG_ERR("Failed to read message header");
-		return ret;
-	}
+	for (;;) {
+		if (rpc_data->in_body) {
+			buf = rpc_data->body + rpc_data->received;
+			len = rpc_data->body_len - rpc_data->received;
+		} else {
+			buf = rpc_data->header + rpc_data->header_len;
+			len = 1;
+		}
 
-	LOG_DBG("Reading message");
-	if (len) {
-		data = k_malloc(len);
-		if (!data) {
-			LOG_ERR("Failed to allocate message buffer");
-			return -ENOMEM;
+		/* One message at a time, the socket is still readable if there are more */
+		if (!len) {
+			return esphome_handle_body(dev);
 		}
 
-		/* TODO: loop until we receive all the data */
-		ret = zsock_recv(rpc_data->socket, data, len, ZSOCK_MSG_WAITALL);
-		if (ret != len) {
-			LOG_ERR("Failed to read message data");
-			return -EIO;
+		ret = zsock_recv(rpc_data->socket, buf, len, ZSOCK_MSG_DONTWAIT);
+		if (ret < 0) {
+			return errno == EAGAIN ? 0 : -errno;
+		}
+		if (ret == 0) {
+			return -ECONNRESET;
 		}
+
+		if (rpc_data->in_body) {
+			rpc_data->received += ret;
+			continue;
+		}
+
+		rpc_data->header_len++;
+		ret = esphome_parse_header(rpc_data);
+		if (ret < 0) {
+			LOG_ERR("Invalid message header");
+			return ret;
+		}
+		if (!ret) {
+			continue;
+		}
+
+		if (rpc_data->body_len) {
+			rpc_data->body = k_malloc(rpc_data->body_len);
+			if (!rpc_data->body) {
+				LOG_ERR("Failed to allocate message buffer");
+				return -ENOMEM;
+			}
+		}
+		rpc_data->in_body = true;
+		rpc_data->received = 0;
 	}
+}
 
+static int esphome_handle_request(const struct device *dev, uint32_t msg_id, uint8_t *data,
+				  size_t len)
+{
 	LOG_DBG("Handling message id %d", msg_id);
 	switch (msg_id) {
 
@@ -8394,16 +8499,12 @@ static int esphome_read_request(const struct device *dev)
 	return 0;
 }
 
-int esphome_rpc_service(void *arg1, void *arg2, void *arg3)
+int esphome_rpc_listen(int port)
 {
-	const struct device *dev = arg1;
-	struct esphome_rpc_data *rpc_data = dev->data;
-	int port = (int)arg2;
-
 	int opt;
 	socklen_t optlen = sizeof(int);
 	int server_fd, r, ret;
-	static struct sockaddr server_addr;
+	struct sockaddr server_addr = {0};
 	char addrstr[INET6_ADDRSTRLEN];
 
 	void *addrp;
@@ -8424,7 +8525,7 @@ int esphome_rpc_service(void *arg1, void *arg2, void *arg3)
 	r = zsock_socket(server_addr.sa_family, SOCK_STREAM, 0);
 	if (r == -1) {
 		LOG_DBG("socket() failed (%d)", errno);
-		return errno;
+		return -errno;
 	}
 
 	server_fd = r;
@@ -8449,7 +8550,7 @@ int esphome_rpc_service(void *arg1, void *arg2, void *arg3)
 	if (r == -1) {
 		LOG_DBG("bind() failed (%d)", errno);
 		zsock_close(server_fd);
-		return errno;
+		return -errno;
 	}
 
 	if (server_addr.sa_family == AF_INET6) {
@@ -8467,39 +8568,143 @@ int esphome_rpc_service(void *arg1, void *arg2, void *arg3)
 	if (r == -1) {
 		LOG_DBG("listen() failed (%d)", errno);
 		zsock_close(server_fd);
-		return errno;
+		return -errno;
 	}
 
 	LOG_INF("ESPHOME server waits for a connection on "
 		"port %d...\n",
 		port);
 
-	while (1) {
-		struct sockaddr_in6 client_addr;
-		socklen_t client_addr_len = sizeof(client_addr);
+	return server_fd;
+}
 
-		rpc_data->socket =
-			zsock_accept(server_fd, (struct sockaddr *)&client_addr, &client_addr_len);
-		if (rpc_data->socket == -1) {
-			LOG_DBG("accept() failed (%d)", errno);
-			continue;
+int esphome_rpc_accept(const struct device *dev, int server_fd)
+{
+	struct esphome_rpc_data *rpc_data = dev->data;
+	struct sockaddr_in6 client_addr;
+	socklen_t client_addr_len = sizeof(client_addr);
+	char addrstr[INET6_ADDRSTRLEN];
+	void *addrp;
+
+	rpc_data->socket = zsock_accept(server_fd, (struct sockaddr *)&client_addr,
+					&client_addr_len);
+	if (rpc_data->socket == -1) {
+		LOG_DBG("accept() failed (%d)", errno);
+		return -errno;
+	}
+
+	if (client_addr.sin6_family == AF_INET6) {
+		addrp = &client_addr.sin6_addr;
+	} else {
+		addrp = &net_sin((struct sockaddr *)&client_addr)->sin_addr;
+	}
+
+	zsock_inet_ntop(client_addr.sin6_family, addrp, addrstr, sizeof(addrstr));
+	LOG_DBG("accepted connection from [%s]", addrstr);
+
+	return rpc_data->socket;
+}
+
+int esphome_rpc_read(const struct device *dev)
+{
+	return esphome_read_available(dev);
+}
+
+void esphome_rpc_close(const struct device *dev)
+{
+	struct esphome_rpc_data *rpc_data = dev->data;
+
+	k_mutex_lock(&rpc_data->lock, K_FOREVER);
+	zsock_close(rpc_data->socket);
+	rpc_data->socket = -1;
+	k_mutex_unlock(&rpc_data->lock);
+	esphome_rx_reset(rpc_data);
+	ConnectionClosedCb(dev);
+	LOG_INF("Connection closed\n");
+}
+
+void esphome_rpc_init(const struct device *dev)
+{
+	struct esphome_rpc_data *rpc_data = dev->data;
+
+	rpc_data->socket = -1;
+	rpc_data->wake[0] = -1;
+	rpc_data->wake[1] = -1;
+	k_mutex_init(&rpc_data->lock);
+}
+
+void esphome_rpc_wake(const struct device *dev)
+{
+	struct esphome_rpc_data *rpc_data = dev->data;
+	uint8_t byte = 0;
+
+	if (rpc_data->wake[1] < 0) {
+		return;
+	}
+
+	/* A full socket pair means a wake up is already pending */
+	(void)zsock_send(rpc_data->wake[1], &byte, sizeof(byte), ZSOCK_MSG_DONTWAIT);
+}
+
+/* Wait for a message or a wake up, and return an error to close the connection */
+static int esphome_rpc_wait(const struct device *dev)
+{
+	struct esphome_rpc_data *rpc_data = dev->data;
+	struct zsock_pollfd fds[] = {
+		{.fd = rpc_data->socket, .events = ZSOCK_POLLIN},
+		{.fd = rpc_data->wake[0], .events = ZSOCK_POLLIN},
+	};
+	uint8_t buf[8];
+	int ret;
+
+	ret = zsock_poll(fds, ARRAY_SIZE(fds), -1);
+	if (ret < 0) {
+		return -errno;
+	}
+
+	if (fds[1].revents & ZSOCK_POLLIN) {
+		while (zsock_recv(fds[1].fd, buf, sizeof(buf), ZSOCK_MSG_DONTWAIT) > 0) {
 		}
 
-		zsock_inet_ntop(server_addr.sa_family, addrp, addrstr, sizeof(addrstr));
-		LOG_DBG("accepted connection from [%s]:%u", addrstr, ntohs(*portp));
+		ret = ConnectionWakeCb(dev);
+		if (ret) {
+			return ret;
+		}
+	}
 
-		while (1) {
-			ret = esphome_read_request(dev);
-			if (!ret) {
-				continue;
-			} else {
-				goto error;
-			}
+	if (fds[0].revents) {
+		return esphome_rpc_read(dev);
+	}
+
+	return 0;
+}
+
+int esphome_rpc_service(void *arg1, void *arg2, void *arg3)
+{
+	const struct device *dev = arg1;
+	struct esphome_rpc_data *rpc_data = dev->data;
+	int port = (int)arg2;
+	int server_fd;
+
+	if (zsock_socketpair(AF_UNIX, SOCK_STREAM, 0, rpc_data->wake) < 0) {
+		LOG_ERR("Failed to create the wake up socket pair (%d)", errno);
+		return -errno;
+	}
+
+	server_fd = esphome_rpc_listen(port);
+	if (server_fd < 0) {
+		return server_fd;
+	}
+
+	while (1) {
+		if (esphome_rpc_accept(dev, server_fd) < 0) {
+			continue;
+		}
+
+		while (!esphome_rpc_wait(dev)) {
 		}
 
-	error:
-		zsock_close(rpc_data->socket);
-		LOG_INF("Connection from %s closed\n", addrstr);
+		esphome_rpc_close(dev);
 	}
 
 	return 0;
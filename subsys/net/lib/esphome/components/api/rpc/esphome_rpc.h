@@ -12,13 +12,12 @@
 #include <stdlib.h>
 
 #include <zephyr/device.h>
+#include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 
-#include "api.pb-c.h"
+#include <esphome/esphome.h>
 
-struct esphome_rpc_data {
-	int socket;
-};
+#include "api.pb-c.h"
 
 extern ProtobufCAllocator esphome_pb_allocator;
 
@@ -429,6 +428,31 @@ int UpdateStateResponseWrite(const struct device *dev, UpdateStateResponse *msg)
 int UpdateCommandRequestCb(const struct device *dev, UpdateCommandRequest *msg);
 int UpdateCommandRequestWrite(const struct device *dev, UpdateCommandRequest *msg);
 
+/* Called once the client connection has been closed, whatever the reason */
+void ConnectionClosedCb(const struct device *dev);
+/*
+ * Called from the thread of the connection after esphome_rpc_wake(), an
+ * error closes the connection
+ */
+int ConnectionWakeCb(const struct device *dev);
+
+/* Initialize the data of an API device, before any other call */
+void esphome_rpc_init(const struct device *dev);
+/* Make esphome_rpc_service() call ConnectionWakeCb(), from any thread */
+void esphome_rpc_wake(const struct device *dev);
+
+/* Thread entry point serving the connections of an API device, one at a time */
 int esphome_rpc_service(void *arg1, void *arg2, void *arg3);
 
+/*
+ * The steps of esphome_rpc_service(), for the single loop mode. listen and
+ * accept return the socket, or a negative errno. read never blocks: it takes
+ * what the socket has of the current message and handles it once complete.
+ * It returns an error once the connection must be closed.
+ */
+int esphome_rpc_listen(int port);
+int esphome_rpc_accept(const struct device *dev, int server_fd);
+int esphome_rpc_read(const struct device *dev);
+void esphome_rpc_close(const struct device *dev);
+
 #endif /* __ZEPHYR_ESPHOME_CLIENT_RPC_H__ */
\ No newline at end of file
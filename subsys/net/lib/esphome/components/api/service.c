@@ -7,10 +7,13 @@
 #define DT_DRV_COMPAT nabucasa_esphome
 
 #include <zephyr/device.h>
+#include <zephyr/init.h>
 #include <zephyr/kernel.h>
 
 #include <esphome/components/entity.h>
 #include <esphome/esphome.h>
+#include <esphome/loop.h>
+#include <esphome/scheduler.h>
 #include <rpc/esphome_rpc.h>
 
 #include <zephyr/logging/log.h>
@@ -21,12 +24,96 @@ LOG_MODULE_REGISTER(ESPHome, CONFIG_ESPHOME_LOG_LEVEL);
 
 #define ESPHOME_SENSOR_STACK_SIZE (2048)
 
+BUILD_ASSERT(offsetof(struct esphome_data, rpc) == 0,
+	     "The RPC layer reads the data of the API devices as struct esphome_rpc_data");
+
 static int esphome_init(const struct device *dev)
 {
+	esphome_rpc_init(dev);
 	esphome_entity_init(dev);
 	return 0;
 }
 
+#ifdef CONFIG_ESPHOME_SINGLE_LOOP
+struct esphome_api_loop {
+	const struct device *dev;
+	int port;
+	/* Only one of them is polled, there is one connection at a time */
+	struct esphome_loop_fd server;
+	struct esphome_loop_fd client;
+};
+
+static void esphome_api_client_close(struct esphome_api_loop *loop)
+{
+	esphome_loop_remove(&loop->client);
+	esphome_rpc_close(loop->dev);
+	esphome_loop_add(&loop->server);
+}
+
+static void esphome_api_client_ready(struct esphome_loop_fd *lfd)
+{
+	struct esphome_api_loop *loop = CONTAINER_OF(lfd, struct esphome_api_loop, client);
+
+	if (esphome_rpc_read(loop->dev)) {
+		esphome_api_client_close(loop);
+	}
+}
+
+/* The loop is the thread of the connection, see esphome_api_wake() */
+static void esphome_api_wake_cb(void *user_data)
+{
+	struct esphome_api_loop *loop = user_data;
+	const struct esphome_data *data = loop->dev->data;
+
+	if (data->rpc.socket >= 0 && ConnectionWakeCb(loop->dev)) {
+		esphome_api_client_close(loop);
+	}
+}
+
+static void esphome_api_server_ready(struct esphome_loop_fd *lfd)
+{
+	struct esphome_api_loop *loop = CONTAINER_OF(lfd, struct esphome_api_loop, server);
+	int fd;
+
+	fd = esphome_rpc_accept(loop->dev, loop->server.fd);
+	if (fd < 0) {
+		return;
+	}
+
+	loop->client.fd = fd;
+	esphome_loop_remove(&loop->server);
+	esphome_loop_add(&loop->client);
+}
+
+static void esphome_api_listen(void *user_data)
+{
+	struct esphome_api_loop *loop = user_data;
+	int fd;
+
+	fd = esphome_rpc_listen(loop->port);
+	if (fd < 0) {
+		LOG_ERR("%s: failed to listen on port %d [%d]", loop->dev->name, loop->port, fd);
+		return;
+	}
+
+	loop->server.fd = fd;
+	esphome_loop_add(&loop->server);
+}
+
+#define ESPHOME_API_SERVICE(_num)                                                                  \
+	static struct esphome_api_loop esphome_api_loop_##_num = {                                 \
+		.dev = DEVICE_DT_INST_GET(_num),                                                   \
+		.port = DT_INST_PROP(_num, port),                                                  \
+		.server.ready = esphome_api_server_ready,                                          \
+		.client.ready = esphome_api_client_ready,                                          \
+	};
+#else
+#define ESPHOME_API_SERVICE(_num)                                                                  \
+	K_THREAD_DEFINE(esphome_tid_##_num, ESPHOME_STACK_SIZE, esphome_rpc_service,               \
+			DEVICE_DT_INST_GET(_num), DT_INST_PROP(_num, port), NULL,                  \
+			0 /* todo: set priority */, 0, 0);
+#endif /* CONFIG_ESPHOME_SINGLE_LOOP */
+
 #define DEFINE_ESPHOME(_num)                                                                       \
                                                                                                    \
 	static const struct esphome_config esphome_config_##_num = {                               \
@@ -44,9 +131,56 @@ static int esphome_init(const struct device *dev)
 	DEVICE_DT_INST_DEFINE(_num, esphome_init, NULL, &esphome_data_##_num,                      \
 			      &esphome_config_##_num, POST_KERNEL, CONFIG_ESPHOME_INIT_PRIORITY,   \
 			      NULL);                                                               \
-                                                                                                   \
-	K_THREAD_DEFINE(esphome_tid_##_num, ESPHOME_STACK_SIZE, esphome_rpc_service,               \
-			DEVICE_DT_INST_GET(_num), DT_INST_PROP(_num, port), NULL,                  \
-			0 /* todo: set priority */, 0, 0);
+	ESPHOME_API_SERVICE(_num)
 
 DT_INST_FOREACH_STATUS_OKAY(DEFINE_ESPHOME);
+
+#define ESPHOME_API_DEVICE(_num) DEVICE_DT_INST_GET(_num),
+
+static const struct device *const esphome_api_devs[] = {
+	DT_INST_FOREACH_STATUS_OKAY(ESPHOME_API_DEVICE)};
+
+BUILD_ASSERT(ARRAY_SIZE(esphome_api_devs) <= ATOMIC_BITS,
+	     "The entities track their state with one bit per API connection");
+
+size_t esphome_api_get_devices(const struct device *const **devs)
+{
+	*devs = esphome_api_devs;
+
+	return ARRAY_SIZE(esphome_api_devs);
+}
+
+#ifdef CONFIG_ESPHOME_SINGLE_LOOP
+#define ESPHOME_API_LOOP(_num) &esphome_api_loop_##_num,
+
+static struct esphome_api_loop *const esphome_api_loops[] = {
+	DT_INST_FOREACH_STATUS_OKAY(ESPHOME_API_LOOP)};
+
+void esphome_api_wake(const struct device *dev)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(esphome_api_loops); i++) {
+		if (esphome_api_loops[i]->dev == dev) {
+			esphome_set_timeout(esphome_api_loops[i], "wake", 0, esphome_api_wake_cb,
+					    esphome_api_loops[i]);
+		}
+	}
+}
+
+/* The sockets are created from the loop, once the network stack is up */
+static int esphome_api_loop_init(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(esphome_api_loops); i++) {
+		esphome_set_timeout(esphome_api_loops[i]->dev, "listen", 0, esphome_api_listen,
+				    esphome_api_loops[i]);
+	}
+
+	return 0;
+}
+
+SYS_INIT(esphome_api_loop_init, APPLICATION, CONFIG_ESPHOME_INIT_PRIORITY);
+#else
+void esphome_api_wake(const struct device *dev)
+{
+	esphome_rpc_wake(dev);
+}
+#endif /* CONFIG_ESPHOME_SINGLE_LOOP */
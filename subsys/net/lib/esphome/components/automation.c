@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define DT_DRV_COMPAT nabucasa_esphome_automation
+
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/iterable_sections.h>
+
+#include <esphome/automation.h>
+#ifdef CONFIG_ESPHOME_COMPONENT_BUTTON
+#include <esphome/components/button.h>
+#endif
+#ifdef CONFIG_ESPHOME_COMPONENT_SWITCH
+#include <esphome/components/switch.h>
+#endif
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(ESPHome, CONFIG_ESPHOME_LOG_LEVEL);
+
+static int esphome_action_run(const struct esphome_action *action)
+{
+	switch (action->type) {
+#ifdef CONFIG_ESPHOME_COMPONENT_SWITCH
+	case ESPHOME_ACTION_TURN_ON:
+		return esphome_switch_turn_on(action->target);
+	case ESPHOME_ACTION_TURN_OFF:
+		return esphome_switch_turn_off(action->target);
+	case ESPHOME_ACTION_TOGGLE:
+		return esphome_switch_toggle(action->target);
+#endif
+#ifdef CONFIG_ESPHOME_COMPONENT_BUTTON
+	case ESPHOME_ACTION_PRESS:
+		return esphome_button_press(action->target);
+#endif
+	default:
+		return -ENOTSUP;
+	}
+}
+
+static void esphome_automation_work(struct k_work *work)
+{
+	struct k_work_delayable *work_delayable = k_work_delayable_from_work(work);
+	struct esphome_automation *automation =
+		CONTAINER_OF(work_delayable, struct esphome_automation, work);
+	int ret;
+
+	while (automation->next < automation->num_actions) {
+		const struct esphome_action *action = &automation->actions[automation->next++];
+
+		if (action->type == ESPHOME_ACTION_DELAY) {
+			k_work_schedule(&automation->work, K_MSEC(action->delay));
+			return;
+		}
+
+		ret = esphome_action_run(action);
+		if (ret < 0) {
+			LOG_WRN("Action %zu failed on %s [%d]", automation->next - 1,
+				action->target ? action->target->name : "-", ret);
+		}
+	}
+
+	atomic_clear(&automation->running);
+}
+
+void esphome_automation_trigger(enum esphome_trigger trigger, const struct device *source)
+{
+	STRUCT_SECTION_FOREACH(esphome_automation, automation) {
+		if (automation->trigger != trigger ||
+		    (automation->source && automation->source != source)) {
+			continue;
+		}
+
+		if (!atomic_cas(&automation->running, 0, 1)) {
+			LOG_DBG("Automation already running, dropping the trigger");
+			continue;
+		}
+
+		automation->next = 0;
+		k_work_schedule(&automation->work, K_NO_WAIT);
+	}
+}
+
+static int esphome_automation_init(void)
+{
+	STRUCT_SECTION_FOREACH(esphome_automation, automation) {
+		k_work_init_delayable(&automation->work, esphome_automation_work);
+	}
+
+	return 0;
+}
+
+SYS_INIT(esphome_automation_init, POST_KERNEL, CONFIG_ESPHOME_INIT_PRIORITY);
+
+#define ESPHOME_ACTION_TARGET_IS(node_id, compat)                                                  \
+	COND_CODE_1(DT_NODE_HAS_PROP(node_id, target),                                             \
+		    (DT_NODE_HAS_COMPAT(DT_PHANDLE(node_id, target), compat)), (0))
+
+#define ESPHOME_ACTION_TARGET_IS_SWITCH(node_id)                                                   \
+	(ESPHOME_ACTION_TARGET_IS(node_id, nabucasa_esphome_switch_gpio) ||                        \
+	 ESPHOME_ACTION_TARGET_IS(node_id, nabucasa_esphome_switch_hbridge))
+
+/* The binding can't require the target for every action but delay, check it here */
+#define ESPHOME_ACTION_CHECK(node_id)                                                              \
+	BUILD_ASSERT(DT_ENUM_IDX(node_id, action) == ESPHOME_ACTION_DELAY ||                       \
+			     DT_NODE_HAS_PROP(node_id, target),                                    \
+		     DT_NODE_PATH(node_id) ": the action needs a target");                         \
+	BUILD_ASSERT(DT_ENUM_IDX(node_id, action) > ESPHOME_ACTION_TOGGLE ||                       \
+			     ESPHOME_ACTION_TARGET_IS_SWITCH(node_id),                             \
+		     DT_NODE_PATH(node_id) ": the target must be a switch");                       \
+	BUILD_ASSERT(DT_ENUM_IDX(node_id, action) != ESPHOME_ACTION_PRESS ||                       \
+			     ESPHOME_ACTION_TARGET_IS(node_id, nabucasa_esphome_button_template),  \
+		     DT_NODE_PATH(node_id) ": the target must be a button");
+
+#define ESPHOME_ACTION(node_id)                                                                    \
+	{                                                                                          \
+		.type = DT_ENUM_IDX(node_id, action),                                              \
+		.target = COND_CODE_1(DT_NODE_HAS_PROP(node_id, target),                           \
+				      (DEVICE_DT_GET(DT_PHANDLE(node_id, target))), (NULL)),       \
+		.delay = DT_PROP_OR(node_id, delay, 0),                                            \
+	},
+
+#define DEFINE_ESPHOME_AUTOMATION(_num)                                                            \
+                                                                                                   \
+	DT_INST_FOREACH_CHILD_STATUS_OKAY(_num, ESPHOME_ACTION_CHECK)                              \
+                                                                                                   \
+	static const struct esphome_action esphome_automation_actions_##_num[] = {                 \
+		DT_INST_FOREACH_CHILD_STATUS_OKAY(_num, ESPHOME_ACTION)};                          \
+                                                                                                   \
+	STRUCT_SECTION_ITERABLE(esphome_automation, esphome_automation_##_num) = {                 \
+		.trigger = DT_INST_ENUM_IDX(_num, trigger),                                        \
+		.source = COND_CODE_1(DT_INST_NODE_HAS_PROP(_num, source),                         \
+				      (DEVICE_DT_GET(DT_INST_PHANDLE(_num, source))), (NULL)),     \
+		.actions = esphome_automation_actions_##_num,                                      \
+		.num_actions = ARRAY_SIZE(esphome_automation_actions_##_num),                      \
+	};
+
+DT_INST_FOREACH_STATUS_OKAY(DEFINE_ESPHOME_AUTOMATION);
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/device.h>
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+
+#include <esphome/automation.h>
+#include <esphome/components/button.h>
+#include <esphome/timing.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(ESPHome, CONFIG_ESPHOME_LOG_LEVEL);
+
+K_MSGQ_DEFINE(esphome_button_presses, sizeof(const struct device *),
+	      CONFIG_ESPHOME_BUTTON_QUEUE_SIZE, sizeof(void *));
+
+static K_THREAD_STACK_DEFINE(esphome_button_stack, CONFIG_ESPHOME_BUTTON_WORKQ_STACK_SIZE);
+static struct k_work_q esphome_button_workq;
+
+static void esphome_button_run(const struct device *dev)
+{
+	struct esphome_button_data *data = dev->data;
+	k_spinlock_key_t key;
+	uint32_t start;
+	uint32_t elapsed;
+	int ret;
+
+	start = k_cycle_get_32();
+	ret = esphome_button_on_press(dev);
+	elapsed = k_cyc_to_us_ceil32(k_cycle_get_32() - start);
+	esphome_timing_end(dev, dev->name, start);
+
+	if (ret) {
+		LOG_WRN("%s: on_press failed [%d]", dev->name, ret);
+	}
+
+	esphome_automation_trigger(ESPHOME_TRIGGER_PRESS, dev);
+
+	key = k_spin_lock(&data->lock);
+	data->stats.count++;
+	data->stats.total_us += elapsed;
+	data->stats.max_us = MAX(data->stats.max_us, elapsed);
+	k_spin_unlock(&data->lock, key);
+}
+
+static void esphome_button_work_handler(struct k_work *work)
+{
+	const struct device *dev;
+
+	ARG_UNUSED(work);
+
+	while (!k_msgq_get(&esphome_button_presses, &dev, K_NO_WAIT)) {
+		esphome_button_run(dev);
+	}
+}
+
+static K_WORK_DEFINE(esphome_button_work, esphome_button_work_handler);
+
+int esphome_button_press(const struct device *dev)
+{
+	struct esphome_button_data *data = dev->data;
+	k_spinlock_key_t key;
+	int ret;
+
+	ret = k_msgq_put(&esphome_button_presses, &dev, K_NO_WAIT);
+	if (ret) {
+		LOG_WRN("%s: too many pending presses, dropping it", dev->name);
+		key = k_spin_lock(&data->lock);
+		data->stats.dropped++;
+		k_spin_unlock(&data->lock, key);
+		return -ENOMEM;
+	}
+
+	k_work_submit_to_queue(&esphome_button_workq, &esphome_button_work);
+
+	return 0;
+}
+
+void esphome_button_get_stats(const struct device *dev, struct esphome_button_stats *stats)
+{
+	struct esphome_button_data *data = dev->data;
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&data->lock);
+	*stats = data->stats;
+	k_spin_unlock(&data->lock, key);
+}
+
+static int esphome_button_workq_init(void)
+{
+	const struct k_work_queue_config config = {
+		.name = "esphome_button",
+	};
+
+	k_work_queue_start(&esphome_button_workq, esphome_button_stack,
+			   K_THREAD_STACK_SIZEOF(esphome_button_stack),
+			   CONFIG_ESPHOME_BUTTON_WORKQ_PRIORITY, &config);
+
+	return 0;
+}
+
+SYS_INIT(esphome_button_workq_init, POST_KERNEL, CONFIG_ESPHOME_INIT_PRIORITY);
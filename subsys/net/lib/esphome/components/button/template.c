@@ -18,12 +18,17 @@ LOG_MODULE_DECLARE(ESPHome, CONFIG_ESPHOME_LOG_LEVEL);
 
 #define DEFINE_ESPHOME_BUTTON(_num)                                                                \
                                                                                                    \
-	extern int DT_STRING_TOKEN(DT_DRV_INST(_num), on_press)(const struct device *dev);         \
+	IF_ENABLED(DT_INST_NODE_HAS_PROP(_num, on_press),                                          \
+		   (extern int DT_STRING_TOKEN(DT_DRV_INST(_num), on_press)(                       \
+			   const struct device *dev);))                                            \
 	static const struct esphome_button_config esphome_button_config_##_num = {                 \
-		.on_press = DT_STRING_TOKEN(DT_DRV_INST(_num), on_press),                          \
+		.on_press = COND_CODE_1(DT_INST_NODE_HAS_PROP(_num, on_press),                     \
+					(DT_STRING_TOKEN(DT_DRV_INST(_num), on_press)), (NULL)),   \
 	};                                                                                         \
+	static struct esphome_button_data esphome_button_data_##_num;                              \
                                                                                                    \
-	DEVICE_DT_INST_DEFINE(_num, NULL, NULL, NULL, &esphome_button_config_##_num, POST_KERNEL,  \
+	DEVICE_DT_INST_DEFINE(_num, NULL, NULL, &esphome_button_data_##_num,                       \
+			      &esphome_button_config_##_num, POST_KERNEL,                          \
 			      CONFIG_ESPHOME_INIT_PRIORITY, NULL);                                 \
 	DEFINE_ESPHOME_ENTITY(_num, esphome_button_template_##_num, "button",                      \
 			      esphome_button_list_entity);
@@ -1,6 +1,11 @@
 #include <zephyr/device.h>
+#include <zephyr/init.h>
 #include <zephyr/kernel.h>
 
+#include <esphome/automation.h>
+#include <esphome/scheduler.h>
+#include <esphome/timing.h>
+
 #define DT_DRV_COMPAT NABUCASA_ESPHOME
 #define ESPHOME_NODE  DT_PATH(esphome)
 
@@ -18,17 +23,34 @@
 DT_DEFINE_ACTION_FUNCTION(ESPHOME_NODE, on_boot);
 DT_DEFINE_ACTION_FUNCTION(ESPHOME_NODE, on_loop);
 DT_DEFINE_ACTION_FUNCTION(ESPHOME_NODE, on_shutdown);
-#include <stdio.h>
-int esphome_service(void *arg1, void *arg2, void *arg3)
+
+#define ESPHOME_LOOP_INTERVAL 1000
+
+/* The component of the on_boot and on_loop callbacks in the scheduler */
+static const char esphome_component[] = "esphome";
+
+static void esphome_loop(void *user_data)
+{
+	uint32_t start = esphome_timing_start();
+
+	on_loop(NULL);
+	esphome_timing_end(esphome_component, "on_loop", start);
+}
+
+static void esphome_boot(void *user_data)
 {
 	on_boot(NULL);
-	while (1) {
-		on_loop(NULL);
-		k_sleep(K_MSEC(1000));
-	};
+	esphome_automation_trigger(ESPHOME_TRIGGER_BOOT, NULL);
+	esphome_loop(NULL);
+
+	esphome_set_interval(esphome_component, "on_loop", ESPHOME_LOOP_INTERVAL, esphome_loop,
+			     NULL);
 }
 
-#define ESPHOME_STACK_SIZE (4096)
+/* Run from the scheduler thread, once all the devices are initialized */
+static int esphome_service_init(void)
+{
+	return esphome_set_timeout(esphome_component, "on_boot", 0, esphome_boot, NULL);
+}
 
-K_THREAD_DEFINE(esphome_tid, ESPHOME_STACK_SIZE, esphome_service, NULL, NULL, NULL,
-		0 /* todo: set priority */, 0, 0);
\ No newline at end of file
+SYS_INIT(esphome_service_init, APPLICATION, CONFIG_ESPHOME_INIT_PRIORITY);
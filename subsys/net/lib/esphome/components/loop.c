@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/socket.h>
+
+#include <esphome/loop.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(ESPHome, CONFIG_ESPHOME_LOG_LEVEL);
+
+static sys_slist_t esphome_loop_fds;
+
+/* Written to wake the loop up, read end first */
+static int esphome_loop_wake_fds[2] = {-1, -1};
+
+void esphome_loop_add(struct esphome_loop_fd *lfd)
+{
+	sys_slist_append(&esphome_loop_fds, &lfd->node);
+}
+
+void esphome_loop_remove(struct esphome_loop_fd *lfd)
+{
+	sys_slist_find_and_remove(&esphome_loop_fds, &lfd->node);
+}
+
+void esphome_loop_wake(void)
+{
+	uint8_t byte = 0;
+
+	if (esphome_loop_wake_fds[1] < 0) {
+		return;
+	}
+
+	/* A full socket pair means a wake up is already pending */
+	(void)zsock_send(esphome_loop_wake_fds[1], &byte, sizeof(byte), ZSOCK_MSG_DONTWAIT);
+}
+
+void esphome_loop_wait(int32_t timeout)
+{
+	struct zsock_pollfd fds[CONFIG_ESPHOME_SINGLE_LOOP_MAX_FDS + 1];
+	struct esphome_loop_fd *lfds[ARRAY_SIZE(fds)];
+	struct esphome_loop_fd *lfd;
+	uint8_t buf[8];
+	int count = 0;
+	int ret;
+
+	fds[count].fd = esphome_loop_wake_fds[0];
+	fds[count].events = ZSOCK_POLLIN;
+	lfds[count++] = NULL;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&esphome_loop_fds, lfd, node) {
+		if (count == ARRAY_SIZE(fds)) {
+			LOG_WRN("Too many sockets, increase CONFIG_ESPHOME_SINGLE_LOOP_MAX_FDS");
+			break;
+		}
+
+		fds[count].fd = lfd->fd;
+		fds[count].events = ZSOCK_POLLIN;
+		lfds[count++] = lfd;
+	}
+
+	ret = zsock_poll(fds, count, timeout);
+	if (ret <= 0) {
+		return;
+	}
+
+	if (fds[0].revents & ZSOCK_POLLIN) {
+		while (zsock_recv(fds[0].fd, buf, sizeof(buf), ZSOCK_MSG_DONTWAIT) > 0) {
+		}
+	}
+
+	for (int i = 1; i < count; i++) {
+		if (fds[i].revents) {
+			lfds[i]->ready(lfds[i]);
+		}
+	}
+}
+
+static int esphome_loop_init(void)
+{
+	int ret;
+
+	ret = zsock_socketpair(AF_UNIX, SOCK_STREAM, 0, esphome_loop_wake_fds);
+	if (ret < 0) {
+		LOG_ERR("Failed to create the wake up socket pair (%d)", errno);
+		return -errno;
+	}
+
+	return 0;
+}
+
+SYS_INIT(esphome_loop_init, APPLICATION, CONFIG_ESPHOME_INIT_PRIORITY);
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/sys/util.h>
+
+#include "esphome_delta.h"
+
+void esphome_delta_start(struct esphome_delta *delta)
+{
+	delta->state = ESPHOME_DELTA_HEADER;
+	delta->header_len = 0;
+	delta->source_offset = 0;
+	delta->written = 0;
+}
+
+/* The patch only applies to the image it was made from */
+static int delta_check_source(struct esphome_delta *delta, uint32_t crc)
+{
+	uint32_t computed = 0;
+	size_t len;
+	int ret;
+
+	if (delta->source_size > delta->source_area_size) {
+		return -EBADMSG;
+	}
+
+	for (size_t offset = 0; offset < delta->source_size; offset += len) {
+		len = MIN(sizeof(delta->buf), delta->source_size - offset);
+		ret = delta->read(delta->user_data, offset, delta->buf, len);
+		if (ret) {
+			return ret;
+		}
+		computed = crc32_ieee_update(computed, delta->buf, len);
+	}
+
+	return computed == crc ? 0 : -ESTALE;
+}
+
+static int delta_parse_header(struct esphome_delta *delta)
+{
+	if (memcmp(delta->header, ESPHOME_DELTA_MAGIC, 4)) {
+		return -EBADMSG;
+	}
+
+	delta->source_size = sys_get_le32(&delta->header[4]);
+	delta->target_size = sys_get_le32(&delta->header[12]);
+
+	return delta_check_source(delta, sys_get_le32(&delta->header[8]));
+}
+
+static int delta_parse_record(struct esphome_delta *delta)
+{
+	delta->diff_left = sys_get_le32(&delta->header[0]);
+	delta->extra_left = sys_get_le32(&delta->header[4]);
+	delta->adjust = (int32_t)sys_get_le32(&delta->header[8]);
+
+	if ((uint64_t)delta->diff_left + delta->extra_left > delta->target_size - delta->written) {
+		return -EBADMSG;
+	}
+
+	return 0;
+}
+
+static int delta_next(struct esphome_delta *delta)
+{
+	if (delta->diff_left) {
+		delta->state = ESPHOME_DELTA_DIFF;
+	} else if (delta->extra_left) {
+		delta->state = ESPHOME_DELTA_EXTRA;
+	} else {
+		/* Moving back before the start of the source would wrap the offset */
+		if (delta->adjust < 0 && -(int64_t)delta->adjust > delta->source_offset) {
+			return -EBADMSG;
+		}
+		delta->source_offset += delta->adjust;
+		if (delta->written == delta->target_size) {
+			delta->state = ESPHOME_DELTA_DONE;
+		} else {
+			delta->state = ESPHOME_DELTA_RECORD;
+		}
+	}
+
+	return 0;
+}
+
+/* Accumulate the header or a record, they may be split across writes */
+static size_t delta_fill_header(struct esphome_delta *delta, const uint8_t *data, size_t len,
+				size_t size)
+{
+	size_t n = MIN(len, size - delta->header_len);
+
+	memcpy(&delta->header[delta->header_len], data, n);
+	delta->header_len += n;
+
+	return n;
+}
+
+static int delta_diff(struct esphome_delta *delta, const uint8_t *data, size_t len)
+{
+	int ret;
+
+	if (delta->source_offset > delta->source_size ||
+	    len > delta->source_size - delta->source_offset) {
+		return -EBADMSG;
+	}
+
+	ret = delta->read(delta->user_data, delta->source_offset, delta->buf, len);
+	if (ret) {
+		return ret;
+	}
+
+	for (size_t i = 0; i < len; i++) {
+		delta->buf[i] += data[i];
+	}
+
+	return delta->write(delta->user_data, delta->buf, len);
+}
+
+int esphome_delta_write(struct esphome_delta *delta, const uint8_t *data, size_t len)
+{
+	size_t n;
+	int ret = 0;
+
+	while (len) {
+		switch (delta->state) {
+		case ESPHOME_DELTA_HEADER:
+			n = delta_fill_header(delta, data, len, ESPHOME_DELTA_HEADER_SIZE);
+			if (delta->header_len == ESPHOME_DELTA_HEADER_SIZE) {
+				delta->header_len = 0;
+				ret = delta_parse_header(delta);
+				delta->state = delta->target_size ? ESPHOME_DELTA_RECORD
+								  : ESPHOME_DELTA_DONE;
+			}
+			break;
+		case ESPHOME_DELTA_RECORD:
+			n = delta_fill_header(delta, data, len, ESPHOME_DELTA_RECORD_SIZE);
+			if (delta->header_len == ESPHOME_DELTA_RECORD_SIZE) {
+				delta->header_len = 0;
+				ret = delta_parse_record(delta);
+				if (!ret) {
+					ret = delta_next(delta);
+				}
+			}
+			break;
+		case ESPHOME_DELTA_DIFF:
+			n = MIN(MIN(len, delta->diff_left), sizeof(delta->buf));
+			ret = delta_diff(delta, data, n);
+			delta->source_offset += n;
+			delta->diff_left -= n;
+			delta->written += n;
+			if (!ret) {
+				ret = delta_next(delta);
+			}
+			break;
+		case ESPHOME_DELTA_EXTRA:
+			n = MIN(len, delta->extra_left);
+			ret = delta->write(delta->user_data, data, n);
+			delta->extra_left -= n;
+			delta->written += n;
+			if (!ret) {
+				ret = delta_next(delta);
+			}
+			break;
+		case ESPHOME_DELTA_DONE:
+		default:
+			/* Trailing data */
+			return -EBADMSG;
+		}
+
+		if (ret) {
+			return ret;
+		}
+
+		data += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+int esphome_delta_finish(struct esphome_delta *delta)
+{
+	return delta->state == ESPHOME_DELTA_DONE ? 0 : -EBADMSG;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ESPHOME_DELTA_H
+#define ESPHOME_DELTA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Delta images, applied against the running image as they are received.
+ *
+ * All the fields are little endian. The patch starts with a header:
+ *   magic "ZDLT", source size, CRC32 of the source, target size
+ * followed by bsdiff-like records, until the target size is reached:
+ *   diff length, extra length, adjust (signed)
+ *   diff length bytes, added to the source from the current source offset
+ *   extra length bytes, copied as is
+ * The source offset moves forward by the diff length, then by adjust.
+ */
+#define ESPHOME_DELTA_MAGIC       "ZDLT"
+#define ESPHOME_DELTA_HEADER_SIZE 16
+#define ESPHOME_DELTA_RECORD_SIZE 12
+
+enum esphome_delta_state {
+	ESPHOME_DELTA_HEADER,
+	ESPHOME_DELTA_RECORD,
+	ESPHOME_DELTA_DIFF,
+	ESPHOME_DELTA_EXTRA,
+	ESPHOME_DELTA_DONE,
+};
+
+struct esphome_delta {
+	/* Reads the source, i.e. the running image */
+	int (*read)(void *user_data, size_t offset, uint8_t *data, size_t len);
+	int (*write)(void *user_data, const uint8_t *data, size_t len);
+	void *user_data;
+	/* Size of the area holding the source */
+	size_t source_area_size;
+
+	/* Private */
+	enum esphome_delta_state state;
+	uint8_t header[ESPHOME_DELTA_HEADER_SIZE];
+	size_t header_len;
+	size_t source_size;
+	size_t source_offset;
+	size_t target_size;
+	size_t written;
+	size_t diff_left;
+	size_t extra_left;
+	int32_t adjust;
+	uint8_t buf[64];
+};
+
+void esphome_delta_start(struct esphome_delta *delta);
+
+/* Apply the next bytes of the patch */
+int esphome_delta_write(struct esphome_delta *delta, const uint8_t *data, size_t len);
+
+/* Returns -EBADMSG if the patch ended before the end of the target */
+int esphome_delta_finish(struct esphome_delta *delta);
+
+#endif /* ESPHOME_DELTA_H */
@@ -0,0 +1,580 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/sys/util.h>
+
+#include "esphome_inflate.h"
+
+#define GZIP_ID1     0x1f
+#define GZIP_ID2     0x8b
+#define GZIP_DEFLATE 8
+
+#define GZIP_FHCRC    BIT(1)
+#define GZIP_FEXTRA   BIT(2)
+#define GZIP_FNAME    BIT(3)
+#define GZIP_FCOMMENT BIT(4)
+
+#define INFLATE_MAX_BITS     15
+#define INFLATE_MAX_LCODES   286
+#define INFLATE_MAX_DCODES   30
+#define INFLATE_FIXED_LCODES 288
+
+enum inflate_block_type {
+	INFLATE_STORED,
+	INFLATE_FIXED,
+	INFLATE_DYNAMIC,
+};
+
+static const uint16_t inflate_length_base[] = {
+	3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+	31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+};
+
+static const uint8_t inflate_length_extra[] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+
+static const uint16_t inflate_dist_base[] = {
+	1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+	193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+};
+
+static const uint8_t inflate_dist_extra[] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+	6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+};
+
+/* Order of the code length code lengths */
+static const uint8_t inflate_clen_order[] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15,
+};
+
+static int inflate_byte(struct esphome_inflate *inf)
+{
+	int ret;
+
+	if (!inf->in_len) {
+		ret = inf->fill(inf->user_data, &inf->in, &inf->in_len);
+		if (ret) {
+			return ret;
+		}
+
+		/* The stream ended before the end of the data */
+		if (!inf->in_len) {
+			return -EBADMSG;
+		}
+	}
+
+	inf->in_len--;
+
+	return *inf->in++;
+}
+
+/* Returns n bits, up to 16, least significant bit first */
+static int inflate_bits(struct esphome_inflate *inf, uint8_t n)
+{
+	int val;
+
+	while (inf->nbits < n) {
+		val = inflate_byte(inf);
+		if (val < 0) {
+			return val;
+		}
+
+		inf->bits |= (uint32_t)val << inf->nbits;
+		inf->nbits += 8;
+	}
+
+	val = inf->bits & BIT_MASK(n);
+	inf->bits >>= n;
+	inf->nbits -= n;
+
+	return val;
+}
+
+/* The gzip header and trailer, and the stored blocks, start on a byte */
+static void inflate_align(struct esphome_inflate *inf)
+{
+	inf->bits = 0;
+	inf->nbits = 0;
+}
+
+static int inflate_flush(struct esphome_inflate *inf)
+{
+	size_t len = inf->pos - inf->flushed;
+	int ret;
+
+	if (!len) {
+		return 0;
+	}
+
+	/* Only flushed when the window wraps, so the data always starts at 0 */
+	inf->crc = crc32_ieee_update(inf->crc, inf->window, len);
+	ret = inf->flush(inf->user_data, inf->window, len);
+	inf->flushed = inf->pos;
+
+	return ret;
+}
+
+static int inflate_put(struct esphome_inflate *inf, uint8_t c)
+{
+	inf->window[inf->pos & (inf->window_size - 1)] = c;
+	inf->pos++;
+
+	if (!(inf->pos & (inf->window_size - 1))) {
+		return inflate_flush(inf);
+	}
+
+	return 0;
+}
+
+static int inflate_build(struct esphome_inflate_huffman *h, const uint8_t *lengths, size_t n)
+{
+	uint16_t offs[INFLATE_MAX_BITS + 1];
+	int left = 1;
+
+	memset(h->count, 0, sizeof(h->count));
+	for (size_t sym = 0; sym < n; sym++) {
+		h->count[lengths[sym]]++;
+	}
+	h->count[0] = 0;
+
+	for (size_t len = 1; len <= INFLATE_MAX_BITS; len++) {
+		left <<= 1;
+		left -= h->count[len];
+		if (left < 0) {
+			/* Over-subscribed */
+			return -EBADMSG;
+		}
+	}
+
+	offs[1] = 0;
+	for (size_t len = 1; len < INFLATE_MAX_BITS; len++) {
+		offs[len + 1] = offs[len] + h->count[len];
+	}
+
+	for (size_t sym = 0; sym < n; sym++) {
+		if (lengths[sym]) {
+			h->symbol[offs[lengths[sym]]++] = sym;
+		}
+	}
+
+	return 0;
+}
+
+/* Canonical codes, decoded a bit at a time */
+static int inflate_decode(struct esphome_inflate *inf, const struct esphome_inflate_huffman *h)
+{
+	int code = 0;
+	int first = 0;
+	int index = 0;
+	int bit;
+
+	for (size_t len = 1; len <= INFLATE_MAX_BITS; len++) {
+		bit = inflate_bits(inf, 1);
+		if (bit < 0) {
+			return bit;
+		}
+
+		code |= bit;
+		if (code - h->count[len] < first) {
+			return h->symbol[index + (code - first)];
+		}
+
+		index += h->count[len];
+		first += h->count[len];
+		first <<= 1;
+		code <<= 1;
+	}
+
+	return -EBADMSG;
+}
+
+static int inflate_stored(struct esphome_inflate *inf)
+{
+	uint8_t header[4];
+	uint16_t len;
+	int val;
+	int ret;
+
+	inflate_align(inf);
+
+	for (size_t i = 0; i < sizeof(header); i++) {
+		val = inflate_byte(inf);
+		if (val < 0) {
+			return val;
+		}
+		header[i] = val;
+	}
+
+	len = sys_get_le16(&header[0]);
+	if (len != (uint16_t)~sys_get_le16(&header[2])) {
+		return -EBADMSG;
+	}
+
+	while (len--) {
+		val = inflate_byte(inf);
+		if (val < 0) {
+			return val;
+		}
+
+		ret = inflate_put(inf, val);
+		if (ret) {
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+static int inflate_codes(struct esphome_inflate *inf)
+{
+	size_t mask = inf->window_size - 1;
+	int sym;
+	int len;
+	int dist;
+	int extra;
+	int ret;
+
+	while (1) {
+		sym = inflate_decode(inf, &inf->lencode);
+		if (sym < 0) {
+			return sym;
+		}
+
+		if (sym < 256) {
+			ret = inflate_put(inf, sym);
+			if (ret) {
+				return ret;
+			}
+			continue;
+		}
+
+		if (sym == 256) {
+			return 0;
+		}
+
+		sym -= 257;
+		if (sym >= ARRAY_SIZE(inflate_length_base)) {
+			return -EBADMSG;
+		}
+
+		extra = inflate_bits(inf, inflate_length_extra[sym]);
+		if (extra < 0) {
+			return extra;
+		}
+		len = inflate_length_base[sym] + extra;
+
+		sym = inflate_decode(inf, &inf->distcode);
+		if (sym < 0) {
+			return sym;
+		}
+		if (sym >= ARRAY_SIZE(inflate_dist_base)) {
+			return -EBADMSG;
+		}
+
+		extra = inflate_bits(inf, inflate_dist_extra[sym]);
+		if (extra < 0) {
+			return extra;
+		}
+		dist = inflate_dist_base[sym] + extra;
+
+		if (dist > inf->pos || dist > inf->window_size) {
+			/* Before the start, or further back than the window */
+			return -EBADMSG;
+		}
+
+		while (len--) {
+			ret = inflate_put(inf, inf->window[(inf->pos - dist) & mask]);
+			if (ret) {
+				return ret;
+			}
+		}
+	}
+}
+
+static int inflate_fixed(struct esphome_inflate *inf)
+{
+	uint8_t lengths[INFLATE_FIXED_LCODES];
+	size_t sym;
+
+	for (sym = 0; sym < 144; sym++) {
+		lengths[sym] = 8;
+	}
+	for (; sym < 256; sym++) {
+		lengths[sym] = 9;
+	}
+	for (; sym < 280; sym++) {
+		lengths[sym] = 7;
+	}
+	for (; sym < INFLATE_FIXED_LCODES; sym++) {
+		lengths[sym] = 8;
+	}
+	inflate_build(&inf->lencode, lengths, INFLATE_FIXED_LCODES);
+
+	memset(lengths, 5, INFLATE_MAX_DCODES);
+	inflate_build(&inf->distcode, lengths, INFLATE_MAX_DCODES);
+
+	return inflate_codes(inf);
+}
+
+static int inflate_dynamic(struct esphome_inflate *inf)
+{
+	uint8_t lengths[INFLATE_MAX_LCODES + INFLATE_MAX_DCODES];
+	int nlen, ndist, ncode;
+	size_t index;
+	int sym;
+	int len;
+	int rep;
+	int ret;
+
+	nlen = inflate_bits(inf, 5);
+	ndist = inflate_bits(inf, 5);
+	ncode = inflate_bits(inf, 4);
+	if (nlen < 0 || ndist < 0 || ncode < 0) {
+		return -EBADMSG;
+	}
+
+	nlen += 257;
+	ndist += 1;
+	ncode += 4;
+	if (nlen > INFLATE_MAX_LCODES || ndist > INFLATE_MAX_DCODES) {
+		return -EBADMSG;
+	}
+
+	memset(lengths, 0, sizeof(inflate_clen_order));
+	for (index = 0; index < ncode; index++) {
+		len = inflate_bits(inf, 3);
+		if (len < 0) {
+			return len;
+		}
+		lengths[inflate_clen_order[index]] = len;
+	}
+
+	/* The distance code is only built afterwards, use it for the code lengths */
+	ret = inflate_build(&inf->distcode, lengths, ARRAY_SIZE(inflate_clen_order));
+	if (ret) {
+		return ret;
+	}
+
+	index = 0;
+	while (index < nlen + ndist) {
+		sym = inflate_decode(inf, &inf->distcode);
+		if (sym < 0) {
+			return sym;
+		}
+
+		if (sym < 16) {
+			lengths[index++] = sym;
+			continue;
+		}
+
+		len = 0;
+		if (sym == 16) {
+			if (!index) {
+				return -EBADMSG;
+			}
+			len = lengths[index - 1];
+			rep = inflate_bits(inf, 2);
+			rep = rep < 0 ? rep : rep + 3;
+		} else if (sym == 17) {
+			rep = inflate_bits(inf, 3);
+			rep = rep < 0 ? rep : rep + 3;
+		} else {
+			rep = inflate_bits(inf, 7);
+			rep = rep < 0 ? rep : rep + 11;
+		}
+
+		if (rep < 0) {
+			return rep;
+		}
+		if (index + rep > nlen + ndist) {
+			return -EBADMSG;
+		}
+
+		memset(&lengths[index], len, rep);
+		index += rep;
+	}
+
+	/* The end of block code is required */
+	if (!lengths[256]) {
+		return -EBADMSG;
+	}
+
+	ret = inflate_build(&inf->lencode, lengths, nlen);
+	if (ret) {
+		return ret;
+	}
+
+	ret = inflate_build(&inf->distcode, &lengths[nlen], ndist);
+	if (ret) {
+		return ret;
+	}
+
+	return inflate_codes(inf);
+}
+
+static int inflate_skip_string(struct esphome_inflate *inf)
+{
+	int val;
+
+	do {
+		val = inflate_byte(inf);
+	} while (val > 0);
+
+	return val;
+}
+
+static int inflate_header(struct esphome_inflate *inf)
+{
+	uint8_t header[10];
+	int val;
+	int len;
+
+	for (size_t i = 0; i < sizeof(header); i++) {
+		val = inflate_byte(inf);
+		if (val < 0) {
+			return val;
+		}
+		header[i] = val;
+	}
+
+	if (header[0] != GZIP_ID1 || header[1] != GZIP_ID2 || header[2] != GZIP_DEFLATE) {
+		return -EBADMSG;
+	}
+
+	if (header[3] & GZIP_FEXTRA) {
+		len = inflate_bits(inf, 16);
+		if (len < 0) {
+			return len;
+		}
+
+		while (len--) {
+			val = inflate_byte(inf);
+			if (val < 0) {
+				return val;
+			}
+		}
+	}
+
+	if (header[3] & GZIP_FNAME) {
+		val = inflate_skip_string(inf);
+		if (val < 0) {
+			return val;
+		}
+	}
+
+	if (header[3] & GZIP_FCOMMENT) {
+		val = inflate_skip_string(inf);
+		if (val < 0) {
+			return val;
+		}
+	}
+
+	if (header[3] & GZIP_FHCRC) {
+		val = inflate_bits(inf, 16);
+		if (val < 0) {
+			return val;
+		}
+	}
+
+	return 0;
+}
+
+static int inflate_trailer(struct esphome_inflate *inf)
+{
+	uint8_t trailer[8];
+	int val;
+
+	inflate_align(inf);
+
+	for (size_t i = 0; i < sizeof(trailer); i++) {
+		val = inflate_byte(inf);
+		if (val < 0) {
+			return val;
+		}
+		trailer[i] = val;
+	}
+
+	if (sys_get_le32(&trailer[0]) != inf->crc ||
+	    sys_get_le32(&trailer[4]) != (uint32_t)inf->pos) {
+		return -EBADMSG;
+	}
+
+	return 0;
+}
+
+ssize_t esphome_inflate_gzip(struct esphome_inflate *inf)
+{
+	int last;
+	int type;
+	int ret;
+
+	if (!inf->window_size || !IS_POWER_OF_TWO(inf->window_size)) {
+		return -EINVAL;
+	}
+
+	inf->in = NULL;
+	inf->in_len = 0;
+	inf->pos = 0;
+	inf->flushed = 0;
+	inf->crc = 0;
+	inflate_align(inf);
+
+	ret = inflate_header(inf);
+	if (ret) {
+		return ret;
+	}
+
+	do {
+		last = inflate_bits(inf, 1);
+		if (last < 0) {
+			return last;
+		}
+
+		type = inflate_bits(inf, 2);
+		if (type < 0) {
+			return type;
+		}
+
+		switch (type) {
+		case INFLATE_STORED:
+			ret = inflate_stored(inf);
+			break;
+		case INFLATE_FIXED:
+			ret = inflate_fixed(inf);
+			break;
+		case INFLATE_DYNAMIC:
+			ret = inflate_dynamic(inf);
+			break;
+		default:
+			ret = -EBADMSG;
+			break;
+		}
+
+		if (ret) {
+			return ret;
+		}
+	} while (!last);
+
+	ret = inflate_flush(inf);
+	if (ret) {
+		return ret;
+	}
+
+	ret = inflate_trailer(inf);
+	if (ret) {
+		return ret;
+	}
+
+	return inf->pos;
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ESPHOME_INFLATE_H
+#define ESPHOME_INFLATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct esphome_inflate_huffman {
+	/* Number of codes of each length */
+	uint16_t count[16];
+	/* Symbols ordered by code */
+	uint16_t symbol[288];
+};
+
+/*
+ * Streaming gzip decompression. The compressed data is pulled through fill(),
+ * and the decompressed data is pushed to flush() each time the window is full,
+ * so only the window is kept in RAM.
+ */
+struct esphome_inflate {
+	/* Provides the next chunk of compressed data, len is 0 at the end */
+	int (*fill)(void *user_data, const uint8_t **data, size_t *len);
+	int (*flush)(void *user_data, const uint8_t *data, size_t len);
+	void *user_data;
+	/*
+	 * History of the back references, its size must be a power of two.
+	 * Streams referencing further back than its size are rejected, which
+	 * requires 32 KB for the streams compressed with the default settings.
+	 */
+	uint8_t *window;
+	size_t window_size;
+
+	/* Private */
+	const uint8_t *in;
+	size_t in_len;
+	uint32_t bits;
+	uint8_t nbits;
+	size_t pos;
+	size_t flushed;
+	uint32_t crc;
+	struct esphome_inflate_huffman lencode;
+	struct esphome_inflate_huffman distcode;
+};
+
+/*
+ * Decompress a whole gzip stream and check its CRC and size.
+ * Returns the decompressed size or a negative error code.
+ */
+ssize_t esphome_inflate_gzip(struct esphome_inflate *inf);
+
+#endif /* ESPHOME_INFLATE_H */
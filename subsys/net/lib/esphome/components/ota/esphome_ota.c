@@ -1,49 +1,833 @@
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
 #include <zephyr/dfu/mcuboot.h>
+#include <zephyr/init.h>
 
 #include <zephyr/net/net_ip.h>
 #include <zephyr/net/socket.h>
 
 #include <zephyr/dfu/flash_img.h>
+#include <zephyr/drivers/flash.h>
 #include <zephyr/storage/flash_map.h>
 
+#include <zephyr/settings/settings.h>
 #include <zephyr/sys/reboot.h>
 
+#ifdef CONFIG_ESPHOME_OTA_ERASE_AHEAD
+#include <bootutil/bootutil_public.h>
+#endif
+
+#ifdef CONFIG_ESPHOME_OTA_MD5
+#include <mbedtls/md5.h>
+#endif
+
+#include <esphome/loop.h>
+#include <esphome/scheduler.h>
+
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(ESPHomeOTA);
 
+#include "esphome_delta.h"
+#include "esphome_inflate.h"
 #include "esphome_ota.h"
 
 #define USE_OTA_VERSION 2
 #define OTA_BLOCK_SIZE  8192
 
-int esphome_ota_read_magic(int socket)
+struct esphome_ota_buffer {
+	/* Reserved for the fifos */
+	void *fifo_reserved;
+	size_t len;
+	uint8_t data[CONFIG_ESPHOME_OTA_BUFFER_SIZE];
+};
+
+/*
+ * The data is received into a pool of buffers that are written to the flash
+ * from a work queue, so the next buffer can be received while the flash is
+ * being erased and programmed. The work runs for the whole update, consuming
+ * the buffers as they are received.
+ */
+struct esphome_ota_writer {
+	struct flash_img_context *ctx;
+	/* Buffers available to receive */
+	struct k_fifo free;
+	/* Buffers waiting to be written, in order, and an empty one at the end */
+	struct k_fifo filled;
+	struct k_work work;
+	/* Buffer being consumed by the work */
+	struct esphome_ota_buffer *current;
+	bool ended;
+	/* OTA_FEATURE_* agreed with the client */
+	uint8_t features;
+	size_t received;
+	size_t written;
+	/* Offset in the upload slot up to which it is erased */
+	size_t erased;
+	/* Time spent per phase, in cycles */
+	uint64_t erase_cycles;
+	uint64_t program_cycles;
+	uint64_t wait_cycles;
+#ifdef CONFIG_ESPHOME_OTA_RESUME
+	/* Identify the image in the resume record */
+	const char *image_md5;
+	size_t image_size;
+	/* Offset the update was resumed at, and the last one saved */
+	size_t base;
+	size_t saved;
+#endif
+	/* First error returned by the flash, the next buffers are dropped */
+	int error;
+#ifdef CONFIG_ESPHOME_OTA_MD5
+	/* Hash of the received data, updated as it is written */
+	mbedtls_md5_context md5;
+	uint64_t md5_cycles;
+#endif
+#ifdef CONFIG_ESPHOME_OTA_COMPRESSION
+	struct esphome_inflate inflate;
+#endif
+#ifdef CONFIG_ESPHOME_OTA_DELTA
+	/* The running image, the source of the delta updates */
+	const struct flash_area *source;
+	struct esphome_delta delta;
+#endif
+};
+
+static struct esphome_ota_buffer esphome_ota_buffers[CONFIG_ESPHOME_OTA_BUFFERS];
+static struct esphome_ota_writer esphome_ota_writer;
+/* Set while an update is received, from the OTA server or another transport */
+static atomic_t esphome_ota_busy;
+
+static K_THREAD_STACK_DEFINE(esphome_ota_writer_stack, CONFIG_ESPHOME_OTA_WRITER_STACK_SIZE);
+static struct k_work_q esphome_ota_writer_workq;
+
+#ifdef CONFIG_ESPHOME_OTA_MD5
+static void esphome_ota_md5_start(struct esphome_ota_writer *writer)
+{
+	mbedtls_md5_init(&writer->md5);
+	mbedtls_md5_starts(&writer->md5);
+	writer->md5_cycles = 0;
+}
+
+static void esphome_ota_md5_update(struct esphome_ota_writer *writer, const uint8_t *data,
+				   size_t len)
+{
+	uint32_t start = k_cycle_get_32();
+
+	mbedtls_md5_update(&writer->md5, data, len);
+	writer->md5_cycles += k_cycle_get_32() - start;
+}
+
+/* Compare the hash of the received data with the hex digest sent by the client */
+static int esphome_ota_md5_check(struct esphome_ota_writer *writer, const char *expected)
+{
+	uint64_t us = k_cyc_to_us_ceil64(writer->md5_cycles);
+	char hex[2 * 16 + 1];
+	uint8_t digest[16];
+
+	mbedtls_md5_finish(&writer->md5, digest);
+	mbedtls_md5_free(&writer->md5);
+	bin2hex(digest, sizeof(digest), hex, sizeof(hex));
+
+	LOG_INF("MD5 of %zu bytes took %llu us (%llu us/KB)", writer->received, us,
+		writer->received ? us * 1024 / writer->received : 0);
+
+	if (strncasecmp(hex, expected, sizeof(hex) - 1)) {
+		LOG_ERR("MD5 mismatch, expected %s, computed %s", expected, hex);
+		return -EBADMSG;
+	}
+
+	return 0;
+}
+#else
+static inline void esphome_ota_md5_start(struct esphome_ota_writer *writer)
+{
+}
+
+static inline void esphome_ota_md5_update(struct esphome_ota_writer *writer,
+					  const uint8_t *data, size_t len)
+{
+}
+
+static inline int esphome_ota_md5_check(struct esphome_ota_writer *writer, const char *expected)
+{
+	return 0;
+}
+#endif /* CONFIG_ESPHOME_OTA_MD5 */
+
+/*
+ * Recycle the current buffer and wait for the next one, returns NULL at the end
+ * of the stream. The data is hashed as received, before it is decompressed.
+ */
+#ifdef CONFIG_ESPHOME_OTA_ERASE_AHEAD
+/* Each buffer fills whole flash_img blocks, so it is programmed before the next one is taken */
+BUILD_ASSERT(CONFIG_ESPHOME_OTA_BUFFER_SIZE % CONFIG_IMG_BLOCK_BUF_SIZE == 0,
+	     "The OTA buffer size must be a multiple of CONFIG_IMG_BLOCK_BUF_SIZE");
+
+/* Erase the page of the upload slot at offset */
+static int esphome_ota_erase_page(struct esphome_ota_writer *writer, size_t offset, size_t *end)
+{
+	const struct flash_area *fa = writer->ctx->flash_area;
+	struct flash_pages_info info;
+	uint32_t start = k_cycle_get_32();
+	int ret;
+
+	if (offset >= fa->fa_size) {
+		return -ENOSPC;
+	}
+
+	ret = flash_get_page_info_by_offs(flash_area_get_device(fa), fa->fa_off + offset, &info);
+	if (ret) {
+		return ret;
+	}
+
+	*end = MIN(info.start_offset + info.size - fa->fa_off, fa->fa_size);
+	ret = flash_area_erase(fa, offset, *end - offset);
+	writer->erase_cycles += k_cycle_get_32() - start;
+	if (ret) {
+		LOG_ERR("Failed to erase at offset %zu [%d]", offset, ret);
+	}
+
+	return ret;
+}
+
+/* Before a write, in case the erase ahead did not keep up */
+static int esphome_ota_erase_until(struct esphome_ota_writer *writer, size_t end)
+{
+	int ret;
+
+	while (writer->erased < end) {
+		ret = esphome_ota_erase_page(writer, writer->erased, &writer->erased);
+		if (ret) {
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+/* Use the time waiting for the network to erase the next page, if not too far ahead */
+static bool esphome_ota_erase_ahead(struct esphome_ota_writer *writer)
+{
+	if (writer->erased >= writer->written + CONFIG_ESPHOME_OTA_ERASE_AHEAD_SIZE) {
+		return false;
+	}
+
+	return !esphome_ota_erase_page(writer, writer->erased, &writer->erased);
+}
+
+/*
+ * MCUboot writes the upgrade request in the trailer, at the end of the slot,
+ * and the trailer may span several pages
+ */
+static int esphome_ota_erase_trailer(struct esphome_ota_writer *writer)
+{
+	const struct flash_area *fa = writer->ctx->flash_area;
+	struct flash_pages_info info;
+	size_t offset;
+	int ret;
+
+	ret = flash_get_page_info_by_offs(flash_area_get_device(fa),
+					  fa->fa_off + BOOT_TRAILER_IMG_STATUS_OFFS(fa), &info);
+	if (ret) {
+		return ret;
+	}
+
+	/* The pages below writer->erased may already hold the end of the image */
+	offset = MAX((size_t)(info.start_offset - fa->fa_off), writer->erased);
+	while (offset < fa->fa_size) {
+		ret = esphome_ota_erase_page(writer, offset, &offset);
+		if (ret) {
+			return ret;
+		}
+	}
+
+	return 0;
+}
+#else
+static inline int esphome_ota_erase_until(struct esphome_ota_writer *writer, size_t end)
+{
+	return 0;
+}
+
+static inline bool esphome_ota_erase_ahead(struct esphome_ota_writer *writer)
+{
+	return false;
+}
+
+static inline int esphome_ota_erase_trailer(struct esphome_ota_writer *writer)
+{
+	return 0;
+}
+#endif /* CONFIG_ESPHOME_OTA_ERASE_AHEAD */
+
+static struct esphome_ota_buffer *esphome_ota_writer_next(struct esphome_ota_writer *writer)
+{
+	struct esphome_ota_buffer *buffer;
+	uint32_t start;
+
+	if (writer->current) {
+		k_fifo_put(&writer->free, writer->current);
+		writer->current = NULL;
+	}
+
+	if (writer->ended) {
+		return NULL;
+	}
+
+	while ((buffer = k_fifo_get(&writer->filled, K_NO_WAIT)) == NULL) {
+		if (!esphome_ota_erase_ahead(writer)) {
+			start = k_cycle_get_32();
+			buffer = k_fifo_get(&writer->filled, K_FOREVER);
+			writer->wait_cycles += k_cycle_get_32() - start;
+			break;
+		}
+	}
+
+	if (!buffer->len) {
+		writer->ended = true;
+		k_fifo_put(&writer->free, buffer);
+		return NULL;
+	}
+
+	esphome_ota_md5_update(writer, buffer->data, buffer->len);
+	writer->received += buffer->len;
+	writer->current = buffer;
+
+	return buffer;
+}
+
+#ifdef CONFIG_ESPHOME_OTA_RESUME
+#define ESPHOME_OTA_RESUME_KEY "esphome/ota/resume"
+
+/* Persisted while an update is received, the offset starts a flash page */
+struct esphome_ota_resume {
+	char md5[32];
+	uint32_t size;
+	uint32_t offset;
+};
+
+static int esphome_ota_resume_set(const char *key, size_t len, settings_read_cb read_cb,
+				  void *cb_arg, void *param)
+{
+	struct esphome_ota_resume *resume = param;
+	ssize_t ret;
+
+	if (key && key[0] != '\0') {
+		return 0;
+	}
+
+	if (len != sizeof(*resume)) {
+		return -EINVAL;
+	}
+
+	ret = read_cb(cb_arg, resume, len);
+
+	return ret < 0 ? ret : 0;
+}
+
+/* Returns where to resume the image, 0 unless it is the one of an interrupted update */
+static size_t esphome_ota_resume_offset(const char *md5, size_t size)
+{
+	struct esphome_ota_resume resume = {0};
+	int ret;
+
+	ret = settings_subsys_init();
+	if (ret) {
+		LOG_ERR("Failed to initialize settings [%d]", ret);
+		return 0;
+	}
+
+	ret = settings_load_subtree_direct(ESPHOME_OTA_RESUME_KEY, esphome_ota_resume_set, &resume);
+	if (ret || resume.size != size || strncasecmp(resume.md5, md5, sizeof(resume.md5)) ||
+	    resume.offset >= size) {
+		return 0;
+	}
+
+	LOG_INF("Resuming the update at offset %u", resume.offset);
+
+	return resume.offset;
+}
+
+/*
+ * Only the pages after the saved offset are erased again when resuming, so it
+ * is rounded down to the page holding the last byte flushed to the flash.
+ */
+static void esphome_ota_resume_save(struct esphome_ota_writer *writer, bool force)
+{
+	const struct flash_area *fa = writer->ctx->flash_area;
+	size_t flushed = writer->base + flash_img_bytes_written(writer->ctx);
+	struct esphome_ota_resume resume;
+	struct flash_pages_info info;
+	int ret;
+
+	if (!(writer->features & OTA_FEATURE_SUPPORTS_RESUME) || flushed == writer->saved ||
+	    (!force && flushed < writer->saved + CONFIG_ESPHOME_OTA_RESUME_SAVE_INTERVAL)) {
+		return;
+	}
+
+	ret = flash_get_page_info_by_offs(flash_area_get_device(fa), fa->fa_off + flushed, &info);
+	if (ret) {
+		return;
+	}
+
+	memcpy(resume.md5, writer->image_md5, sizeof(resume.md5));
+	resume.size = writer->image_size;
+	resume.offset = MAX((size_t)(info.start_offset - fa->fa_off), writer->base);
+
+	ret = settings_save_one(ESPHOME_OTA_RESUME_KEY, &resume, sizeof(resume));
+	if (ret) {
+		LOG_WRN("Failed to save the OTA progress [%d]", ret);
+		return;
+	}
+
+	writer->saved = flushed;
+}
+
+static void esphome_ota_resume_clear(void)
+{
+	settings_delete(ESPHOME_OTA_RESUME_KEY);
+}
+
+/* Continue the flash image at offset, which starts a page */
+static int esphome_ota_resume_seek(struct flash_img_context *ctx, size_t offset)
 {
-	uint8_t error_code = 0;
-	char magic_bytes[sizeof(MAGIC_BYTES)];
+	const struct flash_area *fa = ctx->flash_area;
+
+	return stream_flash_init(&ctx->stream, flash_area_get_device(fa), ctx->buf,
+				 sizeof(ctx->buf), fa->fa_off + offset, fa->fa_size - offset, NULL);
+}
+
+/* The MD5 covers the whole image, including what was received before resuming */
+static int esphome_ota_resume_hash(struct esphome_ota_writer *writer)
+{
+	uint8_t buf[256];
+	size_t len;
 	int ret;
 
-	ret = zsock_recv(socket, magic_bytes, sizeof(MAGIC_BYTES), ZSOCK_MSG_WAITALL);
-	if (ret != sizeof(MAGIC_BYTES)) {
+	if (!IS_ENABLED(CONFIG_ESPHOME_OTA_MD5)) {
+		return 0;
+	}
+
+	for (size_t offset = 0; offset < writer->base; offset += len) {
+		len = MIN(sizeof(buf), writer->base - offset);
+		ret = flash_area_read(writer->ctx->flash_area, offset, buf, len);
+		if (ret) {
+			return ret;
+		}
+		esphome_ota_md5_update(writer, buf, len);
+	}
+
+	return 0;
+}
+
+/* Every update starts the writer, a previous resumed one must not leave its offset */
+static void esphome_ota_resume_reset(struct esphome_ota_writer *writer, size_t offset)
+{
+	writer->base = offset;
+	writer->saved = offset;
+}
+
+static void esphome_ota_resume_start(struct esphome_ota_writer *writer, const char *md5,
+				     size_t size, size_t offset)
+{
+	writer->image_md5 = md5;
+	writer->image_size = size;
+	esphome_ota_resume_reset(writer, offset);
+}
+#else
+static inline size_t esphome_ota_resume_offset(const char *md5, size_t size)
+{
+	return 0;
+}
+
+static inline void esphome_ota_resume_save(struct esphome_ota_writer *writer, bool force)
+{
+}
+
+static inline void esphome_ota_resume_clear(void)
+{
+}
+
+static inline int esphome_ota_resume_seek(struct flash_img_context *ctx, size_t offset)
+{
+	return -ENOTSUP;
+}
+
+static inline int esphome_ota_resume_hash(struct esphome_ota_writer *writer)
+{
+	return 0;
+}
+
+static inline void esphome_ota_resume_reset(struct esphome_ota_writer *writer, size_t offset)
+{
+}
+
+static inline void esphome_ota_resume_start(struct esphome_ota_writer *writer, const char *md5,
+					    size_t size, size_t offset)
+{
+}
+#endif /* CONFIG_ESPHOME_OTA_RESUME */
+
+static int esphome_ota_write(struct esphome_ota_writer *writer, const uint8_t *data, size_t len)
+{
+	uint32_t start;
+	int ret;
+
+	ret = esphome_ota_erase_until(writer, writer->written + len);
+	if (ret) {
+		return ret;
+	}
+
+	start = k_cycle_get_32();
+	ret = flash_img_buffered_write(writer->ctx, data, len, false);
+	writer->program_cycles += k_cycle_get_32() - start;
+	if (!ret) {
+		esphome_ota_resume_save(writer, false);
+	}
+	if (ret) {
+		LOG_ERR("Failed to write at offset %zu [%d]", writer->written, ret);
+		return ret;
+	}
+
+	writer->written += len;
+
+	return 0;
+}
+
+#ifdef CONFIG_ESPHOME_OTA_DELTA
+static int esphome_ota_delta_read(void *user_data, size_t offset, uint8_t *data, size_t len)
+{
+	struct esphome_ota_writer *writer = user_data;
+
+	return flash_area_read(writer->source, offset, data, len);
+}
+
+static int esphome_ota_delta_write(void *user_data, const uint8_t *data, size_t len)
+{
+	return esphome_ota_write(user_data, data, len);
+}
+
+static int esphome_ota_delta_start(struct esphome_ota_writer *writer)
+{
+	struct esphome_delta *delta = &writer->delta;
+	int ret;
+
+	ret = flash_area_open(FIXED_PARTITION_ID(slot0_partition), &writer->source);
+	if (ret) {
+		return ret;
+	}
+
+	delta->read = esphome_ota_delta_read;
+	delta->write = esphome_ota_delta_write;
+	delta->user_data = writer;
+	delta->source_area_size = writer->source->fa_size;
+	esphome_delta_start(delta);
+
+	return 0;
+}
+
+static int esphome_ota_delta_finish(struct esphome_ota_writer *writer)
+{
+	flash_area_close(writer->source);
+
+	return esphome_delta_finish(&writer->delta);
+}
+
+/* The decompressed data, a delta is applied against the running image */
+static int esphome_ota_output(struct esphome_ota_writer *writer, const uint8_t *data, size_t len)
+{
+	int ret;
+
+	if (!(writer->features & OTA_FEATURE_SUPPORTS_DELTA)) {
+		return esphome_ota_write(writer, data, len);
+	}
+
+	ret = esphome_delta_write(&writer->delta, data, len);
+	if (ret == -ESTALE) {
+		LOG_ERR("The delta was not made from the running image");
+	}
+
+	return ret;
+}
+#else
+static inline int esphome_ota_delta_start(struct esphome_ota_writer *writer)
+{
+	return -ENOTSUP;
+}
+
+static inline int esphome_ota_delta_finish(struct esphome_ota_writer *writer)
+{
+	return -ENOTSUP;
+}
+
+static int esphome_ota_output(struct esphome_ota_writer *writer, const uint8_t *data, size_t len)
+{
+	return esphome_ota_write(writer, data, len);
+}
+#endif /* CONFIG_ESPHOME_OTA_DELTA */
+
+static int esphome_ota_write_raw(struct esphome_ota_writer *writer)
+{
+	struct esphome_ota_buffer *buffer;
+	int ret;
+
+	while ((buffer = esphome_ota_writer_next(writer)) != NULL) {
+		ret = esphome_ota_output(writer, buffer->data, buffer->len);
+		if (ret) {
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+#ifdef CONFIG_ESPHOME_OTA_COMPRESSION
+BUILD_ASSERT(IS_POWER_OF_TWO(CONFIG_ESPHOME_OTA_COMPRESSION_WINDOW),
+	     "The decompression window size must be a power of two");
+
+static uint8_t esphome_ota_window[CONFIG_ESPHOME_OTA_COMPRESSION_WINDOW];
+
+static int esphome_ota_inflate_fill(void *user_data, const uint8_t **data, size_t *len)
+{
+	struct esphome_ota_buffer *buffer = esphome_ota_writer_next(user_data);
+
+	if (!buffer) {
+		*len = 0;
+		return 0;
+	}
+
+	*data = buffer->data;
+	*len = buffer->len;
+
+	return 0;
+}
+
+static int esphome_ota_inflate_flush(void *user_data, const uint8_t *data, size_t len)
+{
+	return esphome_ota_output(user_data, data, len);
+}
+
+static int esphome_ota_write_compressed(struct esphome_ota_writer *writer)
+{
+	struct esphome_inflate *inflate = &writer->inflate;
+	ssize_t ret;
+
+	inflate->fill = esphome_ota_inflate_fill;
+	inflate->flush = esphome_ota_inflate_flush;
+	inflate->user_data = writer;
+	inflate->window = esphome_ota_window;
+	inflate->window_size = sizeof(esphome_ota_window);
+
+	ret = esphome_inflate_gzip(inflate);
+	if (ret < 0) {
+		LOG_ERR("Failed to decompress at offset %zu [%d]", writer->received, (int)ret);
+		return ret;
+	}
+
+	if (inflate->in_len || esphome_ota_writer_next(writer)) {
+		LOG_ERR("Trailing data after the compressed image");
+		return -EBADMSG;
+	}
+
+	return 0;
+}
+#else
+static inline int esphome_ota_write_compressed(struct esphome_ota_writer *writer)
+{
+	return -ENOTSUP;
+}
+#endif /* CONFIG_ESPHOME_OTA_COMPRESSION */
+
+/* Runs for the whole update, until the end of the stream is submitted */
+static void esphome_ota_write_work(struct k_work *work)
+{
+	struct esphome_ota_writer *writer = CONTAINER_OF(work, struct esphome_ota_writer, work);
+	bool delta = writer->features & OTA_FEATURE_SUPPORTS_DELTA;
+	int ret;
+
+	if (delta) {
+		ret = esphome_ota_delta_start(writer);
+		delta = !ret;
+	} else {
+		ret = esphome_ota_resume_hash(writer);
+	}
+
+	if (ret) {
+		LOG_ERR("Failed to read the %s image [%d]",
+			writer->features & OTA_FEATURE_SUPPORTS_DELTA ? "running" : "resumed", ret);
+	} else if (writer->features & OTA_FEATURE_SUPPORTS_COMPRESSION) {
+		ret = esphome_ota_write_compressed(writer);
+	} else {
+		ret = esphome_ota_write_raw(writer);
+	}
+
+	if (delta) {
+		ret = ret ? ret : esphome_ota_delta_finish(writer);
+	}
+
+	if (!ret) {
+		ret = flash_img_buffered_write(writer->ctx, NULL, 0, true);
+	}
+
+	/* Also when the connection dropped, everything received can be kept */
+	if (!ret) {
+		esphome_ota_resume_save(writer, true);
+	}
+
+	if (!ret) {
+		ret = esphome_ota_erase_trailer(writer);
+	}
+
+	if (ret) {
+		writer->error = ret;
+		/* The receiver stops at its next buffer, drop what it already submitted */
+		while (esphome_ota_writer_next(writer)) {
+		}
+	}
+}
+
+static void esphome_ota_writer_start(struct esphome_ota_writer *writer,
+				     struct flash_img_context *ctx, uint8_t features, size_t offset)
+{
+	writer->ctx = ctx;
+	writer->features = features;
+	writer->current = NULL;
+	writer->ended = false;
+	writer->received = 0;
+	writer->written = offset;
+	writer->erased = offset;
+	writer->erase_cycles = 0;
+	writer->program_cycles = 0;
+	writer->wait_cycles = 0;
+	writer->error = 0;
+	esphome_ota_resume_reset(writer, offset);
+	esphome_ota_md5_start(writer);
+
+	/* Starting over overwrites the slot a saved progress would resume into */
+	if (!offset) {
+		esphome_ota_resume_clear();
+	}
+
+	k_fifo_init(&writer->free);
+	k_fifo_init(&writer->filled);
+	k_work_init(&writer->work, esphome_ota_write_work);
+
+	for (size_t i = 0; i < ARRAY_SIZE(esphome_ota_buffers); i++) {
+		k_fifo_put(&writer->free, &esphome_ota_buffers[i]);
+	}
+
+	k_work_submit_to_queue(&esphome_ota_writer_workq, &writer->work);
+}
+
+/* Wait for a buffer to be written, returns NULL if a write failed */
+static struct esphome_ota_buffer *esphome_ota_writer_get(struct esphome_ota_writer *writer)
+{
+	struct esphome_ota_buffer *buffer;
+
+	buffer = k_fifo_get(&writer->free, K_FOREVER);
+	if (writer->error) {
+		k_fifo_put(&writer->free, buffer);
+		return NULL;
+	}
+
+	return buffer;
+}
+
+static void esphome_ota_writer_submit(struct esphome_ota_writer *writer,
+				      struct esphome_ota_buffer *buffer)
+{
+	k_fifo_put(&writer->filled, buffer);
+}
+
+/* Wait for the submitted buffers to be written, also needed before giving up */
+static int esphome_ota_writer_stop(struct esphome_ota_writer *writer)
+{
+	struct esphome_ota_buffer *buffer;
+	struct k_work_sync sync;
+
+	/* An empty buffer marks the end of the stream */
+	buffer = k_fifo_get(&writer->free, K_FOREVER);
+	buffer->len = 0;
+	k_fifo_put(&writer->filled, buffer);
+
+	k_work_flush(&writer->work, &sync);
+
+	return writer->error;
+}
+
+#ifdef CONFIG_ESPHOME_OTA_SERVER
+static int esphome_ota_send_response(int socket, uint8_t response)
+{
+	int ret;
+
+	ret = zsock_send(socket, &response, 1, 0);
+	if (ret != 1) {
 		return -EIO;
 	}
 
-	if (memcmp(MAGIC_BYTES, magic_bytes, sizeof(MAGIC_BYTES))) {
-		error_code = OTA_RESPONSE_ERROR_MAGIC;
-		goto error;
+	return 0;
+}
+
+int esphome_ota_send_version(int socket)
+{
+	char buf[2] = {OTA_RESPONSE_OK, USE_OTA_VERSION};
+	int ret;
+
+	ret = zsock_send(socket, buf, sizeof(buf), 0);
+	if (ret != sizeof(buf)) {
+		return -EIO;
+	}
+
+	return 0;
+}
+
+/* Only keep the features supported on both sides */
+static uint8_t esphome_ota_features(uint8_t ota_features)
+{
+	if (!IS_ENABLED(CONFIG_ESPHOME_OTA_COMPRESSION)) {
+		ota_features &= ~OTA_FEATURE_SUPPORTS_COMPRESSION;
+	}
+	if (!IS_ENABLED(CONFIG_ESPHOME_OTA_DELTA)) {
+		ota_features &= ~OTA_FEATURE_SUPPORTS_DELTA;
+	}
+	/* The offset to resume at is in the image, not in the stream received */
+	if (!IS_ENABLED(CONFIG_ESPHOME_OTA_RESUME) ||
+	    (ota_features & (OTA_FEATURE_SUPPORTS_COMPRESSION | OTA_FEATURE_SUPPORTS_DELTA))) {
+		ota_features &= ~OTA_FEATURE_SUPPORTS_RESUME;
+	}
+
+	return ota_features;
+}
+
+/* The client compresses the image if told it is supported */
+int esphome_ota_send_features(int socket, uint8_t ota_features)
+{
+	uint8_t response;
+
+	if (ota_features & OTA_FEATURE_SUPPORTS_DELTA) {
+		if (ota_features & OTA_FEATURE_SUPPORTS_COMPRESSION) {
+			response = OTA_RESPONSE_SUPPORTS_COMPRESSED_DELTA;
+		} else {
+			response = OTA_RESPONSE_SUPPORTS_DELTA;
+		}
+	} else if (ota_features & OTA_FEATURE_SUPPORTS_COMPRESSION) {
+		response = OTA_RESPONSE_SUPPORTS_COMPRESSION;
+	} else {
+		response = OTA_RESPONSE_HEADER_OK;
 	}
 
-	return 0;
-
-error:
-	zsock_send(socket, &error_code, 1, 0);
-	return -EIO;
+	return esphome_ota_send_response(socket, response);
 }
 
-int esphome_ota_send_version(int socket)
+int esphome_ota_send_auth_ok(int socket)
 {
-	char buf[2] = {OTA_RESPONSE_OK, USE_OTA_VERSION};
+	char buf[1];
 	int ret;
 
+	/* Send ack */
+	buf[0] = OTA_RESPONSE_AUTH_OK;
 	ret = zsock_send(socket, buf, sizeof(buf), 0);
 	if (ret != sizeof(buf)) {
 		return -EIO;
@@ -52,20 +836,13 @@ int esphome_ota_send_version(int socket)
 	return 0;
 }
 
-int esphome_ota_read_features(int socket, uint8_t *ota_features)
+int esphome_ota_send_prepare_ok(int socket)
 {
 	char buf[1];
 	int ret;
 
-	ret = zsock_recv(socket, buf, sizeof(buf), ZSOCK_MSG_WAITALL);
-	if (ret != sizeof(buf)) {
-		return -EIO;
-	}
-
-	*ota_features = buf[0];
-
 	/* Send ack */
-	buf[0] = OTA_RESPONSE_HEADER_OK;
+	buf[0] = OTA_RESPONSE_UPDATE_PREPARE_OK;
 	ret = zsock_send(socket, buf, sizeof(buf), 0);
 	if (ret != sizeof(buf)) {
 		return -EIO;
@@ -74,13 +851,11 @@ int esphome_ota_read_features(int socket, uint8_t *ota_features)
 	return 0;
 }
 
-int esphome_ota_send_auth_ok(int socket)
+int esphome_ota_send_data_ack(int socket)
 {
-	char buf[1];
+	char buf[1] = {OTA_RESPONSE_OK};
 	int ret;
 
-	/* Send ack */
-	buf[0] = OTA_RESPONSE_AUTH_OK;
 	ret = zsock_send(socket, buf, sizeof(buf), 0);
 	if (ret != sizeof(buf)) {
 		return -EIO;
@@ -89,247 +864,470 @@ int esphome_ota_send_auth_ok(int socket)
 	return 0;
 }
 
-int esphome_ota_read_size(int socket, size_t *ota_size)
+/* Send the MD5 ack, telling where to resume if the client supports it */
+static int esphome_ota_send_md5_ok(int socket, uint8_t ota_features, size_t offset)
 {
-	char buf[4];
-	int ret;
+	uint8_t buf[1 + sizeof(uint32_t)];
 
-	ret = zsock_recv(socket, buf, sizeof(buf), ZSOCK_MSG_WAITALL);
-	if (ret != sizeof(buf)) {
-		return -EIO;
+	if (!(ota_features & OTA_FEATURE_SUPPORTS_RESUME)) {
+		return esphome_ota_send_response(socket, OTA_RESPONSE_BIN_MD5_OK);
 	}
 
-	*ota_size = 0;
-	for (uint8_t i = 0; i < 4; i++) {
-		*ota_size <<= 8;
-		*ota_size |= (buf[i]) & 0xff;
+	buf[0] = OTA_RESPONSE_BIN_MD5_OK_RESUME;
+	sys_put_be32(offset, &buf[1]);
+	if (zsock_send(socket, buf, sizeof(buf), 0) != sizeof(buf)) {
+		return -EIO;
 	}
 
 	return 0;
 }
 
-int esphome_ota_send_prepare_ok(int socket)
+#ifdef CONFIG_ESPHOME_SINGLE_LOOP
+/* Only called once the socket is readable, the rest is taken at the next call */
+#define ESPHOME_OTA_RECV_FLAGS ZSOCK_MSG_DONTWAIT
+#else
+#define ESPHOME_OTA_RECV_FLAGS 0
+#endif
+
+/* What the client sends next, each step but the data is a field of a fixed size */
+enum esphome_ota_step {
+	ESPHOME_OTA_MAGIC,
+	ESPHOME_OTA_FEATURES,
+	ESPHOME_OTA_SIZE,
+	ESPHOME_OTA_MD5,
+	ESPHOME_OTA_DATA,
+	ESPHOME_OTA_ACK,
+};
+
+static const uint8_t esphome_ota_field_sizes[] = {
+	[ESPHOME_OTA_MAGIC] = sizeof(MAGIC_BYTES),
+	[ESPHOME_OTA_FEATURES] = 1,
+	[ESPHOME_OTA_SIZE] = sizeof(uint32_t),
+	[ESPHOME_OTA_MD5] = 32,
+	[ESPHOME_OTA_ACK] = 1,
+};
+
+/*
+ * A connection to the OTA server, received as the data arrives. In single
+ * loop mode, it never waits for the client: the other sockets of the loop
+ * are served between two reads. It only waits for the flash, when all the
+ * buffers are waiting to be written.
+ */
+struct esphome_ota_conn {
+	int socket;
+	struct flash_img_context ctx;
+	enum esphome_ota_step step;
+	/* Field of the step, as much as was received so far */
+	uint8_t field[32];
+	size_t field_len;
+	uint8_t features;
+	size_t ota_size;
+	char md5[32 + 1];
+	/* Where the upload resumed, what was received and acknowledged since the start */
+	size_t offset;
+	size_t total;
+	size_t acknowledged;
+	/* Buffer being received, submitted to the writer once full */
+	struct esphome_ota_buffer *buffer;
+	int64_t start;
+};
+
+static struct esphome_ota_conn esphome_ota_conn;
+
+/* Everything is received, wait for the writer and verify the image */
+static int esphome_ota_conn_finish(struct esphome_ota_conn *conn)
 {
-	char buf[1];
+	struct esphome_ota_writer *writer = &esphome_ota_writer;
+	size_t total = conn->total - conn->offset;
+	int64_t elapsed;
 	int ret;
 
-	/* Send ack */
-	buf[0] = OTA_RESPONSE_UPDATE_PREPARE_OK;
-	ret = zsock_send(socket, buf, sizeof(buf), 0);
-	if (ret != sizeof(buf)) {
+	conn->step = ESPHOME_OTA_ACK;
+
+	/* Only left when a write failed, the writer needs it to end the stream */
+	if (conn->buffer) {
+		k_fifo_put(&writer->free, conn->buffer);
+		conn->buffer = NULL;
+	}
+
+	ret = esphome_ota_writer_stop(writer);
+	if (ret) {
+		esphome_ota_send_response(conn->socket, OTA_RESPONSE_ERROR_WRITING_FLASH);
 		return -EIO;
 	}
 
-	return 0;
+	elapsed = MAX(k_uptime_get() - conn->start, 1);
+	LOG_INF("Received %zu bytes in %lld ms (%lld KB/s), wrote %zu bytes", total, elapsed,
+		total * MSEC_PER_SEC / 1024 / elapsed, writer->written - conn->offset);
+	LOG_INF("Erase %llu ms, program %llu ms, flash idle waiting for the network %llu ms",
+		k_cyc_to_ms_ceil64(writer->erase_cycles),
+		k_cyc_to_ms_ceil64(writer->program_cycles),
+		k_cyc_to_ms_ceil64(writer->wait_cycles));
+
+	ret = esphome_ota_send_response(conn->socket, OTA_RESPONSE_RECEIVE_OK);
+	if (ret) {
+		return ret;
+	}
+
+	/* Verified before the upgrade is requested, a corrupted image is never booted */
+	ret = esphome_ota_md5_check(writer, conn->md5);
+	esphome_ota_resume_clear();
+	if (ret) {
+		esphome_ota_send_response(conn->socket, OTA_RESPONSE_ERROR_MD5_MISMATCH);
+		return ret;
+	}
+
+	boot_request_upgrade(1);
+
+	return esphome_ota_send_response(conn->socket, OTA_RESPONSE_UPDATE_END_OK);
 }
 
-int esphome_ota_read_md5(int socket, char *md5_buf, int size)
+static int esphome_ota_conn_data(struct esphome_ota_conn *conn)
 {
-	uint8_t error_code = 0;
-	int ret;
+	struct esphome_ota_writer *writer = &esphome_ota_writer;
+	struct esphome_ota_buffer *buffer = conn->buffer;
+	ssize_t ret;
+
+	if (!buffer) {
+		buffer = esphome_ota_writer_get(writer);
+		if (!buffer) {
+			return esphome_ota_conn_finish(conn);
+		}
 
-	ret = zsock_recv(socket, md5_buf, size - 1, ZSOCK_MSG_WAITALL);
-	if (ret != (size - 1)) {
-		goto error;
+		buffer->len = 0;
+		conn->buffer = buffer;
 	}
 
-	md5_buf[size - 1] = '\0';
+	ret = zsock_recv(conn->socket, buffer->data + buffer->len,
+			 MIN(sizeof(buffer->data) - buffer->len, conn->ota_size - conn->total),
+			 ESPHOME_OTA_RECV_FLAGS);
+	if (ret < 0) {
+		return errno == EAGAIN ? 0 : -errno;
+	}
+	if (ret == 0) {
+		return -ECONNRESET;
+	}
 
-	/* Send ack */
-	md5_buf[0] = OTA_RESPONSE_BIN_MD5_OK;
-	ret = zsock_send(socket, md5_buf, 1, 0);
-	if (ret != 1) {
-		return -EIO;
+	buffer->len += ret;
+	conn->total += ret;
+	if (buffer->len == sizeof(buffer->data) || conn->total == conn->ota_size) {
+		esphome_ota_writer_submit(writer, buffer);
+		conn->buffer = NULL;
 	}
 
-	return 0;
+	/* The blocks are acknowledged once received, they are written meanwhile */
+	while (conn->acknowledged + OTA_BLOCK_SIZE <= conn->total ||
+	       (conn->total == conn->ota_size && conn->acknowledged < conn->ota_size)) {
+		ret = esphome_ota_send_response(conn->socket, OTA_RESPONSE_CHUNK_OK);
+		if (ret) {
+			return ret;
+		}
+		conn->acknowledged += OTA_BLOCK_SIZE;
+	}
+
+	if (conn->total == conn->ota_size) {
+		return esphome_ota_conn_finish(conn);
+	}
 
-error:
-	zsock_send(socket, &error_code, 1, 0);
-	return -EIO;
+	return 0;
 }
 
-int esphome_ota_read_data(int socket, char *buf, int size)
+static int esphome_ota_conn_md5(struct esphome_ota_conn *conn)
 {
-	uint8_t error_code = 0;
 	int ret;
 
-	ret = zsock_recv(socket, buf, size, ZSOCK_MSG_WAITALL);
-	if (ret != size) {
-		goto error;
+	memcpy(conn->md5, conn->field, sizeof(conn->md5) - 1);
+	conn->md5[sizeof(conn->md5) - 1] = '\0';
+
+	conn->offset = 0;
+	if (conn->features & OTA_FEATURE_SUPPORTS_RESUME) {
+		conn->offset = esphome_ota_resume_offset(conn->md5, conn->ota_size);
+		if (conn->offset && esphome_ota_resume_seek(&conn->ctx, conn->offset)) {
+			conn->offset = 0;
+		}
+		esphome_ota_resume_start(&esphome_ota_writer, conn->md5, conn->ota_size,
+					 conn->offset);
 	}
 
-	return 0;
+	ret = esphome_ota_send_md5_ok(conn->socket, conn->features, conn->offset);
+	if (ret) {
+		return ret;
+	}
+
+	conn->total = conn->offset;
+	conn->acknowledged = conn->offset;
+	conn->start = k_uptime_get();
+	conn->step = ESPHOME_OTA_DATA;
+	esphome_ota_writer_start(&esphome_ota_writer, &conn->ctx, conn->features, conn->offset);
 
-error:
-	zsock_send(socket, &error_code, 1, 0);
-	return -EIO;
+	if (conn->total == conn->ota_size) {
+		return esphome_ota_conn_finish(conn);
+	}
+
+	return 0;
 }
 
-int esphome_ota_send_data_ack(int socket)
+/* The field of the step is complete */
+static int esphome_ota_conn_field(struct esphome_ota_conn *conn)
 {
-	char buf[1] = {OTA_RESPONSE_OK};
 	int ret;
 
-	ret = zsock_send(socket, buf, sizeof(buf), 0);
-	if (ret != sizeof(buf)) {
-		return -EIO;
-	}
+	switch (conn->step) {
+	case ESPHOME_OTA_MAGIC:
+		if (memcmp(conn->field, MAGIC_BYTES, sizeof(MAGIC_BYTES))) {
+			LOG_ERR("Invalid magic value");
+			esphome_ota_send_response(conn->socket, OTA_RESPONSE_ERROR_MAGIC);
+			return -EIO;
+		}
 
-	return 0;
+		conn->step = ESPHOME_OTA_FEATURES;
+		return esphome_ota_send_version(conn->socket);
+
+	case ESPHOME_OTA_FEATURES:
+		conn->features = esphome_ota_features(conn->field[0]);
+		ret = esphome_ota_send_features(conn->socket, conn->features);
+		if (ret) {
+			return ret;
+		}
+
+		/* TODO: read password and check password */
+		conn->step = ESPHOME_OTA_SIZE;
+		return esphome_ota_send_auth_ok(conn->socket);
+
+	case ESPHOME_OTA_SIZE:
+		/* TODO: check memory size */
+		conn->ota_size = sys_get_be32(conn->field);
+		conn->step = ESPHOME_OTA_MD5;
+		return esphome_ota_send_prepare_ok(conn->socket);
+
+	case ESPHOME_OTA_MD5:
+		return esphome_ota_conn_md5(conn);
+
+	case ESPHOME_OTA_ACK:
+		if (conn->field[0] != OTA_RESPONSE_OK) {
+			return -EINVAL;
+		}
+
+		LOG_INF("Rebooting ...");
+		sys_reboot(SYS_REBOOT_WARM);
+
+		/* We are not supposed to reach this point */
+		return -ENOTSUP;
+
+	default:
+		return -EINVAL;
+	}
 }
 
-int esphome_ota_read_ack(int socket)
+/* Receive what the socket has, returns an error once the connection must be closed */
+static int esphome_ota_conn_ready(struct esphome_ota_conn *conn)
 {
-	char buf[1];
-	int ret;
+	size_t size = esphome_ota_field_sizes[conn->step];
+	ssize_t ret;
 
-	ret = zsock_recv(socket, buf, 1, ZSOCK_MSG_WAITALL);
-	if (ret != 1) {
-		return -EIO;
+	if (conn->step == ESPHOME_OTA_DATA) {
+		return esphome_ota_conn_data(conn);
 	}
 
-	if (buf[0] != OTA_RESPONSE_OK) {
-		return -EINVAL;
+	ret = zsock_recv(conn->socket, conn->field + conn->field_len, size - conn->field_len,
+			 ESPHOME_OTA_RECV_FLAGS);
+	if (ret < 0) {
+		return errno == EAGAIN ? 0 : -errno;
+	}
+	if (ret == 0) {
+		return -ECONNRESET;
 	}
 
-	return 0;
+	conn->field_len += ret;
+	if (conn->field_len < size) {
+		return 0;
+	}
+
+	conn->field_len = 0;
+
+	return esphome_ota_conn_field(conn);
 }
+#endif /* CONFIG_ESPHOME_OTA_SERVER */
 
-int esphome_ota_run(int socket, struct flash_img_context *ctx)
+/* Update received through another transport, in pieces of any size */
+static struct {
+	struct flash_img_context ctx;
+	/* Buffer being filled, submitted once full */
+	struct esphome_ota_buffer *buffer;
+	size_t size;
+	size_t total;
+	char md5[32 + 1];
+} esphome_ota_session;
+
+int esphome_ota_begin(size_t size, const char *md5, size_t *offset)
 {
-	size_t ota_size;
-	uint8_t ota_features;
-	char buf[1024];
-	size_t total = 0;
-	size_t size_acknowledged = 0;
-
+	uint8_t features = 0;
+	size_t resume = 0;
 	int ret;
 
-	ret = esphome_ota_read_magic(socket);
-	if (ret) {
-		LOG_ERR("Invalid magic value");
-		goto error;
+	if (strlen(md5) != sizeof(esphome_ota_session.md5) - 1) {
+		return -EINVAL;
 	}
 
-	ret = esphome_ota_send_version(socket);
-	if (ret) {
-		LOG_ERR("Failed to send version");
-		goto error;
+	if (!atomic_cas(&esphome_ota_busy, 0, 1)) {
+		return -EBUSY;
 	}
 
-	ret = esphome_ota_read_features(socket, &ota_features);
+	ret = flash_img_init(&esphome_ota_session.ctx);
 	if (ret) {
-		LOG_ERR("Failed to read ota features");
-		goto error;
+		atomic_clear(&esphome_ota_busy);
+		return ret;
 	}
 
-	/* TODO: read password and check password */
-	ret = esphome_ota_send_auth_ok(socket);
-	if (ret) {
-		LOG_ERR("Failed to send auth ok");
-		goto error;
+	if (size > esphome_ota_session.ctx.flash_area->fa_size) {
+		atomic_clear(&esphome_ota_busy);
+		return -EFBIG;
 	}
 
-	ret = esphome_ota_read_size(socket, &ota_size);
-	if (ret) {
-		LOG_ERR("Failed to read ota size");
-		goto error;
+	strcpy(esphome_ota_session.md5, md5);
+
+	if (offset && IS_ENABLED(CONFIG_ESPHOME_OTA_RESUME)) {
+		features = OTA_FEATURE_SUPPORTS_RESUME;
+		resume = esphome_ota_resume_offset(md5, size);
+		if (resume && esphome_ota_resume_seek(&esphome_ota_session.ctx, resume)) {
+			resume = 0;
+		}
+		esphome_ota_resume_start(&esphome_ota_writer, esphome_ota_session.md5, size,
+					 resume);
 	}
 
-	/* TODO: check memory size */
+	esphome_ota_session.buffer = NULL;
+	esphome_ota_session.size = size;
+	esphome_ota_session.total = resume;
+	esphome_ota_writer_start(&esphome_ota_writer, &esphome_ota_session.ctx, features, resume);
 
-	ret = esphome_ota_send_prepare_ok(socket);
-	if (ret) {
-		goto error;
+	if (offset) {
+		*offset = resume;
 	}
 
-	ret = esphome_ota_read_md5(socket, buf, 32 + 1);
-	if (ret) {
-		goto error;
+	return 0;
+}
+
+int esphome_ota_feed(const uint8_t *data, size_t len)
+{
+	struct esphome_ota_buffer *buffer = esphome_ota_session.buffer;
+	size_t n;
+
+	if (len > esphome_ota_session.size - esphome_ota_session.total) {
+		return -EMSGSIZE;
 	}
 
-	while (total < ota_size) {
-		size_t requested = MIN(sizeof(buf), ota_size - total);
-		ret = esphome_ota_read_data(socket, buf, requested);
-		if (ret) {
-			goto error;
+	while (len) {
+		if (!buffer) {
+			buffer = esphome_ota_writer_get(&esphome_ota_writer);
+			if (!buffer) {
+				return -EIO;
+			}
+			buffer->len = 0;
 		}
 
-		/* TODO: write data to flash */
-		bool last = (ota_size - total) <= sizeof(buf) ? true : false;
-		if (flash_img_buffered_write(ctx, buf, requested, last) != 0) {
-			goto error;
-		}
+		n = MIN(len, sizeof(buffer->data) - buffer->len);
+		memcpy(&buffer->data[buffer->len], data, n);
+		buffer->len += n;
+		esphome_ota_session.total += n;
+		data += n;
+		len -= n;
 
-		total += requested;
-		while (size_acknowledged + OTA_BLOCK_SIZE <= total ||
-		       (total == ota_size && size_acknowledged < ota_size)) {
-			buf[0] = OTA_RESPONSE_CHUNK_OK;
-			ret = zsock_send(socket, buf, 1, 0);
-			if (ret != 1) {
-				goto error;
-			}
-			size_acknowledged += OTA_BLOCK_SIZE;
+		if (buffer->len == sizeof(buffer->data)) {
+			esphome_ota_writer_submit(&esphome_ota_writer, buffer);
+			buffer = NULL;
 		}
 	}
 
-	buf[0] = OTA_RESPONSE_RECEIVE_OK;
-	ret = zsock_send(socket, buf, 1, 0);
-	if (ret != 1) {
-		goto error;
-	}
+	esphome_ota_session.buffer = buffer;
 
-	/* TODO: check firmware md5, flash write ok, etc */
-	boot_request_upgrade(1);
+	return 0;
+}
 
-	buf[0] = OTA_RESPONSE_UPDATE_END_OK;
-	ret = zsock_send(socket, buf, 1, 0);
-	if (ret != 1) {
-		goto error;
+size_t esphome_ota_received(void)
+{
+	return esphome_ota_session.total;
+}
+
+int esphome_ota_end(void)
+{
+	struct esphome_ota_buffer *buffer = esphome_ota_session.buffer;
+	int ret;
+
+	if (buffer) {
+		esphome_ota_writer_submit(&esphome_ota_writer, buffer);
 	}
 
-	ret = esphome_ota_read_ack(socket);
-	if (ret) {
-		goto error;
+	ret = esphome_ota_writer_stop(&esphome_ota_writer);
+	if (!ret && esphome_ota_session.total != esphome_ota_session.size) {
+		ret = -EMSGSIZE;
+	}
+
+	if (!ret) {
+		ret = esphome_ota_md5_check(&esphome_ota_writer, esphome_ota_session.md5);
+		esphome_ota_resume_clear();
 	}
 
-	LOG_INF("Rebooting ...");
-	sys_reboot(SYS_REBOOT_WARM);
+	if (!ret) {
+		boot_request_upgrade(1);
+	}
 
-	/* We are not supposed to reach this point */
-	return -ENOTSUP;
+	atomic_clear(&esphome_ota_busy);
 
-error:
 	return ret;
 }
 
-int esphome_ota_service(void *arg1, void *arg2, void *arg3)
+void esphome_ota_abort(void)
+{
+	struct esphome_ota_buffer *buffer = esphome_ota_session.buffer;
+
+	if (buffer) {
+		k_fifo_put(&esphome_ota_writer.free, buffer);
+	}
+
+	esphome_ota_writer_stop(&esphome_ota_writer);
+	atomic_clear(&esphome_ota_busy);
+}
+
+int esphome_ota_current_version(char *version, size_t len)
+{
+	struct mcuboot_img_header header;
+	int ret;
+
+	ret = boot_read_bank_header(FIXED_PARTITION_ID(slot0_partition), &header, sizeof(header));
+	if (ret) {
+		return ret;
+	}
+
+	snprintf(version, len, "%u.%u.%u+%u", header.h.v1.sem_ver.major,
+		 header.h.v1.sem_ver.minor, header.h.v1.sem_ver.revision,
+		 header.h.v1.sem_ver.build_num);
+
+	return 0;
+}
+
+static void esphome_ota_confirm(void)
 {
-	int port = 8266;
+	if (!boot_is_img_confirmed()) {
+		boot_write_img_confirmed();
+	}
+}
+
+#ifdef CONFIG_ESPHOME_OTA_SERVER
+#define ESPHOME_OTA_PORT 8266
 
+static int esphome_ota_listen(int port)
+{
 	int opt;
 	socklen_t optlen = sizeof(int);
 	int ret;
 
 	int server_fd;
-	socklen_t len;
 	void *addrp;
 	uint16_t *portp;
-	struct sockaddr client_addr;
 	char addrstr[INET6_ADDRSTRLEN];
 
-	static struct sockaddr server_addr;
-
-	if (!boot_is_img_confirmed()) {
-		boot_write_img_confirmed();
-	}
-
-	struct flash_img_context ctx;
-	ret = flash_img_init(&ctx);
-	if (ret != 0) {
-		return ret;
-	}
+	struct sockaddr server_addr = {0};
 
 	if (IS_ENABLED(CONFIG_NET_IPV6)) {
 		net_sin6(&server_addr)->sin6_family = AF_INET6;
@@ -346,7 +1344,7 @@ int esphome_ota_service(void *arg1, void *arg2, void *arg3)
 	server_fd = zsock_socket(server_addr.sa_family, SOCK_STREAM, 0);
 	if (server_fd < 0) {
 		LOG_DBG("socket() failed (%d)", errno);
-		return errno;
+		return -errno;
 	}
 
 	LOG_DBG("server_fd is %d", server_fd);
@@ -370,7 +1368,7 @@ int esphome_ota_service(void *arg1, void *arg2, void *arg3)
 	if (ret < 0) {
 		LOG_DBG("bind() failed (%d)", errno);
 		zsock_close(server_fd);
-		return errno;
+		return -errno;
 	}
 
 	if (server_addr.sa_family == AF_INET6) {
@@ -388,36 +1386,186 @@ int esphome_ota_service(void *arg1, void *arg2, void *arg3)
 	if (ret < 0) {
 		LOG_DBG("listen() failed (%d)", errno);
 		zsock_close(server_fd);
-		return errno;
+		return -errno;
 	}
 
 	LOG_INF("OTA server waits for a connection on port %d...\n", port);
 
-	while (1) {
-		int socket;
+	return server_fd;
+}
 
-		len = sizeof(client_addr);
-		socket = zsock_accept(server_fd, (struct sockaddr *)&client_addr, &len);
-		if (socket < 0) {
-			LOG_DBG("accept() failed (%d)", errno);
-			continue;
+/* Accept the next OTA connection, it is then served with esphome_ota_conn_ready() */
+static int esphome_ota_accept(int server_fd, struct esphome_ota_conn *conn)
+{
+	struct sockaddr client_addr;
+	socklen_t len = sizeof(client_addr);
+	int socket;
+	int ret;
+
+	socket = zsock_accept(server_fd, &client_addr, &len);
+	if (socket < 0) {
+		LOG_DBG("accept() failed (%d)", errno);
+		return -errno;
+	}
+
+	LOG_DBG("accepted connection");
+
+	if (!atomic_cas(&esphome_ota_busy, 0, 1)) {
+		LOG_WRN("An update is already in progress");
+		ret = -EBUSY;
+		goto close;
+	}
+
+	ret = flash_img_init(&conn->ctx);
+	if (ret) {
+		LOG_ERR("Failed to initialize the flash image [%d]", ret);
+		goto done;
+	}
+
+	conn->socket = socket;
+	conn->step = ESPHOME_OTA_MAGIC;
+	conn->field_len = 0;
+	conn->buffer = NULL;
+
+	return 0;
+
+done:
+	atomic_clear(&esphome_ota_busy);
+close:
+	zsock_close(socket);
+	return ret;
+}
+
+/* The update failed, or the client is gone */
+static void esphome_ota_close(struct esphome_ota_conn *conn, int ret)
+{
+	if (ret) {
+		LOG_ERR("Downloading and flashing OTA failed!");
+	}
+
+	if (conn->step == ESPHOME_OTA_DATA) {
+		if (conn->buffer) {
+			k_fifo_put(&esphome_ota_writer.free, conn->buffer);
+			conn->buffer = NULL;
 		}
+		(void)esphome_ota_writer_stop(&esphome_ota_writer);
+	}
 
-		zsock_inet_ntop(server_addr.sa_family, addrp, addrstr, sizeof(addrstr));
-		LOG_DBG("accepted connection from [%s]:%u", addrstr, ntohs(*portp));
+	atomic_clear(&esphome_ota_busy);
+	zsock_close(conn->socket);
+	LOG_INF("Connection closed\n");
+}
+#endif /* CONFIG_ESPHOME_OTA_SERVER */
 
-		ret = esphome_ota_run(socket, &ctx);
-		if (ret) {
-			LOG_ERR("Downloading and flashing OTA failed!");
+static int esphome_ota_writer_init(void)
+{
+	const struct k_work_queue_config config = {
+		.name = "esphome_ota_writer",
+	};
+
+	k_work_queue_start(&esphome_ota_writer_workq, esphome_ota_writer_stack,
+			   K_THREAD_STACK_SIZEOF(esphome_ota_writer_stack),
+			   CONFIG_ESPHOME_OTA_WRITER_PRIORITY, &config);
+
+	return 0;
+}
+
+SYS_INIT(esphome_ota_writer_init, POST_KERNEL, CONFIG_ESPHOME_INIT_PRIORITY);
+
+#ifndef CONFIG_ESPHOME_OTA_SERVER
+/* The updates are only received through the API, there is nothing to start */
+static int esphome_ota_init(void)
+{
+	esphome_ota_confirm();
+
+	return 0;
+}
+
+SYS_INIT(esphome_ota_init, APPLICATION, CONFIG_ESPHOME_INIT_PRIORITY);
+#elif defined(CONFIG_ESPHOME_SINGLE_LOOP)
+/* Only one of them is polled, there is one connection at a time */
+static struct {
+	struct esphome_loop_fd server;
+	struct esphome_loop_fd client;
+} esphome_ota_loop;
+
+static void esphome_ota_client_ready(struct esphome_loop_fd *lfd)
+{
+	int ret;
+
+	ret = esphome_ota_conn_ready(&esphome_ota_conn);
+	if (!ret) {
+		return;
+	}
+
+	esphome_loop_remove(lfd);
+	esphome_ota_close(&esphome_ota_conn, ret);
+	esphome_loop_add(&esphome_ota_loop.server);
+}
+
+static void esphome_ota_server_ready(struct esphome_loop_fd *lfd)
+{
+	if (esphome_ota_accept(lfd->fd, &esphome_ota_conn)) {
+		return;
+	}
+
+	esphome_ota_loop.client.fd = esphome_ota_conn.socket;
+	esphome_loop_remove(lfd);
+	esphome_loop_add(&esphome_ota_loop.client);
+}
+
+static void esphome_ota_start(void *user_data)
+{
+	ARG_UNUSED(user_data);
+
+	esphome_ota_confirm();
+
+	esphome_ota_loop.server.fd = esphome_ota_listen(ESPHOME_OTA_PORT);
+	if (esphome_ota_loop.server.fd < 0) {
+		return;
+	}
+
+	esphome_ota_loop.server.ready = esphome_ota_server_ready;
+	esphome_ota_loop.client.ready = esphome_ota_client_ready;
+	esphome_loop_add(&esphome_ota_loop.server);
+}
+
+static int esphome_ota_init(void)
+{
+	return esphome_set_timeout(&esphome_ota_loop, "listen", 0, esphome_ota_start, NULL);
+}
+
+SYS_INIT(esphome_ota_init, APPLICATION, CONFIG_ESPHOME_INIT_PRIORITY);
+#else
+int esphome_ota_service(void *arg1, void *arg2, void *arg3)
+{
+	int server_fd;
+	int ret;
+
+	esphome_ota_confirm();
+
+	server_fd = esphome_ota_listen(ESPHOME_OTA_PORT);
+	if (server_fd < 0) {
+		return server_fd;
+	}
+
+	while (1) {
+		if (esphome_ota_accept(server_fd, &esphome_ota_conn)) {
+			continue;
 		}
 
-		zsock_close(socket);
-		LOG_INF("Connection from %s closed\n", addrstr);
+		do {
+			ret = esphome_ota_conn_ready(&esphome_ota_conn);
+		} while (!ret);
+
+		esphome_ota_close(&esphome_ota_conn, ret);
 	}
+
 	return 0;
 }
 
 #define ESPHOME_STACK_SIZE (4096)
 
 K_THREAD_DEFINE(esphome_ota_tid, ESPHOME_STACK_SIZE, esphome_ota_service, NULL, NULL, NULL,
-		0 /* todo: set priority */, 0, 0);
\ No newline at end of file
+		0 /* todo: set priority */, 0, 0);
+#endif /* CONFIG_ESPHOME_OTA_SERVER */
@@ -1,6 +1,9 @@
 #ifndef ESPHOME_OTA_H
 #define ESPHOME_OTA_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 enum OTAResponseTypes {
 	OTA_RESPONSE_OK = 0x00,
 	OTA_RESPONSE_REQUEST_AUTH = 0x01,
@@ -13,6 +16,11 @@ enum OTAResponseTypes {
 	OTA_RESPONSE_UPDATE_END_OK = 0x45,
 	OTA_RESPONSE_SUPPORTS_COMPRESSION = 0x46,
 	OTA_RESPONSE_CHUNK_OK = 0x47,
+	/* Not part of ESPHome, the client sends a delta, gzip compressed or not */
+	OTA_RESPONSE_SUPPORTS_DELTA = 0x48,
+	OTA_RESPONSE_SUPPORTS_COMPRESSED_DELTA = 0x49,
+	/* Not part of ESPHome, replaces BIN_MD5_OK, followed by the offset to resume at (BE32) */
+	OTA_RESPONSE_BIN_MD5_OK_RESUME = 0x4A,
 
 	OTA_RESPONSE_ERROR_MAGIC = 0x80,
 	OTA_RESPONSE_ERROR_UPDATE_PREPARE = 0x81,
@@ -30,6 +38,14 @@ enum OTAResponseTypes {
 	OTA_RESPONSE_ERROR_UNKNOWN = 0xFF,
 };
 
+enum OTAFeatures {
+	OTA_FEATURE_SUPPORTS_COMPRESSION = 0x01,
+	/* Not part of ESPHome, resume the upload of an uncompressed image */
+	OTA_FEATURE_SUPPORTS_RESUME = 0x40,
+	/* Not part of ESPHome, see esphome_delta.h */
+	OTA_FEATURE_SUPPORTS_DELTA = 0x80,
+};
+
 enum OTAState {
 	OTA_COMPLETED = 0,
 	OTA_STARTED,
@@ -38,6 +54,24 @@ enum OTAState {
 	OTA_ERROR,
 };
 
-uint8_t MAGIC_BYTES[] = {0x6C, 0x26, 0xF7, 0x5C, 0x45};
+/*
+ * Updates received through another transport than the OTA server, e.g. the
+ * update entity of the API. Only one update runs at a time, esphome_ota_begin()
+ * returns -EBUSY otherwise. If offset is given, the transport can resume the
+ * image: it is set to where the upload of the same image was interrupted, and
+ * the data is expected from there. esphome_ota_feed() blocks while the flash
+ * is behind and accepts pieces of any size. esphome_ota_end() checks the size
+ * and the MD5 of the image, then requests the upgrade; the caller reboots.
+ */
+int esphome_ota_begin(size_t size, const char *md5, size_t *offset);
+int esphome_ota_feed(const uint8_t *data, size_t len);
+size_t esphome_ota_received(void);
+int esphome_ota_end(void);
+void esphome_ota_abort(void);
+
+/* Version of the running image, from its MCUboot header */
+int esphome_ota_current_version(char *version, size_t len);
+
+static const uint8_t MAGIC_BYTES[] = {0x6C, 0x26, 0xF7, 0x5C, 0x45};
 
 #endif /* ESPHOME_OTA_H */
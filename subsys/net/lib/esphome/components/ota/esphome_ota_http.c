@@ -0,0 +1,721 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zephyr/data/json.h>
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/http/client.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/reboot.h>
+
+#include <esphome/components/ota_http.h>
+#include <esphome/scheduler.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(ESPHomeOTA);
+
+#include "esphome_ota.h"
+
+#define ESPHOME_OTA_HTTP_TIMEOUT_MS 10000
+
+struct esphome_ota_http_url {
+	bool tls;
+	char host[64];
+	char port[6];
+	char path[ESPHOME_OTA_HTTP_URL_MAX];
+};
+
+struct esphome_ota_http_request {
+	/* Called with each piece of the body of a successful response */
+	int (*body)(struct esphome_ota_http_request *request, const uint8_t *data, size_t len);
+	struct http_request http;
+	int status;
+	int error;
+	/* The header fields may come in pieces, only Content-Range is kept */
+	char field[sizeof("Content-Range")];
+	size_t field_len;
+	bool in_value;
+	char content_range[48];
+	size_t content_range_len;
+};
+
+struct esphome_ota_http_manifest_request {
+	struct esphome_ota_http_request request;
+	char buf[CONFIG_ESPHOME_OTA_HTTP_MANIFEST_SIZE];
+	size_t len;
+};
+
+struct esphome_ota_http_download {
+	struct esphome_ota_http_request request;
+	size_t size;
+	/* Offset of the range requested, and the bytes still expected */
+	size_t offset;
+	size_t left;
+	/* Set once the status of the response is known */
+	bool started;
+	/* Bytes of the body to drop, when the server ignored the range */
+	size_t skip;
+	/* The flash failed, don't retry */
+	int write_error;
+};
+
+struct esphome_ota_http_json {
+	const char *version;
+	const char *url;
+	int32_t size;
+	const char *md5;
+};
+
+static const struct json_obj_descr esphome_ota_http_json_descr[] = {
+	JSON_OBJ_DESCR_PRIM(struct esphome_ota_http_json, version, JSON_TOK_STRING),
+	JSON_OBJ_DESCR_PRIM(struct esphome_ota_http_json, url, JSON_TOK_STRING),
+	JSON_OBJ_DESCR_PRIM(struct esphome_ota_http_json, size, JSON_TOK_NUMBER),
+	JSON_OBJ_DESCR_PRIM(struct esphome_ota_http_json, md5, JSON_TOK_STRING),
+};
+
+/* Protects the receive buffer, the requests may come from several threads */
+static K_MUTEX_DEFINE(esphome_ota_http_lock);
+static uint8_t esphome_ota_http_recv_buf[CONFIG_ESPHOME_OTA_HTTP_RECV_BUF_SIZE];
+
+/* The downloads run on their own thread, they would block the scheduler for minutes */
+static struct k_work_q esphome_ota_http_workq;
+static K_THREAD_STACK_DEFINE(esphome_ota_http_stack, CONFIG_ESPHOME_OTA_HTTP_STACK_SIZE);
+
+static struct {
+	struct k_work work;
+	atomic_t busy;
+	char url[ESPHOME_OTA_HTTP_URL_MAX];
+	const struct esphome_ota_http_listener *listener;
+} esphome_ota_http_job;
+
+/* The manifest fetch may also wait for the timeouts, it runs on the same thread */
+static struct {
+	struct k_work work;
+	atomic_t busy;
+	char url[ESPHOME_OTA_HTTP_URL_MAX];
+	esphome_ota_http_check_handler_t handler;
+} esphome_ota_http_check_job;
+
+static int esphome_ota_http_parse_url(const char *str, struct esphome_ota_http_url *url)
+{
+	const char *host;
+	const char *port;
+	const char *path;
+	size_t len;
+
+	if (!strncmp(str, "http://", 7)) {
+		url->tls = false;
+		host = str + 7;
+	} else if (IS_ENABLED(CONFIG_ESPHOME_OTA_HTTP_TLS) && !strncmp(str, "https://", 8)) {
+		url->tls = true;
+		host = str + 8;
+	} else {
+		return -EPROTONOSUPPORT;
+	}
+
+	path = strchr(host, '/');
+	if (!path) {
+		path = host + strlen(host);
+	}
+
+	port = memchr(host, ':', path - host);
+	len = (port ? port : path) - host;
+	if (!len || len >= sizeof(url->host)) {
+		return -EINVAL;
+	}
+	memcpy(url->host, host, len);
+	url->host[len] = '\0';
+
+	if (port) {
+		len = path - port - 1;
+		if (!len || len >= sizeof(url->port)) {
+			return -EINVAL;
+		}
+		memcpy(url->port, port + 1, len);
+		url->port[len] = '\0';
+	} else {
+		strcpy(url->port, url->tls ? "443" : "80");
+	}
+
+	if (strlen(path) >= sizeof(url->path)) {
+		return -EINVAL;
+	}
+	strcpy(url->path, *path ? path : "/");
+
+	return 0;
+}
+
+/* The url of the image may be relative to the one of the manifest */
+static int esphome_ota_http_resolve(const struct esphome_ota_http_url *base, const char *ref,
+				    struct esphome_ota_http_url *url)
+{
+	size_t len;
+
+	if (strstr(ref, "://")) {
+		return esphome_ota_http_parse_url(ref, url);
+	}
+
+	*url = *base;
+	if (ref[0] == '/') {
+		len = 0;
+	} else {
+		len = strrchr(base->path, '/') - base->path + 1;
+	}
+
+	if (len + strlen(ref) >= sizeof(url->path)) {
+		return -EINVAL;
+	}
+	strcpy(&url->path[len], ref);
+
+	return 0;
+}
+
+static int esphome_ota_http_connect(const struct esphome_ota_http_url *url)
+{
+	struct zsock_addrinfo hints = {
+		.ai_family = AF_UNSPEC,
+		.ai_socktype = SOCK_STREAM,
+	};
+	struct zsock_addrinfo *res;
+	int sock;
+	int ret;
+
+	ret = zsock_getaddrinfo(url->host, url->port, &hints, &res);
+	if (ret) {
+		LOG_ERR("Failed to resolve %s [%d]", url->host, ret);
+		return -EHOSTUNREACH;
+	}
+
+	sock = zsock_socket(res->ai_family, SOCK_STREAM, url->tls ? IPPROTO_TLS_1_2 : IPPROTO_TCP);
+	if (sock < 0) {
+		ret = -errno;
+		goto out;
+	}
+
+#ifdef CONFIG_ESPHOME_OTA_HTTP_TLS
+	if (url->tls) {
+		sec_tag_t sec_tag = CONFIG_ESPHOME_OTA_HTTP_TLS_SEC_TAG;
+
+		ret = zsock_setsockopt(sock, SOL_TLS, TLS_SEC_TAG_LIST, &sec_tag, sizeof(sec_tag));
+		if (!ret) {
+			ret = zsock_setsockopt(sock, SOL_TLS, TLS_HOSTNAME, url->host,
+					       strlen(url->host) + 1);
+		}
+		if (ret) {
+			ret = -errno;
+			zsock_close(sock);
+			goto out;
+		}
+	}
+#endif
+
+	ret = zsock_connect(sock, res->ai_addr, res->ai_addrlen);
+	if (ret) {
+		ret = -errno;
+		zsock_close(sock);
+		goto out;
+	}
+
+	ret = sock;
+out:
+	zsock_freeaddrinfo(res);
+	return ret;
+}
+
+static struct esphome_ota_http_request *esphome_ota_http_request_get(struct http_parser *parser)
+{
+	struct http_request *http = CONTAINER_OF(parser, struct http_request, internal.parser);
+
+	return CONTAINER_OF(http, struct esphome_ota_http_request, http);
+}
+
+static int esphome_ota_http_header_field(struct http_parser *parser, const char *at,
+					 size_t length)
+{
+	struct esphome_ota_http_request *request = esphome_ota_http_request_get(parser);
+	size_t n;
+
+	if (request->in_value) {
+		request->in_value = false;
+		request->field_len = 0;
+	}
+
+	/* Longer names can't match, keep them too long to compare equal */
+	n = MIN(length, sizeof(request->field) - request->field_len);
+	memcpy(&request->field[request->field_len], at, n);
+	request->field_len += n;
+
+	return 0;
+}
+
+static int esphome_ota_http_header_value(struct http_parser *parser, const char *at,
+					 size_t length)
+{
+	struct esphome_ota_http_request *request = esphome_ota_http_request_get(parser);
+	size_t n;
+
+	request->in_value = true;
+	if (request->field_len != sizeof(request->field) - 1 ||
+	    strncasecmp(request->field, "Content-Range", request->field_len)) {
+		return 0;
+	}
+
+	n = MIN(length, sizeof(request->content_range) - 1 - request->content_range_len);
+	memcpy(&request->content_range[request->content_range_len], at, n);
+	request->content_range_len += n;
+	request->content_range[request->content_range_len] = '\0';
+
+	return 0;
+}
+
+static const struct http_parser_settings esphome_ota_http_parser_settings = {
+	.on_header_field = esphome_ota_http_header_field,
+	.on_header_value = esphome_ota_http_header_value,
+};
+
+static int esphome_ota_http_response(struct http_response *rsp, enum http_final_call final_data,
+				     void *user_data)
+{
+	struct esphome_ota_http_request *request = user_data;
+
+	ARG_UNUSED(final_data);
+
+	request->status = rsp->http_status_code;
+	if (request->status != 200 && request->status != 206) {
+		return 0;
+	}
+
+	if (!request->error && rsp->body_frag_start && rsp->body_frag_len) {
+		request->error = request->body(request, rsp->body_frag_start, rsp->body_frag_len);
+	}
+
+	return request->error;
+}
+
+/* range is an additional header, e.g. "Range: bytes=0-1023\r\n" */
+static int esphome_ota_http_get(const struct esphome_ota_http_url *url, const char *range,
+				struct esphome_ota_http_request *request)
+{
+	const char *headers[] = {range, NULL};
+	struct http_request *req = &request->http;
+	int sock;
+	int ret;
+
+	sock = esphome_ota_http_connect(url);
+	if (sock < 0) {
+		return sock;
+	}
+
+	memset(req, 0, sizeof(*req));
+	req->method = HTTP_GET;
+	req->url = url->path;
+	req->host = url->host;
+	req->port = url->port;
+	req->protocol = "HTTP/1.1";
+	req->header_fields = range ? headers : NULL;
+	req->http_cb = &esphome_ota_http_parser_settings;
+	req->response = esphome_ota_http_response;
+	req->recv_buf = esphome_ota_http_recv_buf;
+	req->recv_buf_len = sizeof(esphome_ota_http_recv_buf);
+
+	request->status = 0;
+	request->error = 0;
+	request->field_len = 0;
+	request->in_value = false;
+	request->content_range_len = 0;
+	request->content_range[0] = '\0';
+	ret = http_client_req(sock, req, ESPHOME_OTA_HTTP_TIMEOUT_MS, request);
+	zsock_close(sock);
+
+	if (request->error) {
+		return request->error;
+	}
+
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (request->status != 200 && request->status != 206) {
+		LOG_ERR("GET %s returned %d", url->path, request->status);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static int esphome_ota_http_manifest_body(struct esphome_ota_http_request *request,
+					  const uint8_t *data, size_t len)
+{
+	struct esphome_ota_http_manifest_request *manifest =
+		CONTAINER_OF(request, struct esphome_ota_http_manifest_request, request);
+
+	if (len > sizeof(manifest->buf) - manifest->len) {
+		return -EMSGSIZE;
+	}
+
+	memcpy(&manifest->buf[manifest->len], data, len);
+	manifest->len += len;
+
+	return 0;
+}
+
+static int esphome_ota_http_parse_manifest(char *buf, size_t len,
+					   struct esphome_ota_http_manifest *manifest)
+{
+	struct esphome_ota_http_json json;
+	int ret;
+
+	ret = json_obj_parse(buf, len, esphome_ota_http_json_descr,
+			     ARRAY_SIZE(esphome_ota_http_json_descr), &json);
+	if (ret != BIT_MASK(ARRAY_SIZE(esphome_ota_http_json_descr))) {
+		return -EBADMSG;
+	}
+
+	if (json.size <= 0 || strlen(json.md5) != sizeof(manifest->md5) - 1 ||
+	    strlen(json.version) >= sizeof(manifest->version) ||
+	    strlen(json.url) >= sizeof(manifest->url)) {
+		return -EBADMSG;
+	}
+
+	strcpy(manifest->version, json.version);
+	strcpy(manifest->url, json.url);
+	manifest->size = json.size;
+	strcpy(manifest->md5, json.md5);
+
+	return 0;
+}
+
+int esphome_ota_http_check(const char *url, struct esphome_ota_http_manifest *manifest)
+{
+	static struct esphome_ota_http_manifest_request request = {
+		.request.body = esphome_ota_http_manifest_body,
+	};
+	struct esphome_ota_http_url manifest_url;
+	int ret;
+
+	ret = esphome_ota_http_parse_url(url, &manifest_url);
+	if (ret) {
+		return ret;
+	}
+
+	k_mutex_lock(&esphome_ota_http_lock, K_FOREVER);
+
+	request.len = 0;
+	ret = esphome_ota_http_get(&manifest_url, NULL, &request.request);
+	if (!ret) {
+		ret = esphome_ota_http_parse_manifest(request.buf, request.len, manifest);
+	}
+
+	k_mutex_unlock(&esphome_ota_http_lock);
+
+	if (ret) {
+		LOG_ERR("Failed to get the manifest %s [%d]", url, ret);
+	}
+
+	return ret;
+}
+
+/* A partial response must hold the range requested, "bytes <first>-<last>/<size>" */
+static int esphome_ota_http_check_range(const struct esphome_ota_http_download *download,
+					const char *content_range)
+{
+	unsigned long first;
+	unsigned long last;
+	char *end;
+
+	if (strncmp(content_range, "bytes ", 6)) {
+		return -EBADMSG;
+	}
+
+	first = strtoul(content_range + 6, &end, 10);
+	if (*end != '-') {
+		return -EBADMSG;
+	}
+
+	last = strtoul(end + 1, &end, 10);
+	if (*end != '/' || first != download->offset || last < first ||
+	    last - first + 1 > download->left) {
+		return -EBADMSG;
+	}
+
+	if (strcmp(end + 1, "*") && strtoul(end + 1, NULL, 10) != download->size) {
+		return -EBADMSG;
+	}
+
+	return 0;
+}
+
+static int esphome_ota_http_image_body(struct esphome_ota_http_request *request,
+				       const uint8_t *data, size_t len)
+{
+	struct esphome_ota_http_download *download =
+		CONTAINER_OF(request, struct esphome_ota_http_download, request);
+	size_t n;
+	int ret;
+
+	/* The whole image is sent if the server doesn't support ranges */
+	if (!download->started) {
+		download->started = true;
+		if (request->status == 200) {
+			download->skip = download->offset;
+			download->left = download->size - download->offset;
+		} else {
+			ret = esphome_ota_http_check_range(download, request->content_range);
+			if (ret) {
+				LOG_ERR("Unexpected range \"%s\"", request->content_range);
+				return ret;
+			}
+		}
+	}
+
+	n = MIN(len, download->skip);
+	download->skip -= n;
+	data += n;
+	len -= n;
+
+	n = MIN(len, download->left);
+	download->left -= n;
+
+	download->write_error = esphome_ota_feed(data, n);
+
+	return download->write_error;
+}
+
+static void esphome_ota_http_progress(size_t received, size_t size)
+{
+	const struct esphome_ota_http_listener *listener = esphome_ota_http_job.listener;
+
+	if (listener && listener->progress) {
+		listener->progress(received, size);
+	}
+}
+
+/*
+ * Each range is requested on its own connection. A failed request is retried
+ * from what was received, until a few of them in a row made no progress.
+ */
+static int esphome_ota_http_download(const struct esphome_ota_http_url *url, size_t size)
+{
+	struct esphome_ota_http_download download = {
+		.request.body = esphome_ota_http_image_body,
+		.size = size,
+	};
+	char range[48];
+	int retries = 0;
+	size_t offset;
+	size_t end;
+	int ret;
+
+	while ((offset = esphome_ota_received()) < size) {
+		end = MIN(offset + CONFIG_ESPHOME_OTA_HTTP_RANGE_SIZE, size);
+		snprintf(range, sizeof(range), "Range: bytes=%zu-%zu\r\n", offset, end - 1);
+		download.offset = offset;
+		download.left = end - offset;
+		download.started = false;
+		download.skip = 0;
+		download.write_error = 0;
+
+		ret = esphome_ota_http_get(url, range, &download.request);
+		if (download.write_error) {
+			return download.write_error;
+		}
+
+		if (esphome_ota_received() > offset) {
+			retries = 0;
+			esphome_ota_http_progress(esphome_ota_received(), size);
+		} else if (++retries > CONFIG_ESPHOME_OTA_HTTP_RETRIES) {
+			return ret ? ret : -EIO;
+		}
+
+		if (ret) {
+			LOG_WRN("Download interrupted at %zu [%d]", esphome_ota_received(), ret);
+			k_sleep(K_SECONDS(retries));
+		}
+	}
+
+	return 0;
+}
+
+int esphome_ota_http_install(const char *url, const struct esphome_ota_http_manifest *manifest)
+{
+	struct esphome_ota_http_url manifest_url;
+	struct esphome_ota_http_url image_url;
+	int64_t start = k_uptime_get();
+	size_t offset;
+	int ret;
+
+	ret = esphome_ota_http_parse_url(url, &manifest_url);
+	if (!ret) {
+		ret = esphome_ota_http_resolve(&manifest_url, manifest->url, &image_url);
+	}
+	if (ret) {
+		return ret;
+	}
+
+	ret = esphome_ota_begin(manifest->size, manifest->md5, &offset);
+	if (ret) {
+		LOG_ERR("Failed to start the update [%d]", ret);
+		return ret;
+	}
+
+	LOG_INF("Downloading %s %u bytes from %s:%s%s, at %zu", manifest->version, manifest->size,
+		image_url.host, image_url.port, image_url.path, offset);
+
+	k_mutex_lock(&esphome_ota_http_lock, K_FOREVER);
+	ret = esphome_ota_http_download(&image_url, manifest->size);
+	k_mutex_unlock(&esphome_ota_http_lock);
+
+	if (ret) {
+		LOG_ERR("Failed to download the update [%d]", ret);
+		/* What was written is kept, the next attempt resumes from there */
+		esphome_ota_abort();
+		return ret;
+	}
+
+	ret = esphome_ota_end();
+	if (ret) {
+		LOG_ERR("Update failed [%d]", ret);
+		return ret;
+	}
+
+	LOG_INF("Downloaded %zu bytes in %lld ms", manifest->size - offset,
+		k_uptime_get() - start);
+
+	return 0;
+}
+
+int esphome_ota_http_update(const char *url)
+{
+	struct esphome_ota_http_manifest manifest;
+	char version[sizeof(manifest.version)];
+	int ret;
+
+	ret = esphome_ota_http_check(url, &manifest);
+	if (ret) {
+		return ret;
+	}
+
+	if (!esphome_ota_current_version(version, sizeof(version)) &&
+	    !strcmp(version, manifest.version)) {
+		return -EALREADY;
+	}
+
+	return esphome_ota_http_install(url, &manifest);
+}
+
+static void esphome_ota_http_work(struct k_work *work)
+{
+	const struct esphome_ota_http_listener *listener = esphome_ota_http_job.listener;
+	int ret;
+
+	ARG_UNUSED(work);
+
+	ret = esphome_ota_http_update(esphome_ota_http_job.url);
+	esphome_ota_http_job.listener = NULL;
+	atomic_clear(&esphome_ota_http_job.busy);
+
+	if (listener && listener->done) {
+		listener->done(ret);
+	} else if (!ret) {
+		LOG_INF("Rebooting ...");
+		sys_reboot(SYS_REBOOT_WARM);
+	}
+}
+
+int esphome_ota_http_update_async(const char *url,
+				  const struct esphome_ota_http_listener *listener)
+{
+	if (strlen(url) >= sizeof(esphome_ota_http_job.url)) {
+		return -EINVAL;
+	}
+
+	if (!atomic_cas(&esphome_ota_http_job.busy, 0, 1)) {
+		return -EBUSY;
+	}
+
+	strcpy(esphome_ota_http_job.url, url);
+	esphome_ota_http_job.listener = listener;
+	k_work_submit_to_queue(&esphome_ota_http_workq, &esphome_ota_http_job.work);
+
+	return 0;
+}
+
+static void esphome_ota_http_check_work(struct k_work *work)
+{
+	esphome_ota_http_check_handler_t handler = esphome_ota_http_check_job.handler;
+	struct esphome_ota_http_manifest manifest;
+	int ret;
+
+	ARG_UNUSED(work);
+
+	ret = esphome_ota_http_check(esphome_ota_http_check_job.url, &manifest);
+	atomic_clear(&esphome_ota_http_check_job.busy);
+
+	handler(ret, &manifest);
+}
+
+int esphome_ota_http_check_async(const char *url, esphome_ota_http_check_handler_t handler)
+{
+	if (strlen(url) >= sizeof(esphome_ota_http_check_job.url)) {
+		return -EINVAL;
+	}
+
+	if (!atomic_cas(&esphome_ota_http_check_job.busy, 0, 1)) {
+		return -EBUSY;
+	}
+
+	strcpy(esphome_ota_http_check_job.url, url);
+	esphome_ota_http_check_job.handler = handler;
+	k_work_submit_to_queue(&esphome_ota_http_workq, &esphome_ota_http_check_job.work);
+
+	return 0;
+}
+
+#if CONFIG_ESPHOME_OTA_HTTP_CHECK_INTERVAL > 0
+static void esphome_ota_http_check_cb(void *user_data)
+{
+	ARG_UNUSED(user_data);
+
+	/* Skipped while the previous check is still downloading */
+	esphome_ota_http_update_async(CONFIG_ESPHOME_OTA_HTTP_MANIFEST_URL, NULL);
+}
+
+static int esphome_ota_http_schedule_check(void)
+{
+	static const char component[] = "ota_http";
+
+	return esphome_set_interval(component, "check", CONFIG_ESPHOME_OTA_HTTP_CHECK_INTERVAL *
+				    MSEC_PER_SEC, esphome_ota_http_check_cb, NULL);
+}
+#else
+static inline int esphome_ota_http_schedule_check(void)
+{
+	return 0;
+}
+#endif
+
+static int esphome_ota_http_init(void)
+{
+	const struct k_work_queue_config config = {
+		.name = "esphome_ota_http",
+	};
+
+	k_work_init(&esphome_ota_http_job.work, esphome_ota_http_work);
+	k_work_init(&esphome_ota_http_check_job.work, esphome_ota_http_check_work);
+	k_work_queue_start(&esphome_ota_http_workq, esphome_ota_http_stack,
+			   K_THREAD_STACK_SIZEOF(esphome_ota_http_stack),
+			   K_LOWEST_APPLICATION_THREAD_PRIO, &config);
+
+	return esphome_ota_http_schedule_check();
+}
+
+SYS_INIT(esphome_ota_http_init, APPLICATION, CONFIG_ESPHOME_INIT_PRIORITY);
@@ -0,0 +1,353 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define DT_DRV_COMPAT nabucasa_esphome_update
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/devicetree.h>
+#include <zephyr/sys/base64.h>
+#include <zephyr/sys/reboot.h>
+
+#include <esphome/components/ota_http.h>
+#include <esphome/components/update.h>
+#include <esphome/scheduler.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(ESPHomeOTA);
+
+#include "esphome_ota.h"
+
+BUILD_ASSERT(DT_NUM_INST_STATUS_OKAY(DT_DRV_COMPAT) == 1,
+	     "There is a single upload slot, only one update entity is supported");
+
+/* Decoded in pieces, a multiple of 4 base64 characters decodes on its own */
+#define ESPHOME_UPDATE_DECODE_SIZE 192
+
+static const struct device *const esphome_update_dev = DEVICE_DT_INST_GET(0);
+
+static int esphome_update_list_service(const struct device *api_dev, const char *name,
+				       ListEntitiesServicesArgument **args, size_t n_args)
+{
+	ListEntitiesServicesResponse response = LIST_ENTITIES_SERVICES_RESPONSE__INIT;
+
+	response.name = (char *)name;
+	response.key = fnv1_hash(name);
+	response.n_args = n_args;
+	response.args = args;
+
+	return ListEntitiesServicesResponseWrite(api_dev, &response);
+}
+
+static int esphome_update_list_entity(const struct device *api_dev, struct esphome_entity *entity)
+{
+	ListEntitiesUpdateResponse response = LIST_ENTITIES_UPDATE_RESPONSE__INIT;
+	ListEntitiesServicesArgument size = LIST_ENTITIES_SERVICES_ARGUMENT__INIT;
+	ListEntitiesServicesArgument md5 = LIST_ENTITIES_SERVICES_ARGUMENT__INIT;
+	ListEntitiesServicesArgument data = LIST_ENTITIES_SERVICES_ARGUMENT__INIT;
+	ListEntitiesServicesArgument *begin_args[] = {&size, &md5};
+	ListEntitiesServicesArgument *write_args[] = {&data};
+
+	DT_ENTITY_CONFIG_TO_RESPONSE(&response, entity->config);
+	response.key = entity->data->key;
+	ListEntitiesUpdateResponseWrite(api_dev, &response);
+
+	size.name = "size";
+	size.type = SERVICE_ARG_TYPE__SERVICE_ARG_TYPE_INT;
+	md5.name = "md5";
+	md5.type = SERVICE_ARG_TYPE__SERVICE_ARG_TYPE_STRING;
+	data.name = "data";
+	data.type = SERVICE_ARG_TYPE__SERVICE_ARG_TYPE_STRING;
+
+	esphome_update_list_service(api_dev, ESPHOME_UPDATE_SERVICE_BEGIN, begin_args,
+				    ARRAY_SIZE(begin_args));
+	esphome_update_list_service(api_dev, ESPHOME_UPDATE_SERVICE_WRITE, write_args,
+				    ARRAY_SIZE(write_args));
+	esphome_update_list_service(api_dev, ESPHOME_UPDATE_SERVICE_END, NULL, 0);
+
+	return 0;
+}
+
+static int esphome_update_send_state(const struct device *api_dev, struct esphome_entity *entity)
+{
+	struct esphome_update_data *data = entity->dev->data;
+	UpdateStateResponse response = UPDATE_STATE_RESPONSE__INIT;
+
+	response.key = entity->data->key;
+	response.current_version = data->current_version;
+	response.latest_version = data->latest_version;
+	response.in_progress = data->api_dev != NULL || data->downloading;
+	response.has_progress = response.in_progress;
+	response.progress = data->progress;
+
+	return UpdateStateResponseWrite(api_dev, &response);
+}
+
+static void esphome_update_state_changed(const struct device *dev)
+{
+	esphome_entity_state_changed(find_entity_by_device(dev));
+}
+
+static void esphome_update_reboot(void *user_data)
+{
+	ARG_UNUSED(user_data);
+
+	LOG_INF("Rebooting ...");
+	sys_reboot(SYS_REBOOT_WARM);
+}
+
+static void esphome_update_stop(const struct device *dev)
+{
+	struct esphome_update_data *data = dev->data;
+
+	data->api_dev = NULL;
+	data->progress = 0;
+	esphome_update_state_changed(dev);
+}
+
+static int esphome_update_begin(const struct device *api_dev, ExecuteServiceRequest *request)
+{
+	struct esphome_update_data *data = esphome_update_dev->data;
+	int ret;
+
+	if (request->n_args != 2 || request->args[0]->int_ <= 0) {
+		return -EINVAL;
+	}
+
+	ret = esphome_ota_begin(request->args[0]->int_, request->args[1]->string_, NULL);
+	if (ret) {
+		LOG_ERR("Failed to start the update [%d]", ret);
+		return ret;
+	}
+
+	LOG_INF("Receiving %d bytes through the API", request->args[0]->int_);
+
+	data->api_dev = api_dev;
+	data->size = request->args[0]->int_;
+	data->progress = 0;
+	esphome_update_state_changed(esphome_update_dev);
+
+	return 0;
+}
+
+static int esphome_update_write(ExecuteServiceRequest *request)
+{
+	struct esphome_update_data *data = esphome_update_dev->data;
+	uint8_t buf[ESPHOME_UPDATE_DECODE_SIZE];
+	const char *encoded;
+	size_t encoded_len;
+	size_t len;
+	size_t n;
+	int ret;
+
+	if (request->n_args != 1) {
+		return -EINVAL;
+	}
+
+	encoded = request->args[0]->string_;
+	encoded_len = strlen(encoded);
+
+	for (size_t offset = 0; offset < encoded_len; offset += n) {
+		n = MIN(encoded_len - offset, ESPHOME_UPDATE_DECODE_SIZE / 3 * 4);
+		ret = base64_decode(buf, sizeof(buf), &len, &encoded[offset], n);
+		if (ret) {
+			return -EBADMSG;
+		}
+
+		ret = esphome_ota_feed(buf, len);
+		if (ret) {
+			return ret;
+		}
+	}
+
+	data->progress = 100.0f * esphome_ota_received() / data->size;
+	esphome_update_state_changed(esphome_update_dev);
+
+	return 0;
+}
+
+static int esphome_update_end(void)
+{
+	int ret;
+
+	ret = esphome_ota_end();
+	esphome_update_stop(esphome_update_dev);
+	if (ret) {
+		LOG_ERR("Update failed [%d]", ret);
+		return ret;
+	}
+
+	/* Leave some time to the client to receive the final state */
+	return esphome_set_timeout(esphome_update_dev, "reboot", 1000, esphome_update_reboot, NULL);
+}
+
+int esphome_update_execute_service(const struct device *api_dev, ExecuteServiceRequest *request)
+{
+	struct esphome_update_data *data = esphome_update_dev->data;
+	int ret;
+
+	if (request->key == fnv1_hash(ESPHOME_UPDATE_SERVICE_BEGIN)) {
+		return esphome_update_begin(api_dev, request);
+	}
+
+	if (request->key != fnv1_hash(ESPHOME_UPDATE_SERVICE_WRITE) &&
+	    request->key != fnv1_hash(ESPHOME_UPDATE_SERVICE_END)) {
+		return -ENOENT;
+	}
+
+	/* Only the connection that started the update may continue it */
+	if (data->api_dev != api_dev) {
+		return -EPERM;
+	}
+
+	if (request->key == fnv1_hash(ESPHOME_UPDATE_SERVICE_END)) {
+		return esphome_update_end();
+	}
+
+	ret = esphome_update_write(request);
+	if (ret) {
+		LOG_ERR("Failed to write the update [%d]", ret);
+		esphome_ota_abort();
+		esphome_update_stop(esphome_update_dev);
+	}
+
+	return ret;
+}
+
+#ifdef CONFIG_ESPHOME_OTA_HTTP
+/* The image may be pulled from the manifest server instead of being pushed */
+#define ESPHOME_UPDATE_HTTP (sizeof(CONFIG_ESPHOME_OTA_HTTP_MANIFEST_URL) > 1)
+
+static void esphome_update_http_progress(size_t received, size_t size)
+{
+	struct esphome_update_data *data = esphome_update_dev->data;
+
+	data->progress = 100.0f * received / size;
+	esphome_update_state_changed(esphome_update_dev);
+}
+
+static void esphome_update_http_done(int ret)
+{
+	struct esphome_update_data *data = esphome_update_dev->data;
+
+	data->downloading = false;
+	esphome_update_stop(esphome_update_dev);
+	if (ret) {
+		return;
+	}
+
+	/* Leave some time to the client to receive the final state */
+	esphome_set_timeout(esphome_update_dev, "reboot", 1000, esphome_update_reboot, NULL);
+}
+
+static const struct esphome_ota_http_listener esphome_update_http_listener = {
+	.progress = esphome_update_http_progress,
+	.done = esphome_update_http_done,
+};
+
+static int esphome_update_install(const struct device *dev)
+{
+	struct esphome_update_data *data = dev->data;
+	int ret;
+
+	/* Set first, the download may be over before the call returns */
+	data->downloading = true;
+	data->progress = 0;
+
+	ret = esphome_ota_http_update_async(CONFIG_ESPHOME_OTA_HTTP_MANIFEST_URL,
+					    &esphome_update_http_listener);
+	if (ret) {
+		data->downloading = false;
+		return ret;
+	}
+
+	esphome_update_state_changed(dev);
+
+	return 0;
+}
+
+static void esphome_update_http_checked(int ret,
+					const struct esphome_ota_http_manifest *manifest)
+{
+	struct esphome_update_data *data = esphome_update_dev->data;
+
+	if (!ret) {
+		strcpy(data->latest_version, manifest->version);
+	}
+	esphome_update_state_changed(esphome_update_dev);
+}
+
+static int esphome_update_check(const struct device *dev)
+{
+	int ret;
+
+	ARG_UNUSED(dev);
+
+	/* The fetch may wait for the timeouts, it is kept off the API and scheduler threads */
+	ret = esphome_ota_http_check_async(CONFIG_ESPHOME_OTA_HTTP_MANIFEST_URL,
+					   esphome_update_http_checked);
+
+	/* The check already running reports the state */
+	return ret == -EBUSY ? 0 : ret;
+}
+#endif
+
+int esphome_update_command(const struct device *dev, UpdateCommand command)
+{
+	switch (command) {
+	case UPDATE_COMMAND__UPDATE_COMMAND_CHECK:
+#ifdef CONFIG_ESPHOME_OTA_HTTP
+		if (ESPHOME_UPDATE_HTTP) {
+			return esphome_update_check(dev);
+		}
+#endif
+		esphome_update_state_changed(dev);
+		return 0;
+	case UPDATE_COMMAND__UPDATE_COMMAND_UPDATE:
+#ifdef CONFIG_ESPHOME_OTA_HTTP
+		if (ESPHOME_UPDATE_HTTP) {
+			return esphome_update_install(dev);
+		}
+#endif
+		/* There is no image to fetch, the client pushes it with the ota_* services */
+		return -ENOTSUP;
+	default:
+		return -ENOTSUP;
+	}
+}
+
+void esphome_update_connection_closed(const struct device *api_dev)
+{
+	struct esphome_update_data *data = esphome_update_dev->data;
+
+	if (data->api_dev != api_dev) {
+		return;
+	}
+
+	LOG_WRN("Connection closed during the update");
+	esphome_ota_abort();
+	esphome_update_stop(esphome_update_dev);
+}
+
+static int esphome_update_init(const struct device *dev)
+{
+	struct esphome_update_data *data = dev->data;
+
+	if (esphome_ota_current_version(data->current_version, sizeof(data->current_version))) {
+		strcpy(data->current_version, "unknown");
+	}
+	strcpy(data->latest_version, data->current_version);
+
+	return 0;
+}
+
+static struct esphome_update_data esphome_update_data_0;
+
+DEVICE_DT_INST_DEFINE(0, esphome_update_init, NULL, &esphome_update_data_0, NULL, POST_KERNEL,
+		      CONFIG_ESPHOME_INIT_PRIORITY, NULL);
+DEFINE_ESPHOME_ENTITY_STATE(0, esphome_update_0, "firmware", esphome_update_list_entity,
+			    esphome_update_send_state);
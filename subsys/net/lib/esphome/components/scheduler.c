@@ -0,0 +1,358 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#ifdef CONFIG_ESPHOME_TIMING_TASK_WDT
+#include <zephyr/task_wdt/task_wdt.h>
+#endif
+
+#include <esphome/loop.h>
+#include <esphome/scheduler.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(ESPHome, CONFIG_ESPHOME_LOG_LEVEL);
+
+struct esphome_timer {
+	const void *component;
+	const char *name;
+	/* NULL when the timer is free */
+	esphome_scheduler_cb cb;
+	void *user_data;
+	/* Uptime of the next call, in ms */
+	int64_t deadline;
+	uint32_t interval;
+	bool periodic;
+	/* Position in esphome_scheduler_heap */
+	size_t index;
+};
+
+static struct esphome_timer esphome_scheduler_timers[CONFIG_ESPHOME_SCHEDULER_MAX_TIMERS];
+
+/* Min-heap of the registered timers, ordered by deadline */
+static struct esphome_timer *esphome_scheduler_heap[CONFIG_ESPHOME_SCHEDULER_MAX_TIMERS];
+static size_t esphome_scheduler_len;
+
+static K_MUTEX_DEFINE(esphome_scheduler_mutex);
+
+#ifdef CONFIG_ESPHOME_SINGLE_LOOP
+/* The scheduler thread is the loop, it serves the sockets while waiting */
+static void esphome_scheduler_wait(int32_t timeout)
+{
+	esphome_loop_wait(timeout);
+}
+
+static void esphome_scheduler_wake(void)
+{
+	esphome_loop_wake();
+}
+#else
+/* Given when the earliest deadline changed */
+static K_SEM_DEFINE(esphome_scheduler_sem, 0, 1);
+
+static void esphome_scheduler_wait(int32_t timeout)
+{
+	k_sem_take(&esphome_scheduler_sem, timeout < 0 ? K_FOREVER : K_MSEC(timeout));
+}
+
+static void esphome_scheduler_wake(void)
+{
+	k_sem_give(&esphome_scheduler_sem);
+}
+#endif /* CONFIG_ESPHOME_SINGLE_LOOP */
+
+static void esphome_scheduler_swap(size_t i, size_t j)
+{
+	struct esphome_timer *timer = esphome_scheduler_heap[i];
+
+	esphome_scheduler_heap[i] = esphome_scheduler_heap[j];
+	esphome_scheduler_heap[j] = timer;
+	esphome_scheduler_heap[i]->index = i;
+	esphome_scheduler_heap[j]->index = j;
+}
+
+static bool esphome_scheduler_before(size_t i, size_t j)
+{
+	return esphome_scheduler_heap[i]->deadline < esphome_scheduler_heap[j]->deadline;
+}
+
+static void esphome_scheduler_sift_up(size_t i)
+{
+	while (i > 0 && esphome_scheduler_before(i, (i - 1) / 2)) {
+		esphome_scheduler_swap(i, (i - 1) / 2);
+		i = (i - 1) / 2;
+	}
+}
+
+static void esphome_scheduler_sift_down(size_t i)
+{
+	for (;;) {
+		size_t left = 2 * i + 1;
+		size_t right = left + 1;
+		size_t min = i;
+
+		if (left < esphome_scheduler_len && esphome_scheduler_before(left, min)) {
+			min = left;
+		}
+		if (right < esphome_scheduler_len && esphome_scheduler_before(right, min)) {
+			min = right;
+		}
+		if (min == i) {
+			return;
+		}
+
+		esphome_scheduler_swap(i, min);
+		i = min;
+	}
+}
+
+static void esphome_scheduler_push(struct esphome_timer *timer)
+{
+	timer->index = esphome_scheduler_len++;
+	esphome_scheduler_heap[timer->index] = timer;
+	esphome_scheduler_sift_up(timer->index);
+}
+
+static void esphome_scheduler_remove(struct esphome_timer *timer)
+{
+	size_t i = timer->index;
+
+	esphome_scheduler_len--;
+	if (i != esphome_scheduler_len) {
+		esphome_scheduler_swap(i, esphome_scheduler_len);
+		esphome_scheduler_sift_up(i);
+		esphome_scheduler_sift_down(i);
+	}
+	timer->cb = NULL;
+}
+
+static struct esphome_timer *esphome_scheduler_find(const void *component, const char *name,
+						    bool periodic)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(esphome_scheduler_timers); i++) {
+		struct esphome_timer *timer = &esphome_scheduler_timers[i];
+
+		if (timer->cb && timer->periodic == periodic && timer->component == component &&
+		    !strcmp(timer->name, name)) {
+			return timer;
+		}
+	}
+
+	return NULL;
+}
+
+static struct esphome_timer *esphome_scheduler_alloc(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(esphome_scheduler_timers); i++) {
+		if (!esphome_scheduler_timers[i].cb) {
+			return &esphome_scheduler_timers[i];
+		}
+	}
+
+	return NULL;
+}
+
+static int esphome_scheduler_set(const void *component, const char *name, uint32_t delay,
+				 bool periodic, esphome_scheduler_cb cb, void *user_data)
+{
+	struct esphome_timer *timer;
+	int ret = 0;
+
+	if (!cb || (periodic && !delay)) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&esphome_scheduler_mutex, K_FOREVER);
+
+	timer = esphome_scheduler_find(component, name, periodic);
+	if (timer) {
+		esphome_scheduler_remove(timer);
+	} else {
+		timer = esphome_scheduler_alloc();
+		if (!timer) {
+			LOG_ERR("No free timer for %s", name);
+			ret = -ENOMEM;
+			goto unlock;
+		}
+	}
+
+	timer->component = component;
+	timer->name = name;
+	timer->cb = cb;
+	timer->user_data = user_data;
+	timer->deadline = k_uptime_get() + delay;
+	timer->interval = delay;
+	timer->periodic = periodic;
+	esphome_scheduler_push(timer);
+
+	if (timer->index == 0) {
+		esphome_scheduler_wake();
+	}
+
+unlock:
+	k_mutex_unlock(&esphome_scheduler_mutex);
+
+	return ret;
+}
+
+static bool esphome_scheduler_cancel(const void *component, const char *name, bool periodic)
+{
+	struct esphome_timer *timer;
+
+	k_mutex_lock(&esphome_scheduler_mutex, K_FOREVER);
+	timer = esphome_scheduler_find(component, name, periodic);
+	if (timer) {
+		esphome_scheduler_remove(timer);
+	}
+	k_mutex_unlock(&esphome_scheduler_mutex);
+
+	/* The thread may wake up a bit early, it simply waits again */
+	return timer != NULL;
+}
+
+int esphome_set_interval(const void *component, const char *name, uint32_t interval,
+			 esphome_scheduler_cb cb, void *user_data)
+{
+	return esphome_scheduler_set(component, name, interval, true, cb, user_data);
+}
+
+int esphome_set_timeout(const void *component, const char *name, uint32_t timeout,
+			esphome_scheduler_cb cb, void *user_data)
+{
+	return esphome_scheduler_set(component, name, timeout, false, cb, user_data);
+}
+
+bool esphome_cancel_interval(const void *component, const char *name)
+{
+	return esphome_scheduler_cancel(component, name, true);
+}
+
+bool esphome_cancel_timeout(const void *component, const char *name)
+{
+	return esphome_scheduler_cancel(component, name, false);
+}
+
+#ifdef CONFIG_ESPHOME_TIMING_TASK_WDT
+#define ESPHOME_SCHEDULER_WDT_PERIOD CONFIG_ESPHOME_TIMING_TASK_WDT_PERIOD
+
+/* Only used from the scheduler thread, -1 when it isn't watched */
+static int esphome_scheduler_wdt_channel = -1;
+
+/* A callback stalling the thread, e.g. a sensor driver, triggers the watchdog */
+static void esphome_scheduler_wdt_add(void)
+{
+	int channel;
+
+	channel = task_wdt_add(ESPHOME_SCHEDULER_WDT_PERIOD, NULL, NULL);
+	if (channel < 0) {
+		LOG_ERR("Failed to add the task watchdog channel [%d]", channel);
+	}
+
+	esphome_scheduler_wdt_channel = channel;
+}
+
+static void esphome_scheduler_wdt_feed(void)
+{
+	if (esphome_scheduler_wdt_channel >= 0) {
+		task_wdt_feed(esphome_scheduler_wdt_channel);
+	}
+}
+
+/* Wake up in time to feed it again, even with nothing to run */
+static int32_t esphome_scheduler_wdt_timeout(int32_t timeout)
+{
+	if (timeout < 0 || timeout > ESPHOME_SCHEDULER_WDT_PERIOD / 2) {
+		return ESPHOME_SCHEDULER_WDT_PERIOD / 2;
+	}
+
+	return timeout;
+}
+
+void esphome_scheduler_wdt_suspend(void)
+{
+	if (esphome_scheduler_wdt_channel >= 0) {
+		task_wdt_delete(esphome_scheduler_wdt_channel);
+		esphome_scheduler_wdt_channel = -1;
+	}
+}
+
+void esphome_scheduler_wdt_resume(void)
+{
+	if (esphome_scheduler_wdt_channel < 0) {
+		esphome_scheduler_wdt_add();
+	}
+}
+#else
+static inline void esphome_scheduler_wdt_add(void)
+{
+}
+
+static inline void esphome_scheduler_wdt_feed(void)
+{
+}
+
+static inline int32_t esphome_scheduler_wdt_timeout(int32_t timeout)
+{
+	return timeout;
+}
+#endif /* CONFIG_ESPHOME_TIMING_TASK_WDT */
+
+static void esphome_scheduler_thread(void *arg1, void *arg2, void *arg3)
+{
+	ARG_UNUSED(arg1);
+	ARG_UNUSED(arg2);
+	ARG_UNUSED(arg3);
+
+	esphome_scheduler_wdt_add();
+
+	for (;;) {
+		int32_t timeout = -1;
+		struct esphome_timer *timer;
+		esphome_scheduler_cb cb;
+		void *user_data;
+		int64_t now;
+
+		esphome_scheduler_wdt_feed();
+		k_mutex_lock(&esphome_scheduler_mutex, K_FOREVER);
+		if (!esphome_scheduler_len) {
+			goto wait;
+		}
+
+		timer = esphome_scheduler_heap[0];
+		now = k_uptime_get();
+		if (timer->deadline > now) {
+			timeout = MIN(timer->deadline - now, INT32_MAX);
+			goto wait;
+		}
+
+		cb = timer->cb;
+		user_data = timer->user_data;
+		if (timer->periodic) {
+			/* Keep the rate, unless the calls are late by a whole interval */
+			timer->deadline += timer->interval;
+			if (timer->deadline <= now) {
+				timer->deadline = now + timer->interval;
+			}
+			esphome_scheduler_sift_down(0);
+		} else {
+			esphome_scheduler_remove(timer);
+		}
+		k_mutex_unlock(&esphome_scheduler_mutex);
+
+		/* Called unlocked, so the callback may set or cancel timers */
+		cb(user_data);
+		continue;
+
+wait:
+		k_mutex_unlock(&esphome_scheduler_mutex);
+		esphome_scheduler_wait(esphome_scheduler_wdt_timeout(timeout));
+	}
+}
+
+K_THREAD_DEFINE(esphome_scheduler_tid, CONFIG_ESPHOME_SCHEDULER_STACK_SIZE,
+		esphome_scheduler_thread, NULL, NULL, NULL, CONFIG_ESPHOME_SCHEDULER_PRIORITY, 0,
+		0);
@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+
+#include <esphome/components/api.h>
+#include <esphome/components/entity.h>
+#include <esphome/components/sensor.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(ESPHome, CONFIG_ESPHOME_LOG_LEVEL);
+
+#define ESPHOME_SENSOR_BUFFER_SIZE  CONFIG_ESPHOME_SENSOR_BUFFER_SIZE
+#define ESPHOME_SENSOR_REPLAY_COUNT CONFIG_ESPHOME_SENSOR_BUFFER_REPLAY_SAMPLES
+
+/* Serialize the settings accesses against the replay */
+static K_MUTEX_DEFINE(esphome_sensor_buffer_mutex);
+
+#ifdef CONFIG_ESPHOME_SENSOR_BUFFER_SETTINGS
+#define ESPHOME_SENSOR_BUFFER_KEY_LEN sizeof("esphome/sensor/buffer/00000000")
+/* Bump when the layout of esphome_sensor_sample changes */
+#define ESPHOME_SENSOR_BUFFER_VERSION 1
+/* The version and the sample size are saved in front of the samples */
+#define ESPHOME_SENSOR_BUFFER_HEADER_SIZE                                                          \
+	(offsetof(struct esphome_sensor_buffer, samples) -                                         \
+	 offsetof(struct esphome_sensor_buffer, version))
+
+BUILD_ASSERT(ESPHOME_SENSOR_BUFFER_HEADER_SIZE == 2 * sizeof(uint32_t),
+	     "The header of the record must not be padded");
+
+static void esphome_sensor_buffer_key(const struct esphome_sensor_entity *sensor, char *key)
+{
+	snprintk(key, ESPHOME_SENSOR_BUFFER_KEY_LEN, "esphome/sensor/buffer/%08x",
+		 sensor->entity->data->key);
+}
+
+static bool esphome_sensor_buffer_valid(const struct esphome_sensor_buffer *buffer)
+{
+	return buffer->version == ESPHOME_SENSOR_BUFFER_VERSION &&
+	       buffer->sample_size == sizeof(buffer->samples[0]);
+}
+
+static int esphome_sensor_buffer_set(const char *key, size_t len, settings_read_cb read_cb,
+				     void *cb_arg, void *param)
+{
+	struct esphome_sensor_buffer *buffer = param;
+	uint32_t shift;
+	ssize_t ret;
+
+	if (key && key[0] != '\0') {
+		return 0;
+	}
+
+	if (len < ESPHOME_SENSOR_BUFFER_HEADER_SIZE ||
+	    len > ESPHOME_SENSOR_BUFFER_HEADER_SIZE + sizeof(buffer->samples)) {
+		return -EINVAL;
+	}
+
+	ret = read_cb(cb_arg, &buffer->version, len);
+	if (ret < 0) {
+		return ret;
+	}
+
+	/* Saved by another build, the samples can't be interpreted */
+	if (!esphome_sensor_buffer_valid(buffer) ||
+	    (ret - ESPHOME_SENSOR_BUFFER_HEADER_SIZE) % sizeof(buffer->samples[0])) {
+		buffer->sample_size = 0;
+		return 0;
+	}
+
+	buffer->count = (ret - ESPHOME_SENSOR_BUFFER_HEADER_SIZE) / sizeof(buffer->samples[0]);
+	if (!buffer->count) {
+		return 0;
+	}
+
+	/*
+	 * Timestamps come from a previous boot: rebase them so the most recent
+	 * sample is "now", which keeps their relative spacing.
+	 */
+	shift = k_uptime_get_32() - buffer->samples[buffer->count - 1].timestamp;
+	for (uint16_t i = 0; i < buffer->count; i++) {
+		buffer->samples[i].timestamp += shift;
+	}
+
+	return 0;
+}
+
+static void esphome_sensor_buffer_load(struct esphome_sensor_entity *sensor)
+{
+	struct esphome_sensor_buffer *buffer = sensor->buffer;
+	char key[ESPHOME_SENSOR_BUFFER_KEY_LEN];
+	int ret;
+
+	if (buffer->loaded) {
+		return;
+	}
+	buffer->loaded = true;
+
+	ret = settings_subsys_init();
+	if (ret) {
+		LOG_ERR("Failed to initialize settings [%d]", ret);
+		return;
+	}
+
+	esphome_sensor_buffer_key(sensor, key);
+	ret = settings_load_subtree_direct(key, esphome_sensor_buffer_set, buffer);
+	if (ret) {
+		LOG_WRN("Failed to load %s buffer [%d]", sensor->entity->config->name, ret);
+	}
+
+	/* The version is still 0 if there was no record */
+	if (buffer->version && !esphome_sensor_buffer_valid(buffer)) {
+		LOG_WRN("Discarding %s buffer, saved with another layout",
+			sensor->entity->config->name);
+		settings_delete(key);
+	}
+	buffer->version = ESPHOME_SENSOR_BUFFER_VERSION;
+	buffer->sample_size = sizeof(buffer->samples[0]);
+	buffer->saved_at = k_uptime_get_32();
+}
+
+static void esphome_sensor_buffer_save(struct esphome_sensor_entity *sensor)
+{
+	struct esphome_sensor_buffer *buffer = sensor->buffer;
+	char key[ESPHOME_SENSOR_BUFFER_KEY_LEN];
+	uint32_t now = k_uptime_get_32();
+	int ret;
+
+	/* Flash backing is for long outages, don't write it on every sample */
+	if (!buffer->dirty ||
+	    now - buffer->saved_at < CONFIG_ESPHOME_SENSOR_BUFFER_SAVE_INTERVAL * MSEC_PER_SEC) {
+		return;
+	}
+
+	esphome_sensor_buffer_key(sensor, key);
+	ret = settings_save_one(key, &buffer->version,
+				ESPHOME_SENSOR_BUFFER_HEADER_SIZE +
+					buffer->count * sizeof(buffer->samples[0]));
+	if (ret) {
+		LOG_ERR("Failed to save %s buffer [%d]", sensor->entity->config->name, ret);
+		return;
+	}
+
+	buffer->dirty = false;
+	buffer->saved_at = now;
+}
+
+static void esphome_sensor_buffer_delete(struct esphome_sensor_entity *sensor)
+{
+	char key[ESPHOME_SENSOR_BUFFER_KEY_LEN];
+
+	esphome_sensor_buffer_key(sensor, key);
+	settings_delete(key);
+	sensor->buffer->dirty = false;
+}
+#else
+static inline void esphome_sensor_buffer_load(struct esphome_sensor_entity *sensor)
+{
+}
+
+static inline void esphome_sensor_buffer_save(struct esphome_sensor_entity *sensor)
+{
+}
+
+static inline void esphome_sensor_buffer_delete(struct esphome_sensor_entity *sensor)
+{
+}
+#endif /* CONFIG_ESPHOME_SENSOR_BUFFER_SETTINGS */
+
+/*
+ * Average adjacent samples two by two. When the buffer is full, this halves
+ * its resolution instead of dropping the oldest samples, so the whole
+ * disconnected period is still covered.
+ */
+static void esphome_sensor_buffer_compact(struct esphome_sensor_buffer *buffer)
+{
+	struct esphome_sensor_sample *samples = buffer->samples;
+	uint16_t i;
+
+	for (i = 0; i < buffer->count / 2; i++) {
+		const struct esphome_sensor_sample *a = &samples[2 * i];
+		const struct esphome_sensor_sample *b = &samples[2 * i + 1];
+
+		samples[i].timestamp = a->timestamp + (b->timestamp - a->timestamp) / 2;
+		samples[i].state = (a->state + b->state) / 2;
+	}
+
+	if (buffer->count % 2) {
+		samples[i++] = samples[buffer->count - 1];
+	}
+
+	buffer->count = i;
+}
+
+void esphome_sensor_buffer_push(struct esphome_sensor_entity *sensor, esphome_sensor_value_t state)
+{
+	const struct device *api_dev = sensor->entity->data->api_dev;
+	struct esphome_sensor_buffer *buffer = sensor->buffer;
+	k_spinlock_key_t key;
+
+	k_mutex_lock(&esphome_sensor_buffer_mutex, K_FOREVER);
+
+	/* Waited for a replay, the state is sent with the others of the subscription */
+	if (esphome_api_is_subscribed(api_dev)) {
+		k_mutex_unlock(&esphome_sensor_buffer_mutex);
+		return;
+	}
+
+	esphome_sensor_buffer_load(sensor);
+
+	key = k_spin_lock(&buffer->lock);
+	if (buffer->count == ESPHOME_SENSOR_BUFFER_SIZE) {
+		esphome_sensor_buffer_compact(buffer);
+	}
+	buffer->samples[buffer->count].timestamp = k_uptime_get_32();
+	buffer->samples[buffer->count].state = state;
+	buffer->count++;
+#ifdef CONFIG_ESPHOME_SENSOR_BUFFER_SETTINGS
+	buffer->dirty = true;
+#endif
+	k_spin_unlock(&buffer->lock, key);
+
+	esphome_sensor_buffer_save(sensor);
+	k_mutex_unlock(&esphome_sensor_buffer_mutex);
+}
+
+static void esphome_sensor_buffer_replay_one(const struct device *api_dev,
+					     struct esphome_sensor_entity *sensor)
+{
+	struct esphome_sensor_buffer *buffer = sensor->buffer;
+	k_spinlock_key_t key;
+	uint16_t count;
+	uint16_t step;
+
+	esphome_sensor_buffer_load(sensor);
+
+	key = k_spin_lock(&buffer->lock);
+	count = buffer->count;
+	k_spin_unlock(&buffer->lock, key);
+
+	if (!count) {
+		return;
+	}
+
+	/* Downsample to at most ESPHOME_SENSOR_REPLAY_COUNT averaged states */
+	step = DIV_ROUND_UP(count, ESPHOME_SENSOR_REPLAY_COUNT);
+	LOG_INF("Resending %u samples of %s (%u per state)", count, sensor->entity->config->name,
+		step);
+
+	for (uint16_t i = 0; i < count; i += step) {
+		uint16_t n = MIN(step, count - i);
+		esphome_sensor_value_t sum = 0;
+
+		key = k_spin_lock(&buffer->lock);
+		for (uint16_t j = i; j < i + n; j++) {
+			sum += buffer->samples[j].state;
+		}
+		k_spin_unlock(&buffer->lock, key);
+
+		esphome_sensor_write_state(api_dev, sensor->entity, sum / n);
+	}
+
+	key = k_spin_lock(&buffer->lock);
+	buffer->count = 0;
+	k_spin_unlock(&buffer->lock, key);
+
+	esphome_sensor_buffer_delete(sensor);
+}
+
+void esphome_sensor_buffer_replay(const struct device *api_dev,
+				  void (*subscribe)(const struct device *api_dev))
+{
+	k_mutex_lock(&esphome_sensor_buffer_mutex, K_FOREVER);
+	STRUCT_SECTION_FOREACH(esphome_sensor_entity, sensor) {
+		if (sensor->entity->data->api_dev != api_dev) {
+			continue;
+		}
+
+		esphome_sensor_buffer_replay_one(api_dev, sensor);
+	}
+
+	/* Before unlocking, so no sample is buffered once the replay is over */
+	subscribe(api_dev);
+	k_mutex_unlock(&esphome_sensor_buffer_mutex);
+}
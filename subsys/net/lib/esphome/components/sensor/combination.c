@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define DT_DRV_COMPAT nabucasa_esphome_sensor_combination
+
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/kernel.h>
+
+#include <esphome/components/api.h>
+#include <esphome/components/sensor.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(ESPHome, CONFIG_ESPHOME_LOG_LEVEL);
+
+/* Must match the order of the type enum in the binding */
+enum esphome_combination_type {
+	ESPHOME_COMBINATION_MIN,
+	ESPHOME_COMBINATION_MAX,
+	ESPHOME_COMBINATION_MEAN,
+	ESPHOME_COMBINATION_RANGE,
+	ESPHOME_COMBINATION_SUM,
+};
+
+struct esphome_combination_source {
+	struct esphome_sensor_listener listener;
+	const struct device *dev;
+	esphome_sensor_value_t state;
+	bool has_state;
+};
+
+struct esphome_combination_sensor_config {
+	enum esphome_combination_type type;
+	const struct device *const *sources;
+	size_t num_sources;
+};
+
+struct esphome_combination_sensor_data {
+	/* Must be first, the sensor helpers use dev->data as esphome_sensor_data */
+	struct esphome_sensor_data sensor;
+
+	struct k_spinlock lock;
+	struct esphome_combination_source *sources;
+	/* Number of sources that have a state */
+	size_t count;
+	esphome_sensor_value_t sum;
+	esphome_sensor_value_t min;
+	esphome_sensor_value_t max;
+};
+
+/* Only used when the extremum moves away from its bound, or to resync the sum */
+static void esphome_combination_rescan(const struct device *dev)
+{
+	const struct esphome_combination_sensor_config *config = dev->config;
+	struct esphome_combination_sensor_data *data = dev->data;
+	bool first = true;
+
+	data->sum = 0;
+	for (size_t i = 0; i < config->num_sources; i++) {
+		const struct esphome_combination_source *source = &data->sources[i];
+
+		if (!source->has_state) {
+			continue;
+		}
+
+		data->sum += source->state;
+		if (first) {
+			data->min = source->state;
+			data->max = source->state;
+			first = false;
+		} else {
+			data->min = MIN(data->min, source->state);
+			data->max = MAX(data->max, source->state);
+		}
+	}
+}
+
+static void esphome_combination_updated(struct esphome_sensor_listener *listener,
+					esphome_sensor_value_t state)
+{
+	struct esphome_combination_source *source =
+		CONTAINER_OF(listener, struct esphome_combination_source, listener);
+	struct esphome_combination_sensor_data *data = source->dev->data;
+	bool rescan = false;
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&data->lock);
+	if (!source->has_state) {
+		source->has_state = true;
+		data->sum += state;
+		if (data->count++) {
+			data->min = MIN(data->min, state);
+			data->max = MAX(data->max, state);
+		} else {
+			data->min = state;
+			data->max = state;
+		}
+	} else {
+		esphome_sensor_value_t old = source->state;
+
+		data->sum += state - old;
+		if (state <= data->min) {
+			data->min = state;
+		} else if (old == data->min) {
+			rescan = true;
+		}
+		if (state >= data->max) {
+			data->max = state;
+		} else if (old == data->max) {
+			rescan = true;
+		}
+	}
+	source->state = state;
+
+	if (rescan) {
+		esphome_combination_rescan(source->dev);
+	}
+	k_spin_unlock(&data->lock, key);
+}
+
+static int esphome_combination_value(const struct device *dev, esphome_sensor_value_t *state)
+{
+	const struct esphome_combination_sensor_config *config = dev->config;
+	struct esphome_combination_sensor_data *data = dev->data;
+	k_spinlock_key_t key;
+	int ret = 0;
+
+	key = k_spin_lock(&data->lock);
+	if (!data->count) {
+		ret = -ENODATA;
+		goto unlock;
+	}
+
+	switch (config->type) {
+	case ESPHOME_COMBINATION_MIN:
+		*state = data->min;
+		break;
+	case ESPHOME_COMBINATION_MAX:
+		*state = data->max;
+		break;
+	case ESPHOME_COMBINATION_MEAN:
+		*state = data->sum / (esphome_sensor_value_t)data->count;
+		break;
+	case ESPHOME_COMBINATION_RANGE:
+		*state = data->max - data->min;
+		break;
+	case ESPHOME_COMBINATION_SUM:
+		*state = data->sum;
+		break;
+	}
+
+unlock:
+	k_spin_unlock(&data->lock, key);
+
+	return ret;
+}
+
+#ifdef CONFIG_ESPHOME_SENSOR_FIXED_POINT
+static int esphome_combination_read_micro(const struct device *dev, int64_t *state)
+{
+	return esphome_combination_value(dev, state);
+}
+#else
+static int esphome_combination_read(const struct device *dev, float *state)
+{
+	return esphome_combination_value(dev, state);
+}
+#endif
+
+static int esphome_combination_init(const struct device *dev)
+{
+	const struct esphome_combination_sensor_config *config = dev->config;
+	struct esphome_combination_sensor_data *data = dev->data;
+
+	for (size_t i = 0; i < config->num_sources; i++) {
+		struct esphome_combination_source *source = &data->sources[i];
+		struct esphome_sensor_data *source_data = config->sources[i]->data;
+
+		source->dev = dev;
+		source->listener.updated = esphome_combination_updated;
+		esphome_sensor_add_listener(config->sources[i], &source->listener);
+
+		if (source_data->has_state) {
+			esphome_combination_updated(&source->listener, source_data->state);
+		}
+	}
+
+	return 0;
+}
+
+struct esphome_sensor_api esphome_combination_sensor = {
+	.init = esphome_combination_init,
+#ifdef CONFIG_ESPHOME_SENSOR_FIXED_POINT
+	.read_micro = esphome_combination_read_micro,
+#else
+	.read = esphome_combination_read,
+#endif
+};
+
+#define ESPHOME_COMBINATION_SOURCE(node_id, prop, idx)                                             \
+	DEVICE_DT_GET(DT_PHANDLE_BY_IDX(node_id, prop, idx)),
+
+#define DEFINE_ESPHOME_SENSOR_COMBINATION(_num)                                                    \
+                                                                                                   \
+	static const struct device *const esphome_combination_sources_##_num[] = {                 \
+		DT_INST_FOREACH_PROP_ELEM(_num, sources, ESPHOME_COMBINATION_SOURCE)};             \
+	static struct esphome_combination_source                                                   \
+		esphome_combination_source_data_##_num[DT_INST_PROP_LEN(_num, sources)];           \
+                                                                                                   \
+	static const struct esphome_combination_sensor_config esphome_combination_config_##_num = { \
+		.type = DT_INST_ENUM_IDX(_num, type),                                              \
+		.sources = esphome_combination_sources_##_num,                                     \
+		.num_sources = ARRAY_SIZE(esphome_combination_sources_##_num),                     \
+	};                                                                                         \
+	static struct esphome_combination_sensor_data esphome_combination_data_##_num = {          \
+		.sources = esphome_combination_source_data_##_num,                                 \
+	};                                                                                         \
+                                                                                                   \
+	DEVICE_DT_INST_DEFINE(_num, esphome_sensor_init, NULL, &esphome_combination_data_##_num,   \
+			      &esphome_combination_config_##_num, POST_KERNEL,                     \
+			      CONFIG_ESPHOME_INIT_PRIORITY, &esphome_combination_sensor);          \
+	DEFINE_ESPHOME_SENSOR_ENTITY(_num, esphome_combination_sensor_##_num);
+
+DT_INST_FOREACH_STATUS_OKAY(DEFINE_ESPHOME_SENSOR_COMBINATION);
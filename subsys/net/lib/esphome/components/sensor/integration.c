@@ -0,0 +1,325 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+
+#include <esphome/components/api.h>
+#include <esphome/components/sensor.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(ESPHome, CONFIG_ESPHOME_LOG_LEVEL);
+
+#define MSEC_PER_DAY (24 * 60 * 60 * MSEC_PER_SEC)
+
+/* Must match the order of the integration_method enum in the bindings */
+enum esphome_integration_method {
+	ESPHOME_INTEGRATION_TRAPEZOID,
+	ESPHOME_INTEGRATION_LEFT,
+	ESPHOME_INTEGRATION_RIGHT,
+};
+
+/* Milliseconds per time_unit, must match the order of the enum in the bindings */
+static const uint32_t esphome_integration_time_units[] = {
+	MSEC_PER_SEC,
+	60 * MSEC_PER_SEC,
+	60 * 60 * MSEC_PER_SEC,
+	MSEC_PER_DAY,
+};
+
+struct esphome_integration_sensor_config {
+	const struct device *sensor;
+	enum esphome_integration_method method;
+	/* Index in esphome_integration_time_units */
+	uint8_t time_unit;
+	/* Reset the total every 24h */
+	bool daily;
+};
+
+#ifdef CONFIG_ESPHOME_SENSOR_FIXED_POINT
+typedef int64_t esphome_integration_acc_t;
+#else
+/* A float total stops growing once the increments fall below its resolution */
+typedef double esphome_integration_acc_t;
+#endif
+
+/* Accumulator, this is what is persisted in the settings */
+struct esphome_integration_total {
+	esphome_integration_acc_t total;
+#ifdef CONFIG_ESPHOME_SENSOR_FIXED_POINT
+	/* Twice the area, in µ-units x ms, not yet accounted in total */
+	int64_t remainder;
+#endif
+	/* Time elapsed in the current day when saved, in ms, for the daily totals */
+	uint32_t day_elapsed;
+};
+
+struct esphome_integration_sensor_data {
+	/* Must be first, the sensor helpers use dev->data as esphome_sensor_data */
+	struct esphome_sensor_data sensor;
+
+	const struct device *dev;
+	struct esphome_sensor_listener listener;
+	struct k_spinlock lock;
+	struct esphome_integration_total acc;
+	esphome_sensor_value_t last_state;
+	int64_t last_time;
+	bool has_last;
+	/* Uptime the current day started at, negative if it started before the boot */
+	int64_t day_start;
+#ifdef CONFIG_ESPHOME_SENSOR_INTEGRATION_SETTINGS
+	bool loaded;
+	struct k_work_delayable save_work;
+#endif
+};
+
+#ifdef CONFIG_ESPHOME_SENSOR_INTEGRATION_SETTINGS
+#define ESPHOME_INTEGRATION_KEY_LEN 64
+
+static void esphome_integration_key(const struct device *dev, char *key)
+{
+	snprintk(key, ESPHOME_INTEGRATION_KEY_LEN, "esphome/sensor/integration/%s", dev->name);
+}
+
+static int esphome_integration_set(const char *key, size_t len, settings_read_cb read_cb,
+				   void *cb_arg, void *param)
+{
+	struct esphome_integration_total *acc = param;
+	ssize_t ret;
+
+	if (key && key[0] != '\0') {
+		return 0;
+	}
+
+	if (len != sizeof(*acc)) {
+		return -EINVAL;
+	}
+
+	ret = read_cb(cb_arg, acc, len);
+
+	return ret < 0 ? ret : 0;
+}
+
+static void esphome_integration_load(const struct device *dev)
+{
+	struct esphome_integration_sensor_data *data = dev->data;
+	struct esphome_integration_total acc = {0};
+	char key[ESPHOME_INTEGRATION_KEY_LEN];
+	k_spinlock_key_t lock_key;
+	int ret;
+
+	if (data->loaded) {
+		return;
+	}
+	data->loaded = true;
+
+	ret = settings_subsys_init();
+	if (ret) {
+		LOG_ERR("Failed to initialize settings [%d]", ret);
+		return;
+	}
+
+	esphome_integration_key(dev, key);
+	ret = settings_load_subtree_direct(key, esphome_integration_set, &acc);
+	if (ret) {
+		LOG_WRN("Failed to load %s total [%d]", dev->name, ret);
+		return;
+	}
+
+	/* The uptime restarted, the day goes on from where it was saved */
+	lock_key = k_spin_lock(&data->lock);
+	data->acc = acc;
+	data->day_start = k_uptime_get() - acc.day_elapsed;
+	k_spin_unlock(&data->lock, lock_key);
+}
+
+static void esphome_integration_save_work(struct k_work *work)
+{
+	struct k_work_delayable *work_delayable = k_work_delayable_from_work(work);
+	struct esphome_integration_sensor_data *data =
+		CONTAINER_OF(work_delayable, struct esphome_integration_sensor_data, save_work);
+	struct esphome_integration_total acc;
+	char key[ESPHOME_INTEGRATION_KEY_LEN];
+	k_spinlock_key_t lock_key;
+	int ret;
+
+	lock_key = k_spin_lock(&data->lock);
+	acc = data->acc;
+	acc.day_elapsed = k_uptime_get() - data->day_start;
+	k_spin_unlock(&data->lock, lock_key);
+
+	esphome_integration_key(data->dev, key);
+	ret = settings_save_one(key, &acc, sizeof(acc));
+	if (ret) {
+		LOG_ERR("Failed to save %s total [%d]", data->dev->name, ret);
+	}
+}
+
+/*
+ * Only the first update of an interval schedules a write: the following
+ * ones are coalesced into it since the work is already pending.
+ */
+static void esphome_integration_schedule_save(struct esphome_integration_sensor_data *data)
+{
+	k_work_schedule(&data->save_work,
+			K_SECONDS(CONFIG_ESPHOME_SENSOR_INTEGRATION_SAVE_INTERVAL));
+}
+#else
+static inline void esphome_integration_load(const struct device *dev)
+{
+}
+
+static inline void esphome_integration_schedule_save(struct esphome_integration_sensor_data *data)
+{
+}
+#endif /* CONFIG_ESPHOME_SENSOR_INTEGRATION_SETTINGS */
+
+static void esphome_integration_accumulate(const struct device *dev, esphome_sensor_value_t state,
+					   int64_t dt)
+{
+	const struct esphome_integration_sensor_config *config = dev->config;
+	struct esphome_integration_sensor_data *data = dev->data;
+	esphome_integration_acc_t area2;
+
+	/* Twice the area, so the trapezoid doesn't need a division */
+	switch (config->method) {
+	case ESPHOME_INTEGRATION_LEFT:
+		area2 = 2 * (esphome_integration_acc_t)data->last_state * dt;
+		break;
+	case ESPHOME_INTEGRATION_RIGHT:
+		area2 = 2 * (esphome_integration_acc_t)state * dt;
+		break;
+	case ESPHOME_INTEGRATION_TRAPEZOID:
+	default:
+		area2 = ((esphome_integration_acc_t)data->last_state + state) * dt;
+		break;
+	}
+
+#ifdef CONFIG_ESPHOME_SENSOR_FIXED_POINT
+	int64_t divisor = 2 * (int64_t)esphome_integration_time_units[config->time_unit];
+
+	data->acc.remainder += area2;
+	data->acc.total += data->acc.remainder / divisor;
+	data->acc.remainder %= divisor;
+#else
+	data->acc.total += area2 / (2.0 * esphome_integration_time_units[config->time_unit]);
+#endif
+}
+
+static void esphome_integration_updated(struct esphome_sensor_listener *listener,
+					esphome_sensor_value_t state)
+{
+	struct esphome_integration_sensor_data *data =
+		CONTAINER_OF(listener, struct esphome_integration_sensor_data, listener);
+	const struct device *dev = data->dev;
+	const struct esphome_integration_sensor_config *config = dev->config;
+	int64_t now = k_uptime_get();
+	k_spinlock_key_t key;
+
+	esphome_integration_load(dev);
+
+	key = k_spin_lock(&data->lock);
+	/*
+	 * There is no wall clock here, so a daily total covers 24h of uptime.
+	 * The time elapsed in the day is saved with the total, a reboot
+	 * doesn't restart the day, but the time spent down isn't counted.
+	 */
+	if (config->daily && now - data->day_start >= MSEC_PER_DAY) {
+		data->day_start += (now - data->day_start) / MSEC_PER_DAY * MSEC_PER_DAY;
+		memset(&data->acc, 0, sizeof(data->acc));
+		/* Only the part of the interval after the rollover belongs to the new day */
+		data->last_time = MAX(data->last_time, data->day_start);
+	}
+
+	if (data->has_last) {
+		esphome_integration_accumulate(dev, state, now - data->last_time);
+	}
+	data->last_state = state;
+	data->last_time = now;
+	data->has_last = true;
+	k_spin_unlock(&data->lock, key);
+
+	esphome_integration_schedule_save(data);
+}
+
+static int esphome_integration_value(const struct device *dev, esphome_sensor_value_t *state)
+{
+	struct esphome_integration_sensor_data *data = dev->data;
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&data->lock);
+	*state = (esphome_sensor_value_t)data->acc.total;
+	k_spin_unlock(&data->lock, key);
+
+	return 0;
+}
+
+#ifdef CONFIG_ESPHOME_SENSOR_FIXED_POINT
+static int esphome_integration_read_micro(const struct device *dev, int64_t *state)
+{
+	return esphome_integration_value(dev, state);
+}
+#else
+static int esphome_integration_read(const struct device *dev, float *state)
+{
+	return esphome_integration_value(dev, state);
+}
+#endif
+
+static int esphome_integration_init(const struct device *dev)
+{
+	const struct esphome_integration_sensor_config *config = dev->config;
+	struct esphome_integration_sensor_data *data = dev->data;
+
+	data->dev = dev;
+	data->listener.updated = esphome_integration_updated;
+#ifdef CONFIG_ESPHOME_SENSOR_INTEGRATION_SETTINGS
+	k_work_init_delayable(&data->save_work, esphome_integration_save_work);
+#endif
+	esphome_sensor_add_listener(config->sensor, &data->listener);
+
+	return 0;
+}
+
+struct esphome_sensor_api esphome_integration_sensor = {
+	.init = esphome_integration_init,
+#ifdef CONFIG_ESPHOME_SENSOR_FIXED_POINT
+	.read_micro = esphome_integration_read_micro,
+#else
+	.read = esphome_integration_read,
+#endif
+};
+
+#define DEFINE_ESPHOME_SENSOR_INTEGRATION(_num, _name, _daily)                                    \
+                                                                                                   \
+	static const struct esphome_integration_sensor_config esphome_##_name##_config_##_num = {  \
+		.sensor = DEVICE_DT_GET(DT_INST_PHANDLE(_num, sensor)),                            \
+		.method = DT_INST_ENUM_IDX(_num, integration_method),                              \
+		.time_unit = DT_INST_ENUM_IDX(_num, time_unit),                                    \
+		.daily = _daily,                                                                   \
+	};                                                                                         \
+	static struct esphome_integration_sensor_data esphome_##_name##_data_##_num;               \
+                                                                                                   \
+	DEVICE_DT_INST_DEFINE(_num, esphome_sensor_init, NULL, &esphome_##_name##_data_##_num,     \
+			      &esphome_##_name##_config_##_num, POST_KERNEL,                       \
+			      CONFIG_ESPHOME_INIT_PRIORITY, &esphome_integration_sensor);          \
+	DEFINE_ESPHOME_SENSOR_ENTITY(_num, esphome_##_name##_sensor_##_num);
+
+#define DT_DRV_COMPAT nabucasa_esphome_sensor_integration
+#define DEFINE_ESPHOME_SENSOR_INTEGRATION_INST(_num)                                               \
+	DEFINE_ESPHOME_SENSOR_INTEGRATION(_num, integration, false)
+DT_INST_FOREACH_STATUS_OKAY(DEFINE_ESPHOME_SENSOR_INTEGRATION_INST);
+#undef DT_DRV_COMPAT
+
+#define DT_DRV_COMPAT nabucasa_esphome_sensor_total_daily
+#define DEFINE_ESPHOME_SENSOR_TOTAL_DAILY_INST(_num)                                               \
+	DEFINE_ESPHOME_SENSOR_INTEGRATION(_num, total_daily, true)
+DT_INST_FOREACH_STATUS_OKAY(DEFINE_ESPHOME_SENSOR_TOTAL_DAILY_INST);
@@ -4,26 +4,55 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <zephyr/init.h>
+
 #include <esphome/components/api.h>
 #include <esphome/components/entity.h>
 #include <esphome/components/sensor.h>
+#include <esphome/scheduler.h>
+#include <esphome/timing.h>
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_DECLARE(ESPHome, CONFIG_ESPHOME_LOG_LEVEL);
 
-static int esphome_sensor_service(void *arg1, void *arg2, void *arg3)
+#define ESPHOME_SENSOR_UPDATE_INTERVAL 1000
+
+/* The component of the sensor updates in the scheduler */
+static const char esphome_sensor_component[] = "sensor";
+
+static void esphome_sensor_update_all(void *user_data)
 {
-	while (1) {
-		STRUCT_SECTION_FOREACH(esphome_sensor_entity, sensor) {
-			const struct esphome_entity *entity = sensor->entity;
-			esphome_sensor_send_state(entity->data->api_dev, entity);
+	STRUCT_SECTION_FOREACH(esphome_sensor_entity, sensor) {
+		const struct esphome_entity *entity = sensor->entity;
+		esphome_sensor_value_t state;
+		uint32_t start;
+		int ret;
+
+		start = esphome_timing_start();
+		ret = esphome_sensor_update(entity->dev, &state);
+		esphome_timing_end(entity->dev, entity->dev->name, start);
+		if (ret == -ENODATA) {
+			/* No state yet, e.g. an aggregate whose sources were never read */
+			continue;
+		} else if (ret) {
+			LOG_ERR("Failed to read %s [%d]", entity->config->name, ret);
+			continue;
 		}
-		k_sleep(K_MSEC(1000));
+
+		esphome_entity_state_changed(entity);
+#ifdef CONFIG_ESPHOME_SENSOR_BUFFER
+		if (!esphome_api_is_subscribed(entity->data->api_dev)) {
+			esphome_sensor_buffer_push(sensor, state);
+		}
+#endif
 	}
+}
 
-	return 0;
+static int esphome_sensor_init_updates(void)
+{
+	return esphome_set_interval(esphome_sensor_component, "update",
+				    ESPHOME_SENSOR_UPDATE_INTERVAL, esphome_sensor_update_all,
+				    NULL);
 }
 
-#define ESPHOME_SENSOR_STACK_SIZE 2048
-K_THREAD_DEFINE(esphome_sensor_tid, ESPHOME_SENSOR_STACK_SIZE, esphome_sensor_service, NULL, NULL,
-		NULL, 0, 0, 0);
+SYS_INIT(esphome_sensor_init_updates, APPLICATION, CONFIG_ESPHOME_INIT_PRIORITY);
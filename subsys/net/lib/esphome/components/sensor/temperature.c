@@ -20,10 +20,9 @@ struct esphome_temperature_sensor_config {
 	const struct device *sensor;
 };
 
-int device_read_temperature(const struct device *dev, float *state)
+static int device_fetch_temperature(const struct device *dev, struct sensor_value *sensor_val)
 {
 	const struct esphome_temperature_sensor_config *config = dev->config;
-	struct sensor_value sensor_val;
 	int ret;
 
 	ret = sensor_sample_fetch(config->sensor);
@@ -32,17 +31,45 @@ int device_read_temperature(const struct device *dev, float *state)
 		return ret;
 	}
 
-	ret = sensor_channel_get(config->sensor, SENSOR_CHAN_AMBIENT_TEMP, &sensor_val);
+	ret = sensor_channel_get(config->sensor, SENSOR_CHAN_AMBIENT_TEMP, sensor_val);
 	if (ret) {
 		LOG_ERR("Failed to get sensor channel [%d]", ret);
 		return ret;
 	}
 
+	return 0;
+}
+
+int device_read_temperature(const struct device *dev, float *state)
+{
+	struct sensor_value sensor_val;
+	int ret;
+
+	ret = device_fetch_temperature(dev, &sensor_val);
+	if (ret) {
+		return ret;
+	}
+
 	*state = sensor_value_to_float(&sensor_val);
 
 	return ret;
 }
 
+int device_read_temperature_micro(const struct device *dev, int64_t *state)
+{
+	struct sensor_value sensor_val;
+	int ret;
+
+	ret = device_fetch_temperature(dev, &sensor_val);
+	if (ret) {
+		return ret;
+	}
+
+	*state = sensor_value_to_micro(&sensor_val);
+
+	return ret;
+}
+
 void sensor_temperature_handler(const struct device *dev, const struct sensor_trigger *trigger)
 {
 	struct esphome_sensor_data *data = CONTAINER_OF(trigger, struct esphome_sensor_data, trig);
@@ -72,6 +99,7 @@ int device_init_temperature(const struct device *dev)
 struct esphome_sensor_api esphome_temperature_sensor = {
 	.init = device_init_temperature,
 	.read = device_read_temperature,
+	.read_micro = device_read_temperature_micro,
 };
 
 #define DEFINE_ESPHOME_SENSOR_TEMPERATURE(_num)                                                    \
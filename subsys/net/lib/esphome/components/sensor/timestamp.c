@@ -28,8 +28,18 @@ int device_read_timestamp(const struct device *dev, float *state)
 	return 0;
 }
 
+int device_read_timestamp_micro(const struct device *dev, int64_t *state)
+{
+	ARG_UNUSED(dev);
+
+	*state = k_ticks_to_us_floor64(k_uptime_ticks());
+
+	return 0;
+}
+
 struct esphome_sensor_api esphome_timestamp_sensor = {
 	.read = device_read_timestamp,
+	.read_micro = device_read_timestamp_micro,
 };
 
 #define DEFINE_ESPHOME_SENSOR_TIMESTAMP(_num)                                                      \
@@ -41,10 +41,17 @@ static int esphome_gpio_switch_init(const struct device *dev)
 	return 0;
 }
 
+static void esphome_gpio_switch_commit_state(const struct device *dev, int state)
+{
+	struct esphome_gpio_switch_data *data = dev->data;
+
+	data->state = state;
+	esphome_switch_state_changed(dev);
+}
+
 static int esphome_gpio_switch_set_state(const struct device *dev, int state)
 {
 	const struct esphome_gpio_switch_config *config = dev->config;
-	struct esphome_gpio_switch_data *data = dev->data;
 	int ret;
 
 	ret = gpio_pin_set_dt(&config->gpio, state);
@@ -53,11 +60,18 @@ static int esphome_gpio_switch_set_state(const struct device *dev, int state)
 		return ret;
 	}
 
-	data->state = state;
+	esphome_gpio_switch_commit_state(dev, state);
 
 	return 0;
 }
 
+static const struct gpio_dt_spec *esphome_gpio_switch_get_gpio(const struct device *dev)
+{
+	const struct esphome_gpio_switch_config *config = dev->config;
+
+	return &config->gpio;
+}
+
 static int esphome_gpio_switch_get_state(const struct device *dev)
 {
 	struct esphome_gpio_switch_data *data = dev->data;
@@ -68,6 +82,8 @@ static int esphome_gpio_switch_get_state(const struct device *dev)
 static struct esphome_switch_component_api gpio_switch = {
 	.set_state = esphome_gpio_switch_set_state,
 	.get_state = esphome_gpio_switch_get_state,
+	.get_gpio = esphome_gpio_switch_get_gpio,
+	.commit_state = esphome_gpio_switch_commit_state,
 };
 
 #define DEFINE_ESPHOME_SWITCH_GPIO(_num)                                                           \
@@ -81,7 +97,8 @@ static struct esphome_switch_component_api gpio_switch = {
 			      &esphome_gpio_switch_data_##_num,                                    \
 			      &esphome_gpio_switch_config_##_num, POST_KERNEL,                     \
 			      CONFIG_ESPHOME_INIT_PRIORITY, &gpio_switch);                         \
-	DEFINE_ESPHOME_ENTITY(_num, esphome_gpio_switch_##_num, "switch.gpio",                     \
-			      esphome_switch_list_entity);
+	DEFINE_ESPHOME_ENTITY_STATE(_num, esphome_gpio_switch_##_num, "switch.gpio",               \
+				    esphome_switch_list_entity, esphome_switch_send_state);        \
+	DEFINE_ESPHOME_SWITCH(_num, esphome_gpio_switch_##_num);
 
 DT_INST_FOREACH_STATUS_OKAY(DEFINE_ESPHOME_SWITCH_GPIO);
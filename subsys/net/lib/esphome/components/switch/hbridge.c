@@ -11,7 +11,6 @@
 #include <zephyr/drivers/gpio.h>
 #include <zephyr/devicetree.h>
 
-#include <esphome/entity.h>
 #include <esphome/components/api.h>
 #include <esphome/components/switch.h>
 
@@ -24,10 +23,30 @@ struct esphome_switch_hbridge_config {
 	int wait_time;
 };
 
+enum esphome_switch_hbridge_phase {
+	ESPHOME_SWITCH_HBRIDGE_IDLE,
+	/* Waiting for a coil to be released */
+	ESPHOME_SWITCH_HBRIDGE_WAITING,
+	ESPHOME_SWITCH_HBRIDGE_PULSING,
+};
+
 struct esphome_switch_hbridge_data {
+	const struct device *dev;
+	struct k_work_delayable work;
+	sys_snode_t node;
+	enum esphome_switch_hbridge_phase phase;
+	/* State requested, reported once the pulse is done */
+	int target;
 	int state;
 };
 
+/* Serialize the GPIO accesses and the energized coils accounting */
+static K_MUTEX_DEFINE(esphome_switch_hbridge_mutex);
+static sys_slist_t esphome_switch_hbridge_waiting;
+static unsigned int esphome_switch_hbridge_energized;
+
+static void esphome_switch_hbridge_pulse_done(struct k_work *work);
+
 static int esphome_switch_hbridge_init(const struct device *dev)
 {
 	const struct esphome_switch_hbridge_config *config = dev->config;
@@ -44,7 +63,9 @@ static int esphome_switch_hbridge_init(const struct device *dev)
 		return ret;
 	}
 
+	data->dev = dev;
 	data->state = -EINVAL;
+	k_work_init_delayable(&data->work, esphome_switch_hbridge_pulse_done);
 
 	return 0;
 }
@@ -67,29 +88,105 @@ static int esphome_switch_hbridge_gpios(const struct device *dev, int on_pin, in
 	return 0;
 }
 
-static int esphome_switch_hbridge_set_state(const struct device *dev, int state)
+/* Must be called with the mutex held, and a coil budget reserved */
+static int esphome_switch_hbridge_start_pulse(const struct device *dev)
 {
 	const struct esphome_switch_hbridge_config *config = dev->config;
 	struct esphome_switch_hbridge_data *data = dev->data;
 	int ret;
 
-	ret = esphome_switch_hbridge_gpios(dev, state, !state);
+	ret = esphome_switch_hbridge_gpios(dev, data->target, !data->target);
 	if (ret < 0) {
 		LOG_ERR("Failed to set hbridge state");
+		esphome_switch_hbridge_gpios(dev, 0, 0);
+		k_work_cancel_delayable(&data->work);
+		data->phase = ESPHOME_SWITCH_HBRIDGE_IDLE;
+		esphome_switch_hbridge_energized--;
 		return ret;
 	}
 
-	k_sleep(K_MSEC(config->wait_time));
+	data->phase = ESPHOME_SWITCH_HBRIDGE_PULSING;
+	k_work_reschedule(&data->work, K_MSEC(config->wait_time));
+
+	return 0;
+}
+
+static void esphome_switch_hbridge_pulse_done(struct k_work *work)
+{
+	struct k_work_delayable *work_delayable = k_work_delayable_from_work(work);
+	struct esphome_switch_hbridge_data *data =
+		CONTAINER_OF(work_delayable, struct esphome_switch_hbridge_data, work);
+	const struct device *dev = data->dev;
+	sys_snode_t *node;
+	int ret;
+
+	k_mutex_lock(&esphome_switch_hbridge_mutex, K_FOREVER);
+	/* The pulse was restarted while this work was waiting for the mutex */
+	if (data->phase != ESPHOME_SWITCH_HBRIDGE_PULSING ||
+	    k_work_delayable_is_pending(&data->work)) {
+		k_mutex_unlock(&esphome_switch_hbridge_mutex);
+		return;
+	}
 
 	ret = esphome_switch_hbridge_gpios(dev, 0, 0);
 	if (ret < 0) {
 		LOG_ERR("Failed to set hbridge state");
-		return ret;
+	} else {
+		data->state = data->target;
+	}
+	data->phase = ESPHOME_SWITCH_HBRIDGE_IDLE;
+	esphome_switch_hbridge_energized--;
+
+	/* Hand the released coil budget over to the oldest waiting pulse */
+	while ((node = sys_slist_get(&esphome_switch_hbridge_waiting))) {
+		struct esphome_switch_hbridge_data *next =
+			CONTAINER_OF(node, struct esphome_switch_hbridge_data, node);
+
+		esphome_switch_hbridge_energized++;
+		if (!esphome_switch_hbridge_start_pulse(next->dev)) {
+			break;
+		}
 	}
+	k_mutex_unlock(&esphome_switch_hbridge_mutex);
 
-	data->state = state;
+	if (!ret) {
+		esphome_switch_state_changed(dev);
+	}
+}
 
-	return 0;
+/*
+ * Energize the coil and return: the coil is released, and the new state
+ * reported, from the system work queue once wait_time has elapsed.
+ */
+static int esphome_switch_hbridge_set_state(const struct device *dev, int state)
+{
+	struct esphome_switch_hbridge_data *data = dev->data;
+	int ret = 0;
+
+	k_mutex_lock(&esphome_switch_hbridge_mutex, K_FOREVER);
+	data->target = state;
+
+	switch (data->phase) {
+	case ESPHOME_SWITCH_HBRIDGE_PULSING:
+		/* Drive the coil in the new direction, for a whole new pulse */
+		ret = esphome_switch_hbridge_start_pulse(dev);
+		break;
+	case ESPHOME_SWITCH_HBRIDGE_WAITING:
+		/* The pulse will use the new target once it gets a coil budget */
+		break;
+	case ESPHOME_SWITCH_HBRIDGE_IDLE:
+		if (esphome_switch_hbridge_energized < CONFIG_ESPHOME_SWITCH_HBRIDGE_MAX_ENERGIZED) {
+			esphome_switch_hbridge_energized++;
+			ret = esphome_switch_hbridge_start_pulse(dev);
+		} else {
+			data->phase = ESPHOME_SWITCH_HBRIDGE_WAITING;
+			sys_slist_append(&esphome_switch_hbridge_waiting, &data->node);
+		}
+		break;
+	}
+	k_mutex_unlock(&esphome_switch_hbridge_mutex);
+
+	return ret;
 }
 
 static int esphome_switch_hbridge_get_state(const struct device *dev)
@@ -117,7 +214,8 @@ static struct esphome_switch_component_api hbridge_switch = {
 			      &esphome_switch_hbridge_data_##_num,                                 \
 			      &esphome_switch_hbridge_config_##_num, POST_KERNEL,                  \
 			      CONFIG_ESPHOME_INIT_PRIORITY, &hbridge_switch);                      \
-	DEFINE_ESPHOME_ENTITY(_num, esphome_switch_hbridge_##_num, "switch.hbridge",               \
-			      esphome_switch_list_entity);
+	DEFINE_ESPHOME_ENTITY_STATE(_num, esphome_switch_hbridge_##_num, "switch.hbridge",         \
+				    esphome_switch_list_entity, esphome_switch_send_state);        \
+	DEFINE_ESPHOME_SWITCH(_num, esphome_switch_hbridge_##_num);
 
 DT_INST_FOREACH_STATUS_OKAY(DEFINE_ESPHOME_SWITCH_HBRIDGE);
@@ -0,0 +1,574 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/device.h>
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/crc.h>
+
+#include <esphome/automation.h>
+#include <esphome/components/api.h>
+#include <esphome/components/entity.h>
+#include <esphome/components/switch.h>
+#include <esphome/timing.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(ESPHome, CONFIG_ESPHOME_LOG_LEVEL);
+
+/* The interlock groups and the automations track the switches with one bit each */
+#define ESPHOME_SWITCH_MAX 32
+
+#define ESPHOME_SWITCH_COUNT                                                                       \
+	(DT_NUM_INST_STATUS_OKAY(nabucasa_esphome_switch_gpio) +                                   \
+	 DT_NUM_INST_STATUS_OKAY(nabucasa_esphome_switch_hbridge))
+
+BUILD_ASSERT(ESPHOME_SWITCH_COUNT <= ESPHOME_SWITCH_MAX, "Too many switches");
+
+/*
+ * A single record holds the states of all the switches, each one next to the
+ * checksum of its object_id so the registry may change between two boots.
+ */
+#define ESPHOME_SWITCH_SETTINGS_KEY "esphome/switch/state"
+
+struct esphome_switch_record {
+	uint32_t key;
+	uint8_t state;
+} __packed;
+
+/*
+ * The switches that are on, or being turned on, one bit per registry index.
+ * A switch of an interlock group only turns on once it has set its bit while
+ * the bits of the rest of the group were clear.
+ */
+static atomic_t esphome_switch_on;
+
+/* The last state seen by the automations, a switch starts as off for them */
+static atomic_t esphome_switch_triggered;
+
+static struct esphome_switch *esphome_switch_find(const struct device *dev, int *index)
+{
+	*index = 0;
+	STRUCT_SECTION_FOREACH(esphome_switch, sw) {
+		if (sw->dev == dev) {
+			return sw;
+		}
+		(*index)++;
+	}
+
+	return NULL;
+}
+
+static bool esphome_switch_restores(const struct esphome_switch *sw)
+{
+	return sw->restore_mode >= ESPHOME_SWITCH_RESTORE_DEFAULT_OFF &&
+	       sw->restore_mode <= ESPHOME_SWITCH_RESTORE_INVERTED_DEFAULT_ON;
+}
+
+#ifdef CONFIG_ESPHOME_SWITCH_RESTORE
+static struct esphome_switch *esphome_switch_find_key(uint32_t key)
+{
+	STRUCT_SECTION_FOREACH(esphome_switch, sw) {
+		if (sw->key == key) {
+			return sw;
+		}
+	}
+
+	return NULL;
+}
+
+static void esphome_switch_save_work(struct k_work *work)
+{
+	struct esphome_switch_record records[ESPHOME_SWITCH_MAX];
+	atomic_val_t recorded[ESPHOME_SWITCH_MAX];
+	bool changed = false;
+	size_t count = 0;
+	int ret;
+
+	ARG_UNUSED(work);
+
+	STRUCT_SECTION_FOREACH(esphome_switch, sw) {
+		atomic_val_t state = atomic_get(&sw->recorded);
+
+		recorded[sw->index] = state;
+		if (state >= 0 && state != sw->persisted) {
+			changed = true;
+		} else {
+			/* Not changed since the boot, keep the restored state */
+			state = sw->persisted;
+		}
+
+		if (state < 0) {
+			continue;
+		}
+
+		records[count].key = sw->key;
+		records[count].state = state;
+		count++;
+	}
+
+	if (!changed) {
+		return;
+	}
+
+	/* The records of the switches removed from the devicetree are dropped */
+	ret = settings_save_one(ESPHOME_SWITCH_SETTINGS_KEY, records, count * sizeof(records[0]));
+	if (ret) {
+		LOG_ERR("Failed to save the switch states [%d]", ret);
+		return;
+	}
+
+	STRUCT_SECTION_FOREACH(esphome_switch, sw) {
+		if (recorded[sw->index] >= 0) {
+			sw->persisted = recorded[sw->index];
+		}
+	}
+}
+
+static K_WORK_DELAYABLE_DEFINE(esphome_switch_save, esphome_switch_save_work);
+
+static int esphome_switch_set(const char *key, size_t len, settings_read_cb read_cb, void *cb_arg,
+			      void *param)
+{
+	struct esphome_switch_record records[ESPHOME_SWITCH_MAX];
+	struct esphome_switch *sw;
+	ssize_t ret;
+
+	ARG_UNUSED(param);
+
+	/* The states used to be saved one record per switch, below the key */
+	if (key && key[0] != '\0') {
+		return 0;
+	}
+
+	if (len > sizeof(records) || len % sizeof(records[0])) {
+		return -EINVAL;
+	}
+
+	ret = read_cb(cb_arg, records, len);
+	if (ret < 0) {
+		return ret;
+	}
+
+	for (size_t i = 0; i < ret / sizeof(records[0]); i++) {
+		/* The switches removed from the devicetree leave their state behind */
+		sw = esphome_switch_find_key(records[i].key);
+		if (sw) {
+			sw->persisted = !!records[i].state;
+		}
+	}
+
+	return 0;
+}
+
+static void esphome_switch_load(void)
+{
+	int ret;
+
+	ret = settings_subsys_init();
+	if (ret) {
+		LOG_ERR("Failed to initialize settings [%d]", ret);
+		return;
+	}
+
+	ret = settings_load_subtree_direct(ESPHOME_SWITCH_SETTINGS_KEY, esphome_switch_set, NULL);
+	if (ret) {
+		LOG_WRN("Failed to load the switch states [%d]", ret);
+	}
+}
+
+/*
+ * Every change within the delay is coalesced into a single write, e.g. when
+ * a scene toggles many relays.
+ */
+static void esphome_switch_schedule_save(void)
+{
+	k_work_schedule(&esphome_switch_save, K_MSEC(CONFIG_ESPHOME_SWITCH_RESTORE_SAVE_DELAY));
+}
+#else
+static inline void esphome_switch_load(void)
+{
+}
+
+static inline void esphome_switch_schedule_save(void)
+{
+}
+#endif /* CONFIG_ESPHOME_SWITCH_RESTORE */
+
+static void esphome_switch_record_state(const struct device *dev)
+{
+	struct esphome_switch *sw;
+	int index;
+	int state;
+
+	sw = esphome_switch_find(dev, &index);
+	if (!sw || !esphome_switch_restores(sw)) {
+		return;
+	}
+
+	if (esphome_switch_get_state(dev, &state) < 0) {
+		return;
+	}
+
+	if (atomic_set(&sw->recorded, !!state) != !!state) {
+		esphome_switch_schedule_save();
+	}
+}
+
+static void esphome_switch_track_state(const struct device *dev)
+{
+	int index;
+	int state;
+
+	if (!esphome_switch_find(dev, &index)) {
+		return;
+	}
+
+	if (esphome_switch_get_state(dev, &state) < 0) {
+		return;
+	}
+
+	if (state) {
+		atomic_set_bit(&esphome_switch_on, index);
+	} else {
+		atomic_clear_bit(&esphome_switch_on, index);
+	}
+}
+
+static void esphome_switch_run_automations(const struct device *dev)
+{
+	bool was_on;
+	int index;
+	int state;
+
+	if (!IS_ENABLED(CONFIG_ESPHOME_AUTOMATION)) {
+		return;
+	}
+
+	if (esphome_switch_get_state(dev, &state) < 0) {
+		return;
+	}
+
+	if (!esphome_switch_find(dev, &index)) {
+		was_on = !state;
+	} else if (state) {
+		was_on = atomic_test_and_set_bit(&esphome_switch_triggered, index);
+	} else {
+		was_on = atomic_test_and_clear_bit(&esphome_switch_triggered, index);
+	}
+
+	/* Only on a change, a switch set to its current state triggers nothing */
+	if (was_on != !!state) {
+		esphome_automation_trigger(state ? ESPHOME_TRIGGER_TURN_ON
+						 : ESPHOME_TRIGGER_TURN_OFF, dev);
+	}
+}
+
+static void esphome_switch_report_state(const struct device *dev)
+{
+#ifdef CONFIG_ESPHOME_COMPONENT_API
+	struct esphome_entity *entity;
+
+	entity = find_entity_by_device(dev);
+	if (entity) {
+		esphome_entity_state_changed(entity);
+	}
+#else
+	ARG_UNUSED(dev);
+#endif
+}
+
+void esphome_switch_state_changed(const struct device *dev)
+{
+	esphome_switch_track_state(dev);
+	esphome_switch_record_state(dev);
+	esphome_switch_report_state(dev);
+	esphome_switch_run_automations(dev);
+}
+
+/* Turn off the other switches of the group, and cancel their pending turn on */
+static void esphome_switch_interlock_off(const struct esphome_switch *sw)
+{
+	STRUCT_SECTION_FOREACH(esphome_switch, peer) {
+		const struct esphome_switch_component_api *api = peer->dev->api;
+		int ret;
+
+		if (!(sw->interlock_mask & BIT(peer->index))) {
+			continue;
+		}
+
+		k_work_cancel_delayable(&peer->interlock_work);
+		if (!atomic_test_and_clear_bit(&esphome_switch_on, peer->index)) {
+			continue;
+		}
+
+		ret = api->set_state(peer->dev, false);
+		if (ret < 0) {
+			LOG_ERR("Failed to turn off %s [%d]", peer->dev->name, ret);
+		}
+	}
+}
+
+static int esphome_switch_interlock_on(struct esphome_switch *sw)
+{
+	const struct esphome_switch_component_api *api = sw->dev->api;
+	atomic_val_t old;
+
+	for (;;) {
+		old = atomic_get(&esphome_switch_on);
+		if (!(old & sw->interlock_mask)) {
+			if (atomic_cas(&esphome_switch_on, old, old | BIT(sw->index))) {
+				break;
+			}
+			continue;
+		}
+
+		esphome_switch_interlock_off(sw);
+		if (sw->interlock_wait_time) {
+			/* Checked again once the wait is over, the last request wins */
+			k_work_reschedule(&sw->interlock_work, K_MSEC(sw->interlock_wait_time));
+			return 0;
+		}
+	}
+
+	return api->set_state(sw->dev, true);
+}
+
+static void esphome_switch_interlock_work(struct k_work *work)
+{
+	struct k_work_delayable *work_delayable = k_work_delayable_from_work(work);
+	struct esphome_switch *sw = CONTAINER_OF(work_delayable, struct esphome_switch,
+						 interlock_work);
+	int ret;
+
+	ret = esphome_switch_interlock_on(sw);
+	if (ret < 0) {
+		LOG_ERR("Failed to turn on %s [%d]", sw->dev->name, ret);
+	}
+}
+
+static int esphome_switch_do_set_state(const struct device *dev, int state)
+{
+	const struct esphome_switch_component_api *api = dev->api;
+	struct esphome_switch *sw;
+	int index;
+
+	sw = esphome_switch_find(dev, &index);
+	if (!sw || !sw->interlock_mask) {
+		return api->set_state(dev, state);
+	}
+
+	k_work_cancel_delayable(&sw->interlock_work);
+	if (state) {
+		return esphome_switch_interlock_on(sw);
+	}
+
+	atomic_clear_bit(&esphome_switch_on, sw->index);
+
+	return api->set_state(dev, false);
+}
+
+int esphome_switch_set_state(const struct device *dev, int state)
+{
+	uint32_t start = esphome_timing_start();
+	int ret;
+
+	ret = esphome_switch_do_set_state(dev, state);
+	esphome_timing_end(dev, dev->name, start);
+
+	return ret;
+}
+
+static const struct gpio_dt_spec *esphome_switch_get_gpio(const struct device *dev)
+{
+	const struct esphome_switch_component_api *api = dev->api;
+	struct esphome_switch *sw;
+	int index;
+
+	if (!api->get_gpio || !api->commit_state) {
+		return NULL;
+	}
+
+	/* The interlocked switches go through esphome_switch_set_state() */
+	sw = esphome_switch_find(dev, &index);
+	if (sw && sw->interlock_mask) {
+		return NULL;
+	}
+
+	return api->get_gpio(dev);
+}
+
+/* Set, with one call, all the GPIO switches from index first that share its port */
+static int esphome_switch_set_port(const struct device *const *devs, const int *states,
+				   size_t count, size_t first)
+{
+	const struct device *port = esphome_switch_get_gpio(devs[first])->port;
+	gpio_port_pins_t mask = 0;
+	gpio_port_value_t value = 0;
+	int ret;
+
+	for (size_t i = first; i < count; i++) {
+		const struct gpio_dt_spec *gpio = esphome_switch_get_gpio(devs[i]);
+
+		if (!gpio || gpio->port != port) {
+			continue;
+		}
+
+		/* The same switch may be listed twice, the last state wins */
+		mask |= BIT(gpio->pin);
+		value &= ~BIT(gpio->pin);
+		if (states[i]) {
+			value |= BIT(gpio->pin);
+		}
+	}
+
+	ret = gpio_port_set_masked(port, mask, value);
+	if (ret < 0) {
+		LOG_ERR("Failed to set gpio port state");
+		return ret;
+	}
+
+	for (size_t i = first; i < count; i++) {
+		const struct esphome_switch_component_api *api = devs[i]->api;
+		const struct gpio_dt_spec *gpio = esphome_switch_get_gpio(devs[i]);
+
+		if (gpio && gpio->port == port) {
+			api->commit_state(devs[i], states[i]);
+		}
+	}
+
+	return 0;
+}
+
+static bool esphome_switch_port_done(const struct device *const *devs, size_t index,
+				     const struct device *port)
+{
+	for (size_t i = 0; i < index; i++) {
+		const struct gpio_dt_spec *gpio = esphome_switch_get_gpio(devs[i]);
+
+		if (gpio && gpio->port == port) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int esphome_switch_set_states(const struct device *const *devs, const int *states, size_t count)
+{
+	int err = 0;
+	int ret;
+
+	for (size_t i = 0; i < count; i++) {
+		const struct gpio_dt_spec *gpio = esphome_switch_get_gpio(devs[i]);
+
+		if (!gpio) {
+			ret = esphome_switch_set_state(devs[i], states[i]);
+		} else if (!esphome_switch_port_done(devs, i, gpio->port)) {
+			ret = esphome_switch_set_port(devs, states, count, i);
+		} else {
+			continue;
+		}
+
+		if (ret < 0 && !err) {
+			err = ret;
+		}
+	}
+
+	return err;
+}
+
+static int esphome_switch_initial_state(const struct esphome_switch *sw)
+{
+	bool valid = sw->persisted >= 0;
+	bool saved = sw->persisted > 0;
+
+	switch (sw->restore_mode) {
+	case ESPHOME_SWITCH_ALWAYS_OFF:
+		return 0;
+	case ESPHOME_SWITCH_ALWAYS_ON:
+		return 1;
+	case ESPHOME_SWITCH_RESTORE_DEFAULT_OFF:
+		return valid ? saved : 0;
+	case ESPHOME_SWITCH_RESTORE_DEFAULT_ON:
+		return valid ? saved : 1;
+	case ESPHOME_SWITCH_RESTORE_INVERTED_DEFAULT_OFF:
+		return valid ? !saved : 0;
+	case ESPHOME_SWITCH_RESTORE_INVERTED_DEFAULT_ON:
+		return valid ? !saved : 1;
+	case ESPHOME_SWITCH_RESTORE_DISABLED:
+	default:
+		return -ENOENT;
+	}
+}
+
+static void esphome_switch_init(void)
+{
+	int index = 0;
+
+	STRUCT_SECTION_FOREACH(esphome_switch, sw) {
+		sw->index = index++;
+#ifdef CONFIG_ESPHOME_SWITCH_RESTORE
+		sw->key = crc32_ieee(sw->object_id, strlen(sw->object_id));
+#endif
+		sw->persisted = -1;
+		atomic_set(&sw->recorded, -1);
+		k_work_init_delayable(&sw->interlock_work, esphome_switch_interlock_work);
+	}
+
+	STRUCT_SECTION_FOREACH(esphome_switch, sw) {
+		for (size_t i = 0; i < sw->interlock_count; i++) {
+			const struct esphome_switch *peer = esphome_switch_find(sw->interlock[i],
+										&index);
+
+			if (!peer || peer == sw) {
+				continue;
+			}
+
+			sw->interlock_mask |= BIT(index);
+		}
+	}
+}
+
+/*
+ * Apply the restore mode of every switch once the drivers and the settings
+ * backend are ready, batching the GPIO switches by port.
+ */
+static int esphome_switch_restore(void)
+{
+	const struct device *devs[ESPHOME_SWITCH_MAX];
+	int states[ESPHOME_SWITCH_MAX];
+	size_t count = 0;
+
+	esphome_switch_init();
+	esphome_switch_load();
+
+	STRUCT_SECTION_FOREACH(esphome_switch, sw) {
+		int state = esphome_switch_initial_state(sw);
+
+		if (state < 0 || !device_is_ready(sw->dev)) {
+			continue;
+		}
+
+		devs[count] = sw->dev;
+		states[count] = state;
+		if (++count == ARRAY_SIZE(devs)) {
+			esphome_switch_set_states(devs, states, count);
+			count = 0;
+		}
+	}
+
+	if (count) {
+		esphome_switch_set_states(devs, states, count);
+	}
+
+	return 0;
+}
+
+SYS_INIT(esphome_switch_restore, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+
+#include <esphome/timing.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(ESPHome, CONFIG_ESPHOME_LOG_LEVEL);
+
+struct esphome_timing_entry {
+	/* NULL when the entry is free */
+	const void *component;
+	struct esphome_timing_stats stats;
+};
+
+static struct esphome_timing_entry esphome_timing_entries[CONFIG_ESPHOME_TIMING_MAX_COMPONENTS];
+static struct k_spinlock esphome_timing_lock;
+static bool esphome_timing_full;
+
+/* Open addressing, the components are never removed */
+static struct esphome_timing_entry *esphome_timing_find(const void *component, bool add)
+{
+	size_t size = ARRAY_SIZE(esphome_timing_entries);
+	size_t hash = ((uintptr_t)component >> 2) % size;
+
+	for (size_t i = 0; i < size; i++) {
+		struct esphome_timing_entry *entry = &esphome_timing_entries[(hash + i) % size];
+
+		if (entry->component == component) {
+			return entry;
+		}
+
+		if (!entry->component) {
+			if (!add) {
+				return NULL;
+			}
+			entry->component = component;
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+void esphome_timing_end(const void *component, const char *name, uint32_t start)
+{
+	uint32_t elapsed = k_cyc_to_us_ceil32(k_cycle_get_32() - start);
+	struct esphome_timing_entry *entry;
+	bool full = false;
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&esphome_timing_lock);
+	entry = esphome_timing_find(component, true);
+	if (entry) {
+		entry->stats.name = name;
+		entry->stats.count++;
+		entry->stats.total_us += elapsed;
+		entry->stats.max_us = MAX(entry->stats.max_us, elapsed);
+	} else if (!esphome_timing_full) {
+		esphome_timing_full = full = true;
+	}
+	k_spin_unlock(&esphome_timing_lock, key);
+
+	if (full) {
+		LOG_WRN("Too many components, increase CONFIG_ESPHOME_TIMING_MAX_COMPONENTS");
+	}
+
+	if (elapsed >= CONFIG_ESPHOME_TIMING_WARN_THRESHOLD * USEC_PER_MSEC) {
+		LOG_WRN("%s took a long time for an operation (%u ms)", name,
+			elapsed / USEC_PER_MSEC);
+	}
+}
+
+int esphome_timing_get(const void *component, struct esphome_timing_stats *stats)
+{
+	struct esphome_timing_entry *entry;
+	k_spinlock_key_t key;
+	int ret = 0;
+
+	key = k_spin_lock(&esphome_timing_lock);
+	entry = esphome_timing_find(component, false);
+	if (entry) {
+		*stats = entry->stats;
+	} else {
+		ret = -ENOENT;
+	}
+	k_spin_unlock(&esphome_timing_lock, key);
+
+	return ret;
+}
+
+void esphome_timing_foreach(esphome_timing_cb cb, void *user_data)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(esphome_timing_entries); i++) {
+		struct esphome_timing_stats stats;
+		const void *component;
+		k_spinlock_key_t key;
+
+		key = k_spin_lock(&esphome_timing_lock);
+		component = esphome_timing_entries[i].component;
+		stats = esphome_timing_entries[i].stats;
+		k_spin_unlock(&esphome_timing_lock, key);
+
+		if (component) {
+			cb(component, &stats, user_data);
+		}
+	}
+}
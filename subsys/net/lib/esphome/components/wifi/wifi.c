@@ -15,6 +15,7 @@
 
 LOG_MODULE_REGISTER(ESPHome);
 
+#include <esphome/automation.h>
 #include <esphome/esphome.h>
 
 #include "wifi.h"
@@ -25,23 +26,36 @@ LOG_MODULE_REGISTER(ESPHome);
 
 static void wifi_connect(const struct device *dev);
 
-static void wifi_status(void)
+static int wifi_status(struct wifi_iface_status *status)
 {
 	struct net_if *iface = net_if_get_default();
 
-	struct wifi_iface_status status = {0};
-
-	if (net_mgmt(NET_REQUEST_WIFI_IFACE_STATUS, iface, &status,
+	if (net_mgmt(NET_REQUEST_WIFI_IFACE_STATUS, iface, status,
 		     sizeof(struct wifi_iface_status))) {
 		LOG_ERR("WiFi Status Request Failed");
+		return -EIO;
+	}
+
+	if (status->state < WIFI_STATE_ASSOCIATED) {
+		return -ENOTCONN;
 	}
 
-	if (status.state >= WIFI_STATE_ASSOCIATED) {
-		LOG_INF("SSID: %-32s\n", status.ssid);
-		LOG_INF("Band: %s\n", wifi_band_txt(status.band));
-		LOG_INF("Channel: %d\n", status.channel);
-		LOG_INF("Security: %s\n", wifi_security_txt(status.security));
-		LOG_INF("RSSI: %d\n", status.rssi);
+	LOG_INF("SSID: %-32s\n", status->ssid);
+	LOG_INF("Band: %s\n", wifi_band_txt(status->band));
+	LOG_INF("Channel: %d\n", status->channel);
+	LOG_INF("Security: %s\n", wifi_security_txt(status->security));
+	LOG_INF("RSSI: %d\n", status->rssi);
+
+	return 0;
+}
+
+static void wifi_connect_retry(struct esphome_wifi_data *wifi_data)
+{
+	/* The network wasn't found on its cached channel, scan them all right away */
+	if (wifi_credentials_failed()) {
+		k_work_schedule(&wifi_data->work, K_NO_WAIT);
+	} else {
+		k_work_schedule(&wifi_data->work, K_MSEC(15000));
 	}
 }
 
@@ -50,16 +64,22 @@ static void handle_wifi_connect_result(struct net_mgmt_event_callback *cb)
 	struct esphome_wifi_data *wifi_data = CONTAINER_OF(cb, struct esphome_wifi_data, event_cb);
 	const struct esphome_wifi_config *wifi_cfg = wifi_data->dev->config;
 	const struct wifi_status *status = (const struct wifi_status *)cb->info;
+	struct wifi_iface_status iface_status = {0};
 
 	if (status->status) {
 		LOG_ERR("Connection request failed (%d)\n", status->status);
-		k_work_schedule(&wifi_data->work, K_MSEC(15000));
+		wifi_connect_retry(wifi_data);
 	} else {
 		LOG_INF("Connected\n");
-		wifi_status();
+		/* A failure event of the previous attempt may have scheduled another one */
+		k_work_cancel_delayable(&wifi_data->work);
+		if (!wifi_status(&iface_status)) {
+			wifi_credentials_connected(&iface_status);
+		}
 		if (wifi_cfg->on_connect) {
 			wifi_cfg->on_connect();
 		}
+		esphome_automation_trigger(ESPHOME_TRIGGER_CONNECT, wifi_data->dev);
 	}
 }
 
@@ -72,7 +92,7 @@ static void handle_wifi_disconnect_result(struct net_mgmt_event_callback *cb)
 	if (status->status) {
 		LOG_ERR("Disconnection request (%d)\n", status->status);
 		/* Not sure why we get here when we fail to connect */
-		k_work_schedule(&wifi_data->work, K_MSEC(15000));
+		wifi_connect_retry(wifi_data);
 	} else {
 		if (wifi_cfg->on_disconnect) {
 			wifi_cfg->on_disconnect();
@@ -108,11 +128,14 @@ static void wifi_connect(const struct device *dev)
 	wifi_credentials_get_next(&wifi_params);
 	LOG_INF("Connecting to SSID: %s\n", wifi_params.ssid);
 	LOG_INF("Security: %s\n", wifi_security_txt(wifi_params.security));
+	if (wifi_params.channel != WIFI_CHANNEL_ANY) {
+		LOG_INF("Channel: %d\n", wifi_params.channel);
+	}
 
 	if (net_mgmt(NET_REQUEST_WIFI_CONNECT, iface, &wifi_params,
 		     sizeof(struct wifi_connect_req_params))) {
 		LOG_ERR("WiFi Connection Request Failed\n");
-		k_work_schedule(&wifi_data->work, K_MSEC(15000));
+		wifi_connect_retry(wifi_data);
 	}
 }
 
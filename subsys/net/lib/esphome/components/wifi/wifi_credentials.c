@@ -11,10 +11,16 @@
 
 #include <zephyr/device.h>
 #include <zephyr/devicetree.h>
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/crc.h>
 #include <zephyr/sys/util_internal.h>
 
 #include "wifi_credentials.h"
 
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(ESPHome, CONFIG_ESPHOME_LOG_LEVEL);
+
 struct wifi_credentials_config {
 	const struct wifi_connect_req_params *credentials;
 	uint8_t count;
@@ -22,6 +28,13 @@ struct wifi_credentials_config {
 
 struct wifi_credentials_data {
 	uint8_t selected;
+	/* The credential of the last connection request */
+	uint8_t current;
+	/* The last request only scanned the cached channel */
+	bool directed;
+	/* Retry the current credential with a full scan */
+	bool fallback;
+	bool loaded;
 };
 
 #define WIFI_SECURITY_TYPE(node_id)                                                                \
@@ -46,6 +59,91 @@ static struct wifi_credentials_config wifi_cfg = {
 };
 static struct wifi_credentials_data wifi_data;
 
+#ifdef CONFIG_ESPHOME_WIFI_FAST_CONNECT
+static struct wifi_credentials_ap wifi_ap[ARRAY_SIZE(wifi_credentials)];
+
+#ifdef CONFIG_ESPHOME_WIFI_FAST_CONNECT_SAVE
+static void wifi_credentials_save_work(struct k_work *work)
+{
+	int ret;
+
+	ARG_UNUSED(work);
+
+	ret = settings_save_one(WIFI_CREDENTIALS_SETTINGS_KEY, wifi_ap, sizeof(wifi_ap));
+	if (ret) {
+		LOG_WRN("Failed to save the wifi channels [%d]", ret);
+	}
+}
+
+static K_WORK_DEFINE(wifi_credentials_save, wifi_credentials_save_work);
+
+static int wifi_credentials_set(const char *key, size_t len, settings_read_cb read_cb,
+				void *cb_arg, void *param)
+{
+	ssize_t ret;
+
+	if (key && key[0] != '\0') {
+		return 0;
+	}
+
+	/* Recorded for another list of credentials */
+	if (len != sizeof(wifi_ap)) {
+		return 0;
+	}
+
+	ret = read_cb(cb_arg, wifi_ap, len);
+
+	return ret < 0 ? ret : 0;
+}
+
+static void wifi_credentials_load(void)
+{
+	int ret;
+
+	ret = settings_subsys_init();
+	if (ret) {
+		LOG_ERR("Failed to initialize settings [%d]", ret);
+		return;
+	}
+
+	ret = settings_load_subtree_direct(WIFI_CREDENTIALS_SETTINGS_KEY, wifi_credentials_set,
+					   NULL);
+	if (ret) {
+		LOG_WRN("Failed to load the wifi channels [%d]", ret);
+	}
+}
+#else
+static inline void wifi_credentials_load(void)
+{
+}
+#endif /* CONFIG_ESPHOME_WIFI_FAST_CONNECT_SAVE */
+
+static uint32_t wifi_credentials_ssid_crc(int credential_id)
+{
+	const struct wifi_connect_req_params *credential = &wifi_cfg.credentials[credential_id];
+
+	return crc32_ieee(credential->ssid, credential->ssid_length);
+}
+
+/*
+ * Only scan the channel of the last connection, if any. The BSSID isn't
+ * pinned, so the station may still join or roam to another access point of
+ * the network on that channel.
+ */
+static void wifi_credentials_direct(int credential_id, struct wifi_connect_req_params *params)
+{
+	const struct wifi_credentials_ap *ap = &wifi_ap[credential_id];
+
+	if (!ap->valid || ap->ssid_crc != wifi_credentials_ssid_crc(credential_id)) {
+		return;
+	}
+
+	params->channel = ap->channel;
+	params->band = ap->band;
+	wifi_data.directed = true;
+}
+#endif /* CONFIG_ESPHOME_WIFI_FAST_CONNECT */
+
 void wifi_credentials_get_current(struct wifi_connect_req_params *params)
 {
 	memcpy(params, &wifi_cfg.credentials[wifi_data.selected], sizeof(*params));
@@ -55,10 +153,69 @@ void wifi_credentials_get_next(struct wifi_connect_req_params *params)
 {
 	int credential_id;
 
+	if (wifi_data.fallback) {
+		wifi_data.fallback = false;
+		memcpy(params, &wifi_cfg.credentials[wifi_data.current], sizeof(*params));
+		return;
+	}
+
 	credential_id = wifi_data.selected++;
 	if (wifi_data.selected >= wifi_cfg.count) {
 		wifi_data.selected = 0;
 	}
 
+	wifi_data.current = credential_id;
 	memcpy(params, &wifi_cfg.credentials[credential_id], sizeof(*params));
+
+#ifdef CONFIG_ESPHOME_WIFI_FAST_CONNECT
+	if (!wifi_data.loaded) {
+		wifi_credentials_load();
+		wifi_data.loaded = true;
+	}
+
+	wifi_credentials_direct(credential_id, params);
+#endif
+}
+
+bool wifi_credentials_failed(void)
+{
+	if (!wifi_data.directed) {
+		return false;
+	}
+
+	/* The network moved to another channel or is gone, scan every channel */
+	LOG_INF("Network not found on its last channel, scanning");
+	wifi_data.directed = false;
+	wifi_data.fallback = true;
+
+	return true;
+}
+
+void wifi_credentials_connected(const struct wifi_iface_status *status)
+{
+#ifdef CONFIG_ESPHOME_WIFI_FAST_CONNECT
+	struct wifi_credentials_ap *ap = &wifi_ap[wifi_data.current];
+	uint32_t ssid_crc = wifi_credentials_ssid_crc(wifi_data.current);
+#endif
+
+	wifi_data.directed = false;
+	wifi_data.fallback = false;
+
+	/* Reconnect with the credential that worked first */
+	wifi_data.selected = wifi_data.current;
+
+#ifdef CONFIG_ESPHOME_WIFI_FAST_CONNECT
+	if (ap->valid && ap->ssid_crc == ssid_crc && ap->channel == status->channel &&
+	    ap->band == status->band) {
+		return;
+	}
+
+	ap->ssid_crc = ssid_crc;
+	ap->channel = status->channel;
+	ap->band = status->band;
+	ap->valid = true;
+#ifdef CONFIG_ESPHOME_WIFI_FAST_CONNECT_SAVE
+	k_work_submit(&wifi_credentials_save);
+#endif
+#endif /* CONFIG_ESPHOME_WIFI_FAST_CONNECT */
 }
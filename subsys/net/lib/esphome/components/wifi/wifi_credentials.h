@@ -9,7 +9,30 @@
 
 #include <zephyr/net/wifi_mgmt.h>
 
+#ifdef CONFIG_ESPHOME_WIFI_FAST_CONNECT
+/*
+ * The channel and band a credential last connected on, the settings record
+ * holds one per credential. The SSID checksum drops the entries recorded
+ * before the credentials were changed.
+ */
+struct wifi_credentials_ap {
+	uint32_t ssid_crc;
+	uint8_t channel;
+	uint8_t band;
+	bool valid;
+};
+
+#define WIFI_CREDENTIALS_SETTINGS_KEY "esphome/wifi/ap"
+#endif
+
 void wifi_credentials_get_current(struct wifi_connect_req_params *params);
 void wifi_credentials_get_next(struct wifi_connect_req_params *params);
 
+/*
+ * Report the outcome of the last request. Returns true when it only scanned
+ * the cached channel, the next request is a full scan for the same network.
+ */
+bool wifi_credentials_failed(void);
+void wifi_credentials_connected(const struct wifi_iface_status *status);
+
 #endif /* ESPHOME_WIFI_CREDENTIALS_H */
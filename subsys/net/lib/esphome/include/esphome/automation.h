@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ESPHOME_AUTOMATION_H
+#define ESPHOME_AUTOMATION_H
+
+#include <zephyr/device.h>
+#include <zephyr/kernel.h>
+
+/* Must match the order of the trigger enum in the binding */
+enum esphome_trigger {
+	ESPHOME_TRIGGER_BOOT,
+	ESPHOME_TRIGGER_PRESS,
+	ESPHOME_TRIGGER_CONNECT,
+	ESPHOME_TRIGGER_TURN_ON,
+	ESPHOME_TRIGGER_TURN_OFF,
+};
+
+/* Must match the order of the action enum in the binding */
+enum esphome_action_type {
+	ESPHOME_ACTION_TURN_ON,
+	ESPHOME_ACTION_TURN_OFF,
+	ESPHOME_ACTION_TOGGLE,
+	ESPHOME_ACTION_PRESS,
+	ESPHOME_ACTION_DELAY,
+};
+
+struct esphome_action {
+	enum esphome_action_type type;
+	const struct device *target;
+	uint32_t delay;
+};
+
+/*
+ * An automation runs its actions in order on the system work queue. A delay
+ * reschedules the rest of the actions instead of sleeping, so the work queue
+ * is never blocked. A trigger received while the automation runs is dropped.
+ */
+struct esphome_automation {
+	enum esphome_trigger trigger;
+	/* Device the trigger must come from, or NULL for any */
+	const struct device *source;
+	const struct esphome_action *actions;
+	size_t num_actions;
+
+	struct k_work_delayable work;
+	atomic_t running;
+	size_t next;
+};
+
+#ifdef CONFIG_ESPHOME_AUTOMATION
+/* Start the automations of a trigger, it returns without waiting for them */
+void esphome_automation_trigger(enum esphome_trigger trigger, const struct device *source);
+#else
+static inline void esphome_automation_trigger(enum esphome_trigger trigger,
+					      const struct device *source)
+{
+}
+#endif
+
+#endif /* ESPHOME_AUTOMATION_H */
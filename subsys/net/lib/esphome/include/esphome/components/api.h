@@ -4,6 +4,12 @@
 #ifdef CONFIG_ESPHOME_COMPONENT_API
 #include <rpc/esphome_rpc.h>
 #include <rpc/api.pb-c.h>
+
+bool esphome_api_is_subscribed(const struct device *api_dev);
+/* Get the API devices, one per connection, and return their number */
+size_t esphome_api_get_devices(const struct device *const **devs);
+/* Have ConnectionWakeCb() called from the thread or the loop of the connection */
+void esphome_api_wake(const struct device *api_dev);
 #endif
 
 #endif /* ESPHOME_API_COMPONENT_H */
@@ -8,6 +8,7 @@
 #define ESPHOME_COMPONENT_BUTTON_H
 
 #include <zephyr/device.h>
+#include <zephyr/kernel.h>
 
 #include <esphome/components/api.h>
 #include <esphome/components/entity.h>
@@ -15,16 +16,44 @@
 typedef int (*esphome_on_press)(const struct device *dev);
 
 struct esphome_button_config {
+	/* Optional, the button may only trigger automations */
 	esphome_on_press on_press;
 };
 
+struct esphome_button_stats {
+	/* Number of on_press executions */
+	uint32_t count;
+	/* Presses dropped because the press queue was full */
+	uint32_t dropped;
+	/* Execution time of on_press, in microseconds */
+	uint64_t total_us;
+	uint32_t max_us;
+};
+
+struct esphome_button_data {
+	struct k_spinlock lock;
+	struct esphome_button_stats stats;
+};
+
 static inline int esphome_button_on_press(const struct device *dev)
 {
 	const struct esphome_button_config *config = dev->config;
 
+	if (!config->on_press) {
+		return 0;
+	}
+
 	return config->on_press(dev);
 }
 
+/*
+ * Queue a press, on_press is run later from the button work queue. Returns
+ * -ENOMEM if too many presses are already pending.
+ */
+int esphome_button_press(const struct device *dev);
+
+void esphome_button_get_stats(const struct device *dev, struct esphome_button_stats *stats);
+
 #ifdef CONFIG_ESPHOME_COMPONENT_API
 static inline int esphome_button_list_entity(const struct device *api_dev,
 					     struct esphome_entity *entity)
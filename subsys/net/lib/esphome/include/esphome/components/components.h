@@ -4,5 +4,6 @@
 #include <esphome/components/button.h>
 #include <esphome/components/sensor.h>
 #include <esphome/components/switch.h>
+#include <esphome/components/update.h>
 
 #endif /* ESPHOME_COMPONENTS_H */
@@ -11,6 +11,7 @@
 
 #include <stdlib.h>
 #include <zephyr/devicetree.h>
+#include <zephyr/sys/atomic.h>
 #include <zephyr/toolchain.h>
 #include <esphome/components/api.h>
 
@@ -57,6 +58,11 @@ struct esphome_entity_data {
 	uint32_t key;
 	/* Find a way to get it using DT */
 	const struct device *api_dev;
+	/*
+	 * One bit per API connection, in the order of esphome_api_get_devices(),
+	 * set when the state has changed and has not been sent to it yet
+	 */
+	atomic_t dirty;
 };
 
 struct esphome_entity {
@@ -64,9 +70,11 @@ struct esphome_entity {
 	const struct esphome_entity_config *config;
 	struct esphome_entity_data *data;
 	int (*list_entity)(const struct device *api_dev, struct esphome_entity *entity);
+	/* Optional, send the current state of the entity */
+	int (*send_state)(const struct device *api_dev, struct esphome_entity *entity);
 };
 
-#define DEFINE_ESPHOME_ENTITY(_num, name, _device_class, _list_entity)                             \
+#define DEFINE_ESPHOME_ENTITY_STATE(_num, name, _device_class, _list_entity, _send_state)          \
 	static struct esphome_entity_config name##_entity_config =                                 \
 		DT_ESPHOME_ENTITY(_num, _device_class);                                            \
 	static struct esphome_entity_data name##_entity_data;                                      \
@@ -75,18 +83,38 @@ struct esphome_entity {
 		.config = &name##_entity_config,                                                   \
 		.data = &name##_entity_data,                                                       \
 		.list_entity = _list_entity,                                                       \
+		.send_state = _send_state,                                                         \
 	}
 
+#define DEFINE_ESPHOME_ENTITY(_num, name, _device_class, _list_entity)                             \
+	DEFINE_ESPHOME_ENTITY_STATE(_num, name, _device_class, _list_entity, NULL)
+
 int _string_copy_safe(char *dest, const char *src, size_t len);
 #define strcpy_safe(_dest, _src) _string_copy_safe(_dest, _src, ARRAY_SIZE(_dest))
 
 uint32_t fnv1_hash(const char *str);
 const struct device *find_device_entity_by_key(uint32_t key);
+struct esphome_entity *find_entity_by_device(const struct device *dev);
+
+/*
+ * Mark the state of the entity as changed, from any thread. Each subscribed
+ * API connection is woken up and sends it from its own thread, along with
+ * the other states changed in the meantime.
+ */
+void esphome_entity_state_changed(const struct esphome_entity *entity);
+/*
+ * Send the changed states to the connection, from its thread. Returns the
+ * first send error, the connection should then be closed.
+ */
+int esphome_entity_flush(const struct device *api_dev);
+/* Send the state of every entity to a client that just subscribed, and only to it */
+int esphome_entity_send_all(const struct device *api_dev);
 int esphome_entity_init(const struct device *api_dev);
 
 #else
 
 #define DEFINE_ESPHOME_ENTITY(_num, name, _device_class, _list_entity)
+#define DEFINE_ESPHOME_ENTITY_STATE(_num, name, _device_class, _list_entity, _send_state)
 
 #endif /* CONFIG_ESPHOME_COMPONENT_API */
 
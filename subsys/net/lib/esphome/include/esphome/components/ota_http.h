@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ESPHOME_COMPONENT_OTA_HTTP_H
+#define ESPHOME_COMPONENT_OTA_HTTP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ESPHOME_OTA_HTTP_URL_MAX 128
+
+/*
+ * The manifest is a JSON object, e.g.
+ *   {"version": "1.2.0", "url": "zephyr.signed.bin", "size": 524288, "md5": "..."}
+ * The url of the image is either absolute or relative to the manifest.
+ */
+struct esphome_ota_http_manifest {
+	char version[24];
+	char url[ESPHOME_OTA_HTTP_URL_MAX];
+	uint32_t size;
+	char md5[32 + 1];
+};
+
+/* Fetch and parse the manifest */
+int esphome_ota_http_check(const char *url, struct esphome_ota_http_manifest *manifest);
+
+/* Called from the download thread with the result of esphome_ota_http_check() */
+typedef void (*esphome_ota_http_check_handler_t)(int ret,
+						 const struct esphome_ota_http_manifest *manifest);
+
+/*
+ * Run esphome_ota_http_check() on the download thread, returns -EBUSY if a
+ * check is already running.
+ */
+int esphome_ota_http_check_async(const char *url, esphome_ota_http_check_handler_t handler);
+
+/*
+ * Download the image of the manifest fetched from url, with range requests so
+ * an interrupted download continues where it stopped. Returns 0 once the
+ * upgrade is requested, the caller reboots.
+ */
+int esphome_ota_http_install(const char *url, const struct esphome_ota_http_manifest *manifest);
+
+/* Install the image of the manifest, returns -EALREADY if it is already running */
+int esphome_ota_http_update(const char *url);
+
+/* Called from the download thread */
+struct esphome_ota_http_listener {
+	/* After each range written */
+	void (*progress)(size_t received, size_t size);
+	/* With the result of esphome_ota_http_update(), the caller reboots */
+	void (*done)(int ret);
+};
+
+/*
+ * Run esphome_ota_http_update() on the download thread, returns -EBUSY if a
+ * download is already running. Without done, the device reboots once the
+ * image is installed.
+ */
+int esphome_ota_http_update_async(const char *url,
+				  const struct esphome_ota_http_listener *listener);
+
+#endif /* ESPHOME_COMPONENT_OTA_HTTP_H */
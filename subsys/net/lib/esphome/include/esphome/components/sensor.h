@@ -2,19 +2,42 @@
 #define ESPHOME_SENSOR_COMPONENT_H
 
 #include <zephyr/device.h>
+#include <zephyr/kernel.h>
 #include <zephyr/drivers/sensor.h>
 
 #include <esphome/components/api.h>
 #include <esphome/components/entity.h>
 
+#ifdef CONFIG_ESPHOME_SENSOR_FIXED_POINT
+/* Values are carried in micro-units (e.g. µ°C) and only converted to float on encode */
+typedef int64_t esphome_sensor_value_t;
+#else
+typedef float esphome_sensor_value_t;
+#endif
+
+struct esphome_sensor_listener {
+	sys_snode_t node;
+	/* Called, from the reader context, every time the sensor state is updated */
+	void (*updated)(struct esphome_sensor_listener *listener, esphome_sensor_value_t state);
+};
+
 struct esphome_sensor_data {
 	struct sensor_trigger trig;
 	bool data_rdy;
+
+	/* Last value read from the sensor */
+	esphome_sensor_value_t state;
+	bool has_state;
+
+	/* Components derived from this sensor, e.g. aggregates */
+	sys_slist_t listeners;
 };
 
 struct esphome_sensor_api {
 	int (*init)(const struct device *dev);
 	int (*read)(const struct device *dev, float *state);
+	/* Optional, read the value in micro-units without any float operation */
+	int (*read_micro)(const struct device *dev, int64_t *state);
 };
 
 static inline int esphome_sensor_init(const struct device *dev)
@@ -31,34 +54,170 @@ static inline int esphome_sensor_init(const struct device *dev)
 static inline int esphome_sensor_read(const struct device *dev, float *state)
 {
 	const struct esphome_sensor_api *api = dev->api;
+	int64_t micro;
+	int ret;
+
+	if (api->read) {
+		return api->read(dev, state);
+	}
 
-	return api->read(dev, state);
+	ret = api->read_micro(dev, &micro);
+	if (!ret) {
+		*state = (float)micro / 1000000.0f;
+	}
+
+	return ret;
+}
+
+static inline int esphome_sensor_read_micro(const struct device *dev, int64_t *state)
+{
+	const struct esphome_sensor_api *api = dev->api;
+	float value;
+	int ret;
+
+	if (api->read_micro) {
+		return api->read_micro(dev, state);
+	}
+
+	ret = api->read(dev, &value);
+	if (!ret) {
+		*state = (int64_t)(value * 1000000.0f);
+	}
+
+	return ret;
+}
+
+static inline float esphome_sensor_value_to_float(esphome_sensor_value_t value)
+{
+#ifdef CONFIG_ESPHOME_SENSOR_FIXED_POINT
+	return (float)value / 1000000.0f;
+#else
+	return value;
+#endif
+}
+
+/* Read the sensor using the configured value path and update its state */
+static inline int esphome_sensor_update(const struct device *dev, esphome_sensor_value_t *state)
+{
+	struct esphome_sensor_data *data = dev->data;
+	struct esphome_sensor_listener *listener;
+	int ret;
+
+#ifdef CONFIG_ESPHOME_SENSOR_FIXED_POINT
+	ret = esphome_sensor_read_micro(dev, state);
+#else
+	ret = esphome_sensor_read(dev, state);
+#endif
+	if (ret) {
+		return ret;
+	}
+
+	data->state = *state;
+	data->has_state = true;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&data->listeners, listener, node) {
+		listener->updated(listener, *state);
+	}
+
+	return 0;
+}
+
+/* Must be called before the sensor state is updated, i.e. at init time */
+static inline void esphome_sensor_add_listener(const struct device *dev,
+					       struct esphome_sensor_listener *listener)
+{
+	struct esphome_sensor_data *data = dev->data;
+
+	sys_slist_append(&data->listeners, &listener->node);
 }
 
 #ifdef CONFIG_ESPHOME_COMPONENT_API
+#ifdef CONFIG_ESPHOME_SENSOR_BUFFER
+struct esphome_sensor_sample {
+	/* k_uptime_get_32() at the time the sample was read */
+	uint32_t timestamp;
+	esphome_sensor_value_t state;
+};
+
+struct esphome_sensor_buffer {
+	struct k_spinlock lock;
+#ifdef CONFIG_ESPHOME_SENSOR_BUFFER_SETTINGS
+	/* Saved in front of the samples, a record of another layout is discarded */
+	uint32_t version;
+	uint32_t sample_size;
+#endif
+	struct esphome_sensor_sample samples[CONFIG_ESPHOME_SENSOR_BUFFER_SIZE];
+	uint16_t count;
+#ifdef CONFIG_ESPHOME_SENSOR_BUFFER_SETTINGS
+	bool loaded;
+	bool dirty;
+	uint32_t saved_at;
+#endif
+};
+#endif /* CONFIG_ESPHOME_SENSOR_BUFFER */
+
 struct esphome_sensor_entity {
 	const struct esphome_entity *entity;
+#ifdef CONFIG_ESPHOME_SENSOR_BUFFER
+	struct esphome_sensor_buffer *buffer;
+#endif
 };
 
 #define DEFINE_ESPHOME_SENSOR_ENTITY(_num, name)                                                   \
-	DEFINE_ESPHOME_ENTITY(_num, name, "sensor", esphome_sensor_list_entity);                   \
+	DEFINE_ESPHOME_ENTITY_STATE(_num, name, "sensor", esphome_sensor_list_entity,              \
+				    esphome_sensor_send_state);                                    \
+	IF_ENABLED(CONFIG_ESPHOME_SENSOR_BUFFER,                                                   \
+		   (static struct esphome_sensor_buffer name##_buffer;))                           \
 	STRUCT_SECTION_ITERABLE(esphome_sensor_entity, name##sensor_entity) = {                    \
 		.entity = &name,                                                                   \
+		IF_ENABLED(CONFIG_ESPHOME_SENSOR_BUFFER, (.buffer = &name##_buffer,))              \
 	}
 
-static inline void esphome_sensor_send_state(const struct device *api_dev,
-					     const struct esphome_entity *entity)
+static inline void esphome_sensor_write_state(const struct device *api_dev,
+					      const struct esphome_entity *entity,
+					      esphome_sensor_value_t state)
 {
 	struct esphome_entity_data *data = entity->data;
-	const struct device *dev = entity->dev;
 	SensorStateResponse response = SENSOR_STATE_RESPONSE__INIT;
 
 	/* TODO: Protect me */
 	response.key = data->key;
-	esphome_sensor_read(dev, &response.state);
+	response.state = esphome_sensor_value_to_float(state);
 	SensorStateResponseWrite(api_dev, &response);
 }
 
+/* The last state read, sent by the entity flush to every subscribed connection */
+static inline int esphome_sensor_send_state(const struct device *api_dev,
+					    struct esphome_entity *entity)
+{
+	const struct esphome_sensor_data *data = entity->dev->data;
+
+	if (data->has_state) {
+		esphome_sensor_write_state(api_dev, entity, data->state);
+	}
+
+	return 0;
+}
+
+#ifdef CONFIG_ESPHOME_SENSOR_BUFFER
+/*
+ * Record a sample while no client is subscribed to the sensor states. It is
+ * dropped if the connection subscribed in the meantime, the subscription
+ * sends the last state.
+ */
+void esphome_sensor_buffer_push(struct esphome_sensor_entity *sensor,
+				esphome_sensor_value_t state);
+/*
+ * Resend the (downsampled) buffered samples of every sensor, clear them, then
+ * call subscribe. The samples pushed meanwhile wait for it, so they are sent
+ * after the resent ones. The states carry no timestamp: the client records
+ * them all at the time it receives them, this does not fill the gap in its
+ * history. What it gets is the last value read, preceded by averages.
+ */
+void esphome_sensor_buffer_replay(const struct device *api_dev,
+				  void (*subscribe)(const struct device *api_dev));
+#endif
+
 static inline int esphome_sensor_list_entity(const struct device *api_dev,
 					     struct esphome_entity *entity)
 {
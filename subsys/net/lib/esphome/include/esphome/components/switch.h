@@ -2,14 +2,83 @@
 #define ESPHOME_SWITCH_COMPONENT
 
 #include <zephyr/device.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/kernel.h>
 
 #include <esphome/components/entity.h>
 
+/* Must match the order of the restore_mode enum in the bindings */
+enum esphome_switch_restore_mode {
+	ESPHOME_SWITCH_ALWAYS_OFF,
+	ESPHOME_SWITCH_ALWAYS_ON,
+	ESPHOME_SWITCH_RESTORE_DEFAULT_OFF,
+	ESPHOME_SWITCH_RESTORE_DEFAULT_ON,
+	ESPHOME_SWITCH_RESTORE_INVERTED_DEFAULT_OFF,
+	ESPHOME_SWITCH_RESTORE_INVERTED_DEFAULT_ON,
+	ESPHOME_SWITCH_RESTORE_DISABLED,
+};
+
+/* Registry of the switches, the position in it is the bit used by the interlocks */
+struct esphome_switch {
+	const struct device *dev;
+	/* The state is persisted under a checksum of it, it survives a change of the registry */
+	const char *object_id;
+	enum esphome_switch_restore_mode restore_mode;
+	/* Switches turned off before this one is turned on */
+	const struct device *const *interlock;
+	size_t interlock_count;
+	/* Delay between turning the interlocked switches off and this one on (ms) */
+	uint32_t interlock_wait_time;
+
+	/* Set at boot from the interlock phandles */
+	int index;
+	uint32_t interlock_mask;
+	struct k_work_delayable interlock_work;
+
+	/* The state to persist and the one in the settings, -1 when there is none */
+	uint32_t key;
+	atomic_t recorded;
+	int persisted;
+};
+
+#define ESPHOME_SWITCH_INTERLOCK(node_id, prop, idx)                                               \
+	DEVICE_DT_GET(DT_PHANDLE_BY_IDX(node_id, prop, idx)),
+
+#define DEFINE_ESPHOME_SWITCH(_num, name)                                                          \
+	IF_ENABLED(DT_INST_NODE_HAS_PROP(_num, interlock),                                         \
+		   (static const struct device *const name##_interlock[] = {                       \
+			    DT_INST_FOREACH_PROP_ELEM(_num, interlock,                             \
+						      ESPHOME_SWITCH_INTERLOCK)};))                \
+	STRUCT_SECTION_ITERABLE(esphome_switch, name##_switch) = {                                 \
+		.dev = DEVICE_DT_GET(DT_DRV_INST(_num)),                                           \
+		.object_id = STRINGIFY(DT_STRING_TOKEN(DT_DRV_INST(_num), device_name)),           \
+		.restore_mode = DT_INST_ENUM_IDX(_num, restore_mode),                              \
+		.interlock = COND_CODE_1(DT_INST_NODE_HAS_PROP(_num, interlock),                   \
+					 (name##_interlock), (NULL)),                              \
+		.interlock_count = DT_INST_PROP_LEN_OR(_num, interlock, 0),                        \
+		.interlock_wait_time = DT_INST_PROP_OR(_num, interlock_wait_time, 0),              \
+	}
+
 struct esphome_switch_component_api {
 	int (*set_state)(const struct device *dev, int state);
 	int (*get_state)(const struct device *dev);
+	/*
+	 * Optional, for switches driven by a single GPIO: the GPIO to drive,
+	 * and the callback recording the state once the GPIO has been set.
+	 * They let esphome_switch_set_states() set several switches at once.
+	 */
+	const struct gpio_dt_spec *(*get_gpio)(const struct device *dev);
+	void (*commit_state)(const struct device *dev, int state);
 };
 
+/*
+ * Report the state of a switch to the API client, record it to restore it
+ * after a reboot, and trigger the on_turn_on/on_turn_off automations when it
+ * changed. Drivers call it once the switch has reached the requested state,
+ * which may be after set_state() has returned.
+ */
+void esphome_switch_state_changed(const struct device *dev);
+
 static inline int esphome_switch_get_state(const struct device *dev, int *state)
 {
 	const struct esphome_switch_component_api *api = dev->api;
@@ -18,25 +87,28 @@ static inline int esphome_switch_get_state(const struct device *dev, int *state)
 	return *state < 0 ? *state : 0;
 }
 
-static inline int esphome_switch_set_state(const struct device *dev, int state)
-{
-	const struct esphome_switch_component_api *api = dev->api;
+/*
+ * Set the state of a switch. Turning on a switch of an interlock group first
+ * turns off the other switches of the group. If one of them was on, this
+ * switch is turned on interlock_wait_time later, from the system work queue.
+ */
+int esphome_switch_set_state(const struct device *dev, int state);
 
-	return api->set_state(dev, state);
-}
+/*
+ * Set the state of several switches. The GPIO switches sharing a GPIO port
+ * are all set with a single gpio_port_set_masked() call, so they change at
+ * the same time. The other switches are set one after another.
+ */
+int esphome_switch_set_states(const struct device *const *devs, const int *states, size_t count);
 
 static inline int esphome_switch_turn_on(const struct device *dev)
 {
-	const struct esphome_switch_component_api *api = dev->api;
-
-	return api->set_state(dev, true);
+	return esphome_switch_set_state(dev, true);
 }
 
 static inline int esphome_switch_turn_off(const struct device *dev)
 {
-	const struct esphome_switch_component_api *api = dev->api;
-
-	return api->set_state(dev, false);
+	return esphome_switch_set_state(dev, false);
 }
 
 static inline int esphome_switch_toggle(const struct device *dev)
@@ -70,6 +142,21 @@ static inline int esphome_switch_list_entity(const struct device *api_dev,
 
 	return 0;
 }
+
+static inline int esphome_switch_send_state(const struct device *api_dev,
+					    struct esphome_entity *entity)
+{
+	SwitchStateResponse response = SWITCH_STATE_RESPONSE__INIT;
+	int ret;
+
+	ret = esphome_switch_get_state(entity->dev, &response.state);
+	if (ret < 0) {
+		return ret;
+	}
+	response.key = entity->data->key;
+
+	return SwitchStateResponseWrite(api_dev, &response);
+}
 #endif
 
 #endif /* ESPHOME_SWITCH_COMPONENT */
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ESPHOME_COMPONENT_UPDATE_H
+#define ESPHOME_COMPONENT_UPDATE_H
+
+#include <zephyr/device.h>
+
+#include <esphome/components/api.h>
+#include <esphome/components/entity.h>
+
+/*
+ * The image is uploaded over the API connection by calling the services:
+ *   ota_begin(size: int, md5: string)
+ *   ota_write(data: string), the next piece of the image, base64 encoded
+ *   ota_end()
+ * The services are run in order by the connection, and ota_write blocks while
+ * the flash is behind, so the client is flow controlled by TCP. The progress
+ * is reported with the state of the update entity.
+ *
+ * While ota_write runs, the heap holds the received message and its decoded
+ * data argument, each about the size of the base64 piece. Both must fit in
+ * CONFIG_HEAP_MEM_POOL_SIZE next to the other allocations: send at most 512
+ * bytes of the image, 684 base64 characters, per piece with a 2 KB heap. A
+ * larger piece can't be received or decoded, the connection is closed and
+ * the update aborted.
+ */
+#define ESPHOME_UPDATE_SERVICE_BEGIN "ota_begin"
+#define ESPHOME_UPDATE_SERVICE_WRITE "ota_write"
+#define ESPHOME_UPDATE_SERVICE_END   "ota_end"
+
+struct esphome_update_data {
+	/* Version of the running image */
+	char current_version[24];
+	/* From the manifest with ESPHOME_OTA_HTTP, the running one otherwise */
+	char latest_version[24];
+	/* Connection uploading the image, NULL if no update is in progress */
+	const struct device *api_dev;
+	/* The image is pulled from the manifest server */
+	bool downloading;
+	size_t size;
+	/* In percent */
+	float progress;
+};
+
+#ifdef CONFIG_ESPHOME_OTA_UPDATE
+int esphome_update_command(const struct device *dev, UpdateCommand command);
+
+/* Returns -ENOENT if the key is not one of the update services */
+int esphome_update_execute_service(const struct device *api_dev, ExecuteServiceRequest *request);
+
+/* Abort the update uploaded by this connection, if any */
+void esphome_update_connection_closed(const struct device *api_dev);
+#endif
+
+#endif /* ESPHOME_COMPONENT_UPDATE_H */
@@ -7,8 +7,12 @@
 #ifndef __ESPHOME_H__
 #define __ESPHOME_H__
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+#include <zephyr/kernel.h>
+
 struct esphome_config {
 	const char *name;
 	const char *friendly_name;
@@ -26,8 +30,32 @@ struct esphome_config {
 	int port;
 };
 
-struct esphome_data {
+/* The zero byte, then the size and the id of the message as varints of up to 32 bits */
+#define ESPHOME_RPC_HEADER_MAX_SIZE (1 + 5 + 5)
+
+/* The client connection of an API device, see rpc/esphome_rpc.h */
+struct esphome_rpc_data {
 	int socket;
+	/* Held for a whole message, any thread may write to the connection */
+	struct k_mutex lock;
+	/* Written by esphome_rpc_wake(), read end first */
+	int wake[2];
+	/* Message being received, as much as was available so far */
+	uint8_t header[ESPHOME_RPC_HEADER_MAX_SIZE];
+	size_t header_len;
+	/* Set once the header is complete */
+	bool in_body;
+	uint32_t msg_id;
+	uint8_t *body;
+	size_t body_len;
+	size_t received;
+};
+
+struct esphome_data {
+	/* First, the RPC layer reads the data of the API devices as its own */
+	struct esphome_rpc_data rpc;
+	/* Set once the client has sent SubscribeStatesRequest */
+	bool subscribed;
 };
 
 #endif /* __ESPHOME__ */
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ESPHOME_LOOP_H
+#define ESPHOME_LOOP_H
+
+#include <stdint.h>
+
+#include <zephyr/sys/slist.h>
+
+/*
+ * With CONFIG_ESPHOME_SINGLE_LOOP, the sockets are polled by the scheduler
+ * thread while it waits for the next timer, instead of each being served
+ * by its own thread.
+ */
+struct esphome_loop_fd {
+	sys_snode_t node;
+	int fd;
+	/* Called from the loop when fd is readable, or has an error */
+	void (*ready)(struct esphome_loop_fd *lfd);
+};
+
+/* Only from the loop, i.e. a scheduler or a ready callback */
+void esphome_loop_add(struct esphome_loop_fd *lfd);
+void esphome_loop_remove(struct esphome_loop_fd *lfd);
+
+/* Poll the sockets for up to timeout ms, -1 for ever, and run the ready callbacks */
+void esphome_loop_wait(int32_t timeout);
+
+/* Make esphome_loop_wait() return, e.g. because the next timer changed */
+void esphome_loop_wake(void);
+
+#endif /* ESPHOME_LOOP_H */
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ESPHOME_SCHEDULER_H
+#define ESPHOME_SCHEDULER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef void (*esphome_scheduler_cb)(void *user_data);
+
+/*
+ * The callbacks are identified by a component, any pointer such as its
+ * device, and a name. Setting a callback replaces the one registered with
+ * the same component and name, if any. All the callbacks run one after
+ * another from the scheduler thread, so they must not block.
+ */
+
+/*
+ * Call cb every interval ms, the first call being interval ms from now.
+ * Returns -ENOMEM when CONFIG_ESPHOME_SCHEDULER_MAX_TIMERS are in use.
+ */
+int esphome_set_interval(const void *component, const char *name, uint32_t interval,
+			 esphome_scheduler_cb cb, void *user_data);
+
+/* Call cb once, timeout ms from now */
+int esphome_set_timeout(const void *component, const char *name, uint32_t timeout,
+			esphome_scheduler_cb cb, void *user_data);
+
+/* Returns false if there was no such interval */
+bool esphome_cancel_interval(const void *component, const char *name);
+
+/* Returns false if there was no such timeout, or it has already run */
+bool esphome_cancel_timeout(const void *component, const char *name);
+
+/*
+ * With CONFIG_ESPHOME_TIMING_TASK_WDT, stop watching the scheduler thread
+ * while it runs something long on purpose, e.g. a flash erase from a
+ * callback, and watch it again. Only from the scheduler thread.
+ */
+#ifdef CONFIG_ESPHOME_TIMING_TASK_WDT
+void esphome_scheduler_wdt_suspend(void);
+void esphome_scheduler_wdt_resume(void);
+#else
+static inline void esphome_scheduler_wdt_suspend(void)
+{
+}
+
+static inline void esphome_scheduler_wdt_resume(void)
+{
+}
+#endif
+
+#endif /* ESPHOME_SCHEDULER_H */
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ESPHOME_TIMING_H
+#define ESPHOME_TIMING_H
+
+#include <stdint.h>
+
+#include <zephyr/kernel.h>
+
+struct esphome_timing_stats {
+	/* Name of the component, e.g. its device name */
+	const char *name;
+	uint32_t count;
+	/* Execution time of the callbacks, in microseconds */
+	uint64_t total_us;
+	uint32_t max_us;
+};
+
+typedef void (*esphome_timing_cb)(const void *component, const struct esphome_timing_stats *stats,
+				  void *user_data);
+
+#ifdef CONFIG_ESPHOME_TIMING
+static inline uint32_t esphome_timing_start(void)
+{
+	return k_cycle_get_32();
+}
+
+/*
+ * Account a callback of a component, started at start, and warn if it took
+ * longer than CONFIG_ESPHOME_TIMING_WARN_THRESHOLD ms.
+ */
+void esphome_timing_end(const void *component, const char *name, uint32_t start);
+
+/* Returns -ENOENT if the component has never been accounted */
+int esphome_timing_get(const void *component, struct esphome_timing_stats *stats);
+
+void esphome_timing_foreach(esphome_timing_cb cb, void *user_data);
+#else
+static inline uint32_t esphome_timing_start(void)
+{
+	return 0;
+}
+
+static inline void esphome_timing_end(const void *component, const char *name, uint32_t start)
+{
+}
+
+static inline int esphome_timing_get(const void *component, struct esphome_timing_stats *stats)
+{
+	return -ENOTSUP;
+}
+
+static inline void esphome_timing_foreach(esphome_timing_cb cb, void *user_data)
+{
+}
+#endif /* CONFIG_ESPHOME_TIMING */
+
+#endif /* ESPHOME_TIMING_H */
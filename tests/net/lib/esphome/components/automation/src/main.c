@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/ztest.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/gpio/gpio_fake.h>
+
+#include <esphome/esphome.h>
+#include <esphome/components/button.h>
+#include <esphome/components/switch.h>
+
+#include <zephyr/fff.h>
+DEFINE_FFF_GLOBALS;
+
+#define RELAY_PIN BIT(0)
+#define DELAY_MS  50
+
+struct esphome_automation_tests_fixture {
+	const struct device *button;
+	const struct device *relay;
+	const struct device *lamp;
+	const struct device *fan;
+};
+
+static void *automation_setup(void)
+{
+	static struct esphome_automation_tests_fixture fixture = {
+		.button = DEVICE_DT_GET(DT_NODELABEL(button)),
+		.relay = DEVICE_DT_GET(DT_NODELABEL(relay)),
+		.lamp = DEVICE_DT_GET(DT_NODELABEL(lamp)),
+		.fan = DEVICE_DT_GET(DT_NODELABEL(fan)),
+	};
+	return &fixture;
+}
+
+ZTEST_SUITE(esphome_automation_tests, NULL, automation_setup, NULL, NULL, NULL);
+
+static int relay_on_count(void)
+{
+	int count = 0;
+
+	for (int i = 0; i < gpio_fake_port_set_bits_raw_fake.call_count; i++) {
+		if (gpio_fake_port_set_bits_raw_fake.arg1_history[i] & RELAY_PIN) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+ZTEST_F(esphome_automation_tests, test_esphome_automation_boot_chain)
+{
+	int state;
+
+	/* on_boot turns the lamp on, whose on_turn_on turns the fan on */
+	k_sleep(K_MSEC(10));
+
+	zassert_ok(esphome_switch_get_state(fixture->lamp, &state));
+	zassert_equal(state, 1);
+	zassert_ok(esphome_switch_get_state(fixture->fan, &state));
+	zassert_equal(state, 1);
+}
+
+ZTEST_F(esphome_automation_tests, test_esphome_automation_press_delay)
+{
+	int state;
+
+	zassert_ok(esphome_switch_turn_off(fixture->relay));
+
+	zassert_ok(esphome_button_press(fixture->button));
+	k_sleep(K_MSEC(DELAY_MS / 5));
+
+	/* Toggled, and waiting for the delay without blocking a thread */
+	zassert_ok(esphome_switch_get_state(fixture->relay, &state));
+	zassert_equal(state, 1);
+
+	k_sleep(K_MSEC(DELAY_MS));
+
+	zassert_ok(esphome_switch_get_state(fixture->relay, &state));
+	zassert_equal(state, 0);
+	zassert_equal(relay_on_count(), 1);
+}
+
+ZTEST_F(esphome_automation_tests, test_esphome_automation_single)
+{
+	int state;
+
+	zassert_ok(esphome_switch_turn_off(fixture->relay));
+
+	/* The second press comes while the automation runs, it is dropped */
+	zassert_ok(esphome_button_press(fixture->button));
+	k_sleep(K_MSEC(DELAY_MS / 5));
+	zassert_ok(esphome_button_press(fixture->button));
+	k_sleep(K_MSEC(2 * DELAY_MS));
+
+	zassert_ok(esphome_switch_get_state(fixture->relay, &state));
+	zassert_equal(state, 0);
+	zassert_equal(relay_on_count(), 1);
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/ztest.h>
+#include <zephyr/device.h>
+
+#include <esphome/esphome.h>
+#include <esphome/components/button.h>
+
+#define ON_PRESS_MS 20
+
+static K_SEM_DEFINE(on_press_sem, 0, 1);
+static bool on_press_blocked;
+
+int test_button_on_press(const struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	if (on_press_blocked) {
+		k_sem_take(&on_press_sem, K_FOREVER);
+	} else {
+		k_busy_wait(ON_PRESS_MS * USEC_PER_MSEC);
+	}
+
+	return 0;
+}
+
+struct esphome_button_tests_fixture {
+	const struct device *dev;
+};
+
+static void *button_setup(void)
+{
+	static struct esphome_button_tests_fixture fixture = {
+		.dev = DEVICE_DT_GET(DT_PATH(button)),
+	};
+	return &fixture;
+}
+
+ZTEST_SUITE(esphome_button_tests, NULL, button_setup, NULL, NULL, NULL);
+
+ZTEST_F(esphome_button_tests, test_esphome_button_press_deferred)
+{
+	struct esphome_button_stats before;
+	struct esphome_button_stats stats;
+	int64_t start;
+
+	esphome_button_get_stats(fixture->dev, &before);
+
+	/* The press returns before on_press has run */
+	start = k_uptime_get();
+	zassert_ok(esphome_button_press(fixture->dev));
+	zassert_true(k_uptime_get() - start < ON_PRESS_MS);
+
+	k_sleep(K_MSEC(2 * ON_PRESS_MS));
+
+	esphome_button_get_stats(fixture->dev, &stats);
+	zassert_equal(stats.count, before.count + 1);
+	zassert_true(stats.max_us >= ON_PRESS_MS * USEC_PER_MSEC);
+	zassert_true(stats.total_us - before.total_us >= ON_PRESS_MS * USEC_PER_MSEC);
+}
+
+ZTEST_F(esphome_button_tests, test_esphome_button_press_queue_full)
+{
+	struct esphome_button_stats before;
+	struct esphome_button_stats stats;
+	int ret;
+
+	esphome_button_get_stats(fixture->dev, &before);
+	on_press_blocked = true;
+
+	/* The first press is executing, the next ones fill the queue */
+	zassert_ok(esphome_button_press(fixture->dev));
+	k_sleep(K_MSEC(1));
+	for (int i = 0; i < CONFIG_ESPHOME_BUTTON_QUEUE_SIZE; i++) {
+		zassert_ok(esphome_button_press(fixture->dev));
+	}
+
+	ret = esphome_button_press(fixture->dev);
+	zassert_equal(ret, -ENOMEM);
+
+	on_press_blocked = false;
+	k_sem_give(&on_press_sem);
+	k_sleep(K_MSEC((CONFIG_ESPHOME_BUTTON_QUEUE_SIZE + 1) * ON_PRESS_MS));
+
+	esphome_button_get_stats(fixture->dev, &stats);
+	zassert_equal(stats.dropped, before.dropped + 1);
+	zassert_equal(stats.count, before.count + CONFIG_ESPHOME_BUTTON_QUEUE_SIZE + 1);
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+
+#include <zephyr/ztest.h>
+#include <zephyr/device.h>
+
+#include <esphome/components/entity.h>
+
+static const struct device *const api0 = DEVICE_DT_GET(DT_NODELABEL(esphome0));
+static const struct device *const api1 = DEVICE_DT_GET(DT_NODELABEL(esphome1));
+
+static int sent0;
+static int sent1;
+/* Returned by the next send */
+static int send_error;
+
+static int test_entity_send_state(const struct device *api_dev, struct esphome_entity *entity)
+{
+	int ret = send_error;
+
+	ARG_UNUSED(entity);
+
+	send_error = 0;
+	if (ret) {
+		return ret;
+	}
+
+	if (api_dev == api0) {
+		sent0++;
+	} else if (api_dev == api1) {
+		sent1++;
+	}
+
+	return 0;
+}
+
+static struct esphome_entity_config test_entity_config = {
+	.object_id = "test_entity",
+	.name = "Test entity",
+};
+static struct esphome_entity_data test_entity_data;
+STRUCT_SECTION_ITERABLE(esphome_entity, test_entity) = {
+	.config = &test_entity_config,
+	.data = &test_entity_data,
+	.send_state = test_entity_send_state,
+};
+
+/* What the connection threads do once woken up, none is connected here */
+static void expect_sent(int expected0, int expected1)
+{
+	zassert_ok(ConnectionWakeCb(api0));
+	zassert_ok(ConnectionWakeCb(api1));
+	zassert_equal(sent0, expected0, "%d states sent to the first connection", sent0);
+	zassert_equal(sent1, expected1, "%d states sent to the second connection", sent1);
+}
+
+static void entity_before(void *f)
+{
+	ARG_UNUSED(f);
+
+	ConnectionClosedCb(api0);
+	ConnectionClosedCb(api1);
+	expect_sent(sent0, sent1);
+	sent0 = 0;
+	sent1 = 0;
+	send_error = 0;
+}
+
+ZTEST_SUITE(esphome_entity_tests, NULL, NULL, entity_before, NULL, NULL);
+
+ZTEST(esphome_entity_tests, test_esphome_entity_subscribe)
+{
+	/* Nothing is sent before a subscription */
+	esphome_entity_state_changed(&test_entity);
+	expect_sent(0, 0);
+
+	zassert_ok(SubscribeStatesRequestCb(api0));
+	expect_sent(1, 0);
+
+	/* The new subscriber gets the states, the other connection already has them */
+	zassert_ok(SubscribeStatesRequestCb(api1));
+	expect_sent(1, 1);
+}
+
+ZTEST(esphome_entity_tests, test_esphome_entity_state_changed)
+{
+	zassert_ok(SubscribeStatesRequestCb(api0));
+	zassert_ok(SubscribeStatesRequestCb(api1));
+	expect_sent(1, 1);
+
+	/* The changes of the same tick are sent once, to every subscribed connection */
+	esphome_entity_state_changed(&test_entity);
+	esphome_entity_state_changed(&test_entity);
+	expect_sent(2, 2);
+
+	ConnectionClosedCb(api1);
+	esphome_entity_state_changed(&test_entity);
+	expect_sent(3, 2);
+}
+
+ZTEST(esphome_entity_tests, test_esphome_entity_send_error)
+{
+	send_error = -EIO;
+	zassert_equal(SubscribeStatesRequestCb(api0), -EIO);
+	expect_sent(0, 0);
+
+	zassert_ok(SubscribeStatesRequestCb(api0));
+	expect_sent(1, 0);
+
+	/* Returned to the thread of the connection, which closes it */
+	esphome_entity_state_changed(&test_entity);
+	send_error = -EPIPE;
+	zassert_equal(ConnectionWakeCb(api0), -EPIPE);
+	expect_sent(1, 0);
+}
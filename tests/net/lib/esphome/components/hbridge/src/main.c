@@ -15,8 +15,13 @@
 #include <zephyr/fff.h>
 DEFINE_FFF_GLOBALS;
 
+#define WAIT_TIME DT_PROP(DT_PATH(hbridge_switch), wait_time)
+/* Wait for the end of the pulse, the coil is released from the system work queue */
+#define WAIT_PULSE() k_sleep(K_MSEC(WAIT_TIME + 10))
+
 struct esphome_hbridge_tests_fixture {
 	const struct device *dev;
+	const struct device *dev2;
 	const struct gpio_dt_spec gpio_on;
 	const struct gpio_dt_spec gpio_off;
 };
@@ -25,6 +30,7 @@ static void *switch_hbridge_setup(void)
 {
 	static struct esphome_hbridge_tests_fixture fixture = {
 		.dev = DEVICE_DT_GET(DT_PATH(hbridge_switch)),
+		.dev2 = DEVICE_DT_GET(DT_PATH(hbridge_switch2)),
 		.gpio_on = GPIO_DT_SPEC_GET(DT_PATH(hbridge_switch), on_gpios),
 		.gpio_off = GPIO_DT_SPEC_GET(DT_PATH(hbridge_switch), off_gpios),
 	};
@@ -49,6 +55,8 @@ ZTEST_F(esphome_hbridge_tests, test_esphome_switch_hbridge_set_state_off)
 	zassert_equal(fixture->gpio_off.port, gpio_fake_port_set_bits_raw_fake.arg0_history[0]);
 	zassert_equal(2, gpio_fake_port_set_bits_raw_fake.arg1_history[0]);
 
+	WAIT_PULSE();
+
 	/* To finish we clear both gpios */
 	zassert_equal(fixture->gpio_on.port, gpio_fake_port_clear_bits_raw_fake.arg0_history[1]);
 	zassert_equal(1, gpio_fake_port_clear_bits_raw_fake.arg1_history[1]);
@@ -72,6 +80,8 @@ ZTEST_F(esphome_hbridge_tests, test_esphome_switch_hbridge_set_state_on)
 	zassert_equal(fixture->gpio_on.port, gpio_fake_port_clear_bits_raw_fake.arg0_history[0]);
 	zassert_equal(2, gpio_fake_port_clear_bits_raw_fake.arg1_history[0]);
 
+	WAIT_PULSE();
+
 	/* To finish we clear both gpios */
 	zassert_equal(fixture->gpio_on.port, gpio_fake_port_clear_bits_raw_fake.arg0_history[1]);
 	zassert_equal(1, gpio_fake_port_clear_bits_raw_fake.arg1_history[1]);
@@ -86,6 +96,7 @@ ZTEST_F(esphome_hbridge_tests, test_esphome_switch_hbridge_get_state)
 
 	ret = esphome_switch_set_state(fixture->dev, 1);
 	zassert_equal(ret, 0);
+	WAIT_PULSE();
 
 	ret = esphome_switch_get_state(fixture->dev, &state);
 	zassert_equal(ret, 0);
@@ -93,8 +104,63 @@ ZTEST_F(esphome_hbridge_tests, test_esphome_switch_hbridge_get_state)
 
 	ret = esphome_switch_set_state(fixture->dev, 0);
 	zassert_equal(ret, 0);
+	WAIT_PULSE();
+
+	ret = esphome_switch_get_state(fixture->dev, &state);
+	zassert_equal(ret, 0);
+	zassert_equal(state, 0);
+}
+
+ZTEST_F(esphome_hbridge_tests, test_esphome_switch_hbridge_non_blocking)
+{
+	int64_t start;
+	int state;
+	int ret;
+
+	ret = esphome_switch_set_state(fixture->dev, 0);
+	zassert_equal(ret, 0);
+	WAIT_PULSE();
 
+	start = k_uptime_get();
+	ret = esphome_switch_set_state(fixture->dev, 1);
+	zassert_equal(ret, 0);
+	zassert_true(k_uptime_get() - start < WAIT_TIME);
+
+	/* The new state is only reported once the coil is released */
 	ret = esphome_switch_get_state(fixture->dev, &state);
 	zassert_equal(ret, 0);
 	zassert_equal(state, 0);
+
+	WAIT_PULSE();
+	ret = esphome_switch_get_state(fixture->dev, &state);
+	zassert_equal(ret, 0);
+	zassert_equal(state, 1);
+}
+
+ZTEST_F(esphome_hbridge_tests, test_esphome_switch_hbridge_max_energized)
+{
+	int state;
+	int ret;
+
+	zassert_equal(CONFIG_ESPHOME_SWITCH_HBRIDGE_MAX_ENERGIZED, 1);
+
+	ret = esphome_switch_set_state(fixture->dev, 1);
+	zassert_equal(ret, 0);
+	ret = esphome_switch_set_state(fixture->dev2, 1);
+	zassert_equal(ret, 0);
+
+	/* Only the first coil is energized */
+	zassert_equal(gpio_fake_port_set_bits_raw_fake.call_count, 1);
+
+	/* The second pulse starts when the first coil is released */
+	WAIT_PULSE();
+	zassert_equal(gpio_fake_port_set_bits_raw_fake.call_count, 2);
+	ret = esphome_switch_get_state(fixture->dev, &state);
+	zassert_equal(ret, 0);
+	zassert_equal(state, 1);
+
+	WAIT_PULSE();
+	ret = esphome_switch_get_state(fixture->dev2, &state);
+	zassert_equal(ret, 0);
+	zassert_equal(state, 1);
 }
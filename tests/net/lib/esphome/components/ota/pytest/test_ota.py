@@ -0,0 +1,304 @@
+# Copyright (c) 2025 Alexandre Bailon
+# SPDX-License-Identifier: Apache-2.0
+
+"""Benchmark the OTA server of the native_sim build and inject faults in the transfers.
+
+None of the uploads sends the final ack, the device never reboots and keeps
+serving the next test. The compression and delta tests are skipped when the
+variant built does not advertise them.
+"""
+
+import gzip
+import hashlib
+import random
+import socket
+import sys
+import time
+from pathlib import Path
+
+import pytest
+from twister_harness import DeviceAdapter
+
+sys.path.insert(0, str(Path(__file__).resolve().parents[7] / "scripts"))
+
+from esphome_delta import create_patch  # noqa: E402
+from esphome_ota import (  # noqa: E402
+    BLOCK_SIZE,
+    FEATURE_SUPPORTS_COMPRESSION,
+    FEATURE_SUPPORTS_DELTA,
+    FEATURE_SUPPORTS_RESUME,
+    RESPONSE_CHUNK_OK,
+    RESPONSE_ERROR_MAGIC,
+    RESPONSE_ERROR_MD5_MISMATCH,
+    RESPONSE_ERROR_WRITING_FLASH,
+    OtaClient,
+    OtaError,
+    OtaFaults,
+)
+
+HOST = "127.0.0.1"
+PORT = 8266
+API_PORT = 6053
+IMAGE_SIZE = 192 * 1024
+
+IMAGE = random.Random(2025).randbytes(IMAGE_SIZE)
+MD5 = hashlib.md5(IMAGE).hexdigest()
+
+# The primary slot is never written by the tests, it stays erased
+DELTA_SOURCE = b"\xff" * (64 * 1024)
+
+
+@pytest.fixture(scope="module")
+def server(dut: DeviceAdapter):
+    dut.readlines_until(regex="OTA server waits for a connection", timeout=60)
+    return dut
+
+
+def connect(timeout=30.0):
+    # The server only takes the next connection once the previous one is closed
+    deadline = time.monotonic() + timeout
+    while True:
+        try:
+            return OtaClient(HOST, PORT, timeout)
+        except OSError:
+            if time.monotonic() > deadline:
+                raise
+            time.sleep(0.1)
+
+
+def api_ping(timeout=2.0):
+    """Round trip of an API PingRequest, the device answers it before the hello too"""
+    with socket.create_connection((HOST, API_PORT), timeout=timeout) as sock:
+        start = time.monotonic()
+        # Plaintext frame: a zero byte, then the size and the type as varints
+        sock.sendall(bytes([0x00, 0x00, 7]))
+        response = b""
+        while len(response) < 3:
+            chunk = sock.recv(3 - len(response))
+            assert chunk, "connection closed by the device"
+            response += chunk
+        assert response == bytes([0x00, 0x00, 8])
+        return time.monotonic() - start
+
+
+def upload(faults=None, features=0, image=IMAGE):
+    client = connect()
+    try:
+        return client.upload(image, features, faults, reboot=False)
+    finally:
+        client.close()
+
+
+def require(features):
+    client = connect()
+    try:
+        accepted = client.negotiate(features)
+    finally:
+        client.close()
+    if accepted != features:
+        pytest.skip(f"features 0x{features:02x} not built, the device accepts 0x{accepted:02x}")
+
+
+def delta_target():
+    """Erased regions copied from the source, between random ones sent as is"""
+    rng = random.Random(2026)
+    target = bytearray(b"\xff" * IMAGE_SIZE)
+    for pos in range(0, IMAGE_SIZE, 16 * 1024):
+        target[pos:pos + 4096] = rng.randbytes(4096)
+    return bytes(target)
+
+
+def test_bad_magic(server):
+    client = connect()
+    try:
+        with pytest.raises(OtaError) as error:
+            client.handshake(IMAGE_SIZE, MD5, magic=b"\x00" * 5)
+        assert error.value.code == RESPONSE_ERROR_MAGIC
+    finally:
+        client.close()
+
+
+def test_disconnect(server):
+    client = connect()
+    client.handshake(IMAGE_SIZE, MD5)
+    client.send_image(IMAGE, faults=OtaFaults(disconnect_at=IMAGE_SIZE // 3))
+
+    # The server is back for the next upload
+    upload()
+
+
+def test_corrupted_payload(server):
+    client = connect()
+    try:
+        client.handshake(IMAGE_SIZE, MD5)
+        client.send_image(IMAGE, faults=OtaFaults(corrupt_at=IMAGE_SIZE // 2))
+        with pytest.raises(OtaError) as error:
+            client.finish(reboot=False)
+        assert error.value.code == RESPONSE_ERROR_MD5_MISMATCH
+    finally:
+        client.close()
+
+
+def test_resume(server):
+    drop = 100000
+
+    client = connect()
+    offset = client.handshake(IMAGE_SIZE, MD5, FEATURE_SUPPORTS_RESUME)
+    client.send_image(IMAGE, offset, OtaFaults(disconnect_at=drop))
+
+    client = connect()
+    try:
+        offset = client.handshake(IMAGE_SIZE, MD5, FEATURE_SUPPORTS_RESUME)
+        # Continues from the start of the page holding the last byte written
+        assert 0 < offset <= drop
+        client.send_image(IMAGE, offset)
+        client.finish(reboot=False)
+    finally:
+        client.close()
+
+    # Cleared once the image is verified
+    client = connect()
+    try:
+        assert client.handshake(IMAGE_SIZE, MD5, FEATURE_SUPPORTS_RESUME) == 0
+    finally:
+        client.close()
+
+
+def test_plain_after_resume(server):
+    drop = 100000
+
+    # Leave a resumed upload interrupted, the writer last started at an offset
+    client = connect()
+    offset = client.handshake(IMAGE_SIZE, MD5, FEATURE_SUPPORTS_RESUME)
+    client.send_image(IMAGE, offset, OtaFaults(disconnect_at=drop))
+    client = connect()
+    offset = client.handshake(IMAGE_SIZE, MD5, FEATURE_SUPPORTS_RESUME)
+    assert offset > 0
+    client.send_image(IMAGE, offset, OtaFaults(disconnect_at=IMAGE_SIZE - 1000))
+
+    # Hashed and written from the start
+    upload()
+
+    # The plain upload overwrote the slot, the progress saved before is gone
+    client = connect()
+    try:
+        assert client.handshake(IMAGE_SIZE, MD5, FEATURE_SUPPORTS_RESUME) == 0
+    finally:
+        client.close()
+
+
+def test_api_during_upload(server):
+    """The API is served while an upload waits for the client, single loop included"""
+    half = IMAGE_SIZE // 2
+
+    client = connect()
+    try:
+        client.handshake(IMAGE_SIZE, MD5)
+        for pos in range(0, half, BLOCK_SIZE):
+            client.sock.sendall(IMAGE[pos:pos + BLOCK_SIZE])
+            client.expect(RESPONSE_CHUNK_OK, "chunk")
+        # The device is left waiting for the rest of a buffer
+        client.sock.sendall(IMAGE[half:half + 100])
+
+        assert api_ping() < 1.0
+
+        client.send_image(IMAGE, half + 100)
+        client.finish(reboot=False)
+    finally:
+        client.close()
+
+
+def test_features(server):
+    client = connect()
+    try:
+        # The unknown bits are ignored, resume is not part of the answer
+        accepted = client.negotiate(FEATURE_SUPPORTS_COMPRESSION | FEATURE_SUPPORTS_RESUME |
+                                    FEATURE_SUPPORTS_DELTA | 0x02)
+        assert accepted & ~(FEATURE_SUPPORTS_COMPRESSION | FEATURE_SUPPORTS_DELTA) == 0
+    finally:
+        client.close()
+
+
+def test_compressed(server):
+    require(FEATURE_SUPPORTS_COMPRESSION)
+
+    # The size and the MD5 are the ones of the compressed stream
+    image = IMAGE[:IMAGE_SIZE // 2] + bytes(IMAGE_SIZE // 2)
+    stats = upload(features=FEATURE_SUPPORTS_COMPRESSION, image=gzip.compress(image, mtime=0))
+    print(stats.summary())
+
+
+def test_compressed_short_writes(server):
+    require(FEATURE_SUPPORTS_COMPRESSION)
+
+    upload(OtaFaults(short_writes=97), FEATURE_SUPPORTS_COMPRESSION,
+           gzip.compress(IMAGE, mtime=0))
+
+
+def test_compressed_trailing_data(server):
+    require(FEATURE_SUPPORTS_COMPRESSION)
+
+    with pytest.raises(OtaError) as error:
+        upload(features=FEATURE_SUPPORTS_COMPRESSION,
+               image=gzip.compress(IMAGE, mtime=0) + bytes(16))
+    assert error.value.code == RESPONSE_ERROR_WRITING_FLASH
+
+
+def test_compressed_bad_crc(server):
+    require(FEATURE_SUPPORTS_COMPRESSION)
+
+    # The MD5 of the stream matches, the CRC of the decompressed image does not
+    stream = bytearray(gzip.compress(IMAGE, mtime=0))
+    stream[-8] ^= 0x01
+    with pytest.raises(OtaError) as error:
+        upload(features=FEATURE_SUPPORTS_COMPRESSION, image=bytes(stream))
+    assert error.value.code == RESPONSE_ERROR_WRITING_FLASH
+
+
+def test_delta(server):
+    require(FEATURE_SUPPORTS_DELTA)
+
+    upload(features=FEATURE_SUPPORTS_DELTA, image=create_patch(DELTA_SOURCE, delta_target()))
+
+
+def test_compressed_delta(server):
+    features = FEATURE_SUPPORTS_COMPRESSION | FEATURE_SUPPORTS_DELTA
+    require(features)
+
+    # The copied regions are zeros in the patch, they compress well
+    patch = gzip.compress(create_patch(DELTA_SOURCE, delta_target()), mtime=0)
+    assert len(patch) < IMAGE_SIZE // 2
+    stats = upload(features=features, image=patch)
+    print(stats.summary())
+
+
+def test_delta_wrong_source(server):
+    require(FEATURE_SUPPORTS_DELTA)
+
+    # The CRC of the source in the header does not match the running image. The
+    # patch fits in a block, the device fails before the client sends anything else
+    patch = create_patch(bytes(64 * 1024), random.Random(2027).randbytes(4096))
+    assert len(patch) < BLOCK_SIZE
+    with pytest.raises(OtaError) as error:
+        upload(features=FEATURE_SUPPORTS_DELTA, image=patch)
+    assert error.value.code == RESPONSE_ERROR_WRITING_FLASH
+
+
+def test_short_writes(server):
+    upload(OtaFaults(short_writes=97))
+
+
+def test_slow_reader(server):
+    stats = upload(OtaFaults(send_delay=0.05, ack_delay=0.02))
+    assert len(stats.ack_latencies) == IMAGE_SIZE // 8192
+
+
+def test_benchmark(server, record_property):
+    stats = upload()
+    print(stats.summary())
+
+    lat = sorted(stats.ack_latencies)
+    record_property("mb_per_s", round(stats.mb_per_s, 3))
+    record_property("ack_latency_p50_ms", round(lat[len(lat) // 2] * 1e3, 3))
+    record_property("ack_latency_max_ms", round(lat[-1] * 1e3, 3))
+    assert stats.mb_per_s > 0
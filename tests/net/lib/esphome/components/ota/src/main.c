@@ -0,0 +1,13 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+
+/* The OTA server starts on its own, pytest/test_ota.py is the client */
+int main(void)
+{
+	return 0;
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/ztest.h>
+#include <zephyr/dfu/flash_img.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+
+#include "esphome_delta.h"
+
+#define SOURCE_SIZE 4096
+#define EXTRA_SIZE  200
+#define TARGET_SIZE (1000 + EXTRA_SIZE + 1000)
+
+struct esphome_ota_delta_tests_fixture {
+	const struct flash_area *source;
+	const struct flash_area *target;
+	struct flash_img_context ctx;
+	struct esphome_delta delta;
+	uint8_t image[SOURCE_SIZE];
+	uint8_t expected[TARGET_SIZE];
+	uint8_t patch[ESPHOME_DELTA_HEADER_SIZE + 2 * ESPHOME_DELTA_RECORD_SIZE + TARGET_SIZE];
+	size_t patch_len;
+};
+
+static int delta_read(void *user_data, size_t offset, uint8_t *data, size_t len)
+{
+	struct esphome_ota_delta_tests_fixture *fixture = user_data;
+
+	return flash_area_read(fixture->source, offset, data, len);
+}
+
+static int delta_write(void *user_data, const uint8_t *data, size_t len)
+{
+	struct esphome_ota_delta_tests_fixture *fixture = user_data;
+
+	return flash_img_buffered_write(&fixture->ctx, data, len, false);
+}
+
+static void patch_put(struct esphome_ota_delta_tests_fixture *fixture, uint32_t val)
+{
+	sys_put_le32(val, &fixture->patch[fixture->patch_len]);
+	fixture->patch_len += sizeof(val);
+}
+
+/*
+ * The target is the first 1000 bytes of the source with a few bytes changed,
+ * EXTRA_SIZE new bytes, then 1000 bytes copied from the source at 2000.
+ */
+static void build_patch(struct esphome_ota_delta_tests_fixture *fixture)
+{
+	uint8_t *patch = fixture->patch;
+	uint8_t *expected = fixture->expected;
+
+	fixture->patch_len = 0;
+	memcpy(patch, ESPHOME_DELTA_MAGIC, 4);
+	fixture->patch_len += 4;
+	patch_put(fixture, SOURCE_SIZE);
+	patch_put(fixture, crc32_ieee(fixture->image, SOURCE_SIZE));
+	patch_put(fixture, TARGET_SIZE);
+
+	patch_put(fixture, 1000);
+	patch_put(fixture, EXTRA_SIZE);
+	patch_put(fixture, 1000);
+	for (int i = 0; i < 1000; i++) {
+		uint8_t diff = i % 100 == 0 ? i / 100 + 1 : 0;
+
+		patch[fixture->patch_len++] = diff;
+		*expected++ = fixture->image[i] + diff;
+	}
+	for (int i = 0; i < EXTRA_SIZE; i++) {
+		patch[fixture->patch_len++] = i;
+		*expected++ = i;
+	}
+
+	patch_put(fixture, 1000);
+	patch_put(fixture, 0);
+	patch_put(fixture, 0);
+	memset(&patch[fixture->patch_len], 0, 1000);
+	fixture->patch_len += 1000;
+	memcpy(expected, &fixture->image[2000], 1000);
+}
+
+static void *ota_delta_setup(void)
+{
+	static struct esphome_ota_delta_tests_fixture fixture;
+
+	zassert_ok(flash_area_open(FIXED_PARTITION_ID(slot0_partition), &fixture.source));
+	zassert_ok(flash_area_open(FIXED_PARTITION_ID(slot1_partition), &fixture.target));
+
+	for (int i = 0; i < SOURCE_SIZE; i++) {
+		fixture.image[i] = i * 7 + i / 256;
+	}
+	zassert_ok(flash_area_erase(fixture.source, 0, fixture.source->fa_size));
+	zassert_ok(flash_area_write(fixture.source, 0, fixture.image, SOURCE_SIZE));
+
+	build_patch(&fixture);
+
+	return &fixture;
+}
+
+static void ota_delta_before(void *f)
+{
+	struct esphome_ota_delta_tests_fixture *fixture = f;
+
+	zassert_ok(flash_img_init(&fixture->ctx));
+
+	fixture->delta.read = delta_read;
+	fixture->delta.write = delta_write;
+	fixture->delta.user_data = fixture;
+	fixture->delta.source_area_size = fixture->source->fa_size;
+	esphome_delta_start(&fixture->delta);
+}
+
+ZTEST_SUITE(esphome_ota_delta_tests, NULL, ota_delta_setup, ota_delta_before, NULL, NULL);
+
+ZTEST_F(esphome_ota_delta_tests, test_esphome_ota_delta_apply)
+{
+	uint8_t target[TARGET_SIZE];
+	size_t len;
+
+	/* In odd sized pieces, so the header and the records are split */
+	for (size_t offset = 0; offset < fixture->patch_len; offset += len) {
+		len = MIN(7, fixture->patch_len - offset);
+		zassert_ok(esphome_delta_write(&fixture->delta, &fixture->patch[offset], len));
+	}
+	zassert_ok(esphome_delta_finish(&fixture->delta));
+	zassert_ok(flash_img_buffered_write(&fixture->ctx, NULL, 0, true));
+
+	zassert_equal(flash_img_bytes_written(&fixture->ctx), TARGET_SIZE);
+	zassert_ok(flash_area_read(fixture->target, 0, target, sizeof(target)));
+	zassert_mem_equal(target, fixture->expected, TARGET_SIZE);
+
+	/* Nothing is expected after the end of the target */
+	zassert_equal(esphome_delta_write(&fixture->delta, fixture->patch, 1), -EBADMSG);
+}
+
+ZTEST_F(esphome_ota_delta_tests, test_esphome_ota_delta_errors)
+{
+	uint8_t patch[ESPHOME_DELTA_HEADER_SIZE + ESPHOME_DELTA_RECORD_SIZE];
+	int ret;
+
+	/* Made from another image */
+	memcpy(patch, fixture->patch, sizeof(patch));
+	patch[8] ^= 0xff;
+	zassert_equal(esphome_delta_write(&fixture->delta, patch, sizeof(patch)), -ESTALE);
+
+	/* A record going past the target */
+	esphome_delta_start(&fixture->delta);
+	memcpy(patch, fixture->patch, sizeof(patch));
+	sys_put_le32(TARGET_SIZE + 1, &patch[ESPHOME_DELTA_HEADER_SIZE]);
+	zassert_equal(esphome_delta_write(&fixture->delta, patch, sizeof(patch)), -EBADMSG);
+
+	/* Moving the source offset before its start, or far past its end */
+	esphome_delta_start(&fixture->delta);
+	sys_put_le32(-2000, &fixture->patch[ESPHOME_DELTA_HEADER_SIZE + 8]);
+	ret = esphome_delta_write(&fixture->delta, fixture->patch, fixture->patch_len);
+	zassert_equal(ret, -EBADMSG);
+	esphome_delta_start(&fixture->delta);
+	sys_put_le32(INT32_MAX, &fixture->patch[ESPHOME_DELTA_HEADER_SIZE + 8]);
+	ret = esphome_delta_write(&fixture->delta, fixture->patch, fixture->patch_len);
+	sys_put_le32(1000, &fixture->patch[ESPHOME_DELTA_HEADER_SIZE + 8]);
+	zassert_equal(ret, -EBADMSG);
+
+	/* Truncated */
+	esphome_delta_start(&fixture->delta);
+	zassert_ok(esphome_delta_write(&fixture->delta, fixture->patch, fixture->patch_len - 1));
+	zassert_equal(esphome_delta_finish(&fixture->delta), -EBADMSG);
+}
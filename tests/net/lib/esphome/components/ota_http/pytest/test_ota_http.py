@@ -0,0 +1,99 @@
+# Copyright (c) 2025 Alexandre Bailon
+# SPDX-License-Identifier: Apache-2.0
+
+"""Serve the OTA manifests and images to the native_sim build of src/main.c."""
+
+import hashlib
+import json
+import re
+import threading
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+import pytest
+from twister_harness import DeviceAdapter
+
+PORT = 8090
+IMAGE_SIZE = 100000
+# The first download of firmware.bin is cut after this many bytes
+DROP_AT = 5000
+
+IMAGE = bytes((i * 7 + i // 256) & 0xFF for i in range(IMAGE_SIZE))
+
+
+class OtaHandler(BaseHTTPRequestHandler):
+    protocol_version = 'HTTP/1.1'
+    files = {
+        '/manifest.json': json.dumps({
+            'version': '2.0.0',
+            'url': 'firmware.bin',
+            'size': IMAGE_SIZE,
+            'md5': hashlib.md5(IMAGE).hexdigest(),
+        }).encode(),
+        '/bad.json': json.dumps({
+            'version': '2.0.0',
+            'url': '/other.bin',
+            'size': IMAGE_SIZE,
+            'md5': '0' * 32,
+        }).encode(),
+        '/firmware.bin': IMAGE,
+        '/other.bin': IMAGE,
+    }
+    ranges = []
+    dropped = False
+
+    def log_message(self, *args):
+        pass
+
+    def do_GET(self):
+        data = self.files.get(self.path)
+        if data is None:
+            self.send_error(404)
+            return
+
+        start, end = 0, len(data) - 1
+        match = re.fullmatch(r'bytes=(\d+)-(\d*)', self.headers.get('Range', ''))
+        if match:
+            start = int(match.group(1))
+            if match.group(2):
+                end = min(int(match.group(2)), end)
+            OtaHandler.ranges.append((self.path, start, end))
+            self.send_response(206)
+            self.send_header('Content-Range', f'bytes {start}-{end}/{len(data)}')
+        else:
+            self.send_response(200)
+        self.send_header('Content-Length', str(end - start + 1))
+        self.end_headers()
+
+        body = data[start:end + 1]
+        if self.path == '/firmware.bin' and not OtaHandler.dropped and len(body) > DROP_AT:
+            OtaHandler.dropped = True
+            self.wfile.write(body[:DROP_AT])
+            self.wfile.flush()
+            self.close_connection = True
+            return
+        self.wfile.write(body)
+
+
+@pytest.fixture(scope='session', autouse=True)
+def http_server():
+    server = ThreadingHTTPServer(('127.0.0.1', PORT), OtaHandler)
+    thread = threading.Thread(target=server.serve_forever, daemon=True)
+    thread.start()
+    yield server
+    server.shutdown()
+
+
+def test_ota_http(dut: DeviceAdapter):
+    dut.readlines_until(regex='PROJECT EXECUTION SUCCESSFUL', timeout=120)
+
+    # Downloaded by ranges, the one after the drop continues where it stopped.
+    # The download of the asynchronous update starts over from 0.
+    firmware = [r for r in OtaHandler.ranges if r[0] == '/firmware.bin']
+    restart = next(i for i, r in enumerate(firmware) if i and r[1] == 0)
+    assert firmware[-1][2] == IMAGE_SIZE - 1
+    firmware = firmware[:restart]
+    assert firmware[0][1] == 0
+    assert firmware[1][1] == DROP_AT
+    for prev, cur in zip(firmware[1:], firmware[2:]):
+        assert cur[1] == prev[2] + 1
+    assert firmware[-1][2] == IMAGE_SIZE - 1
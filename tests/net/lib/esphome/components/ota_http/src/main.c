@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/ztest.h>
+#include <zephyr/storage/flash_map.h>
+
+#include <esphome/components/ota_http.h>
+
+/* Served by pytest/test_ota_http.py */
+#define SERVER     "http://127.0.0.1:8090"
+#define IMAGE_SIZE 100000
+
+static uint8_t image_byte(size_t i)
+{
+	return i * 7 + i / 256;
+}
+
+ZTEST(esphome_ota_http_tests, test_esphome_ota_http_bad_md5)
+{
+	struct esphome_ota_http_manifest manifest;
+
+	zassert_ok(esphome_ota_http_check(SERVER "/bad.json", &manifest));
+	zassert_equal(esphome_ota_http_install(SERVER "/bad.json", &manifest), -EBADMSG);
+}
+
+ZTEST(esphome_ota_http_tests, test_esphome_ota_http_check)
+{
+	struct esphome_ota_http_manifest manifest;
+
+	zassert_ok(esphome_ota_http_check(SERVER "/manifest.json", &manifest));
+	zassert_str_equal(manifest.version, "2.0.0");
+	zassert_str_equal(manifest.url, "firmware.bin");
+	zassert_equal(manifest.size, IMAGE_SIZE);
+	zassert_equal(strlen(manifest.md5), 32);
+
+	zassert_equal(esphome_ota_http_check(SERVER "/missing.json", &manifest), -EIO);
+}
+
+static K_SEM_DEFINE(check_done, 0, 1);
+static struct esphome_ota_http_manifest check_manifest;
+static int check_ret;
+
+static void check_finished(int ret, const struct esphome_ota_http_manifest *manifest)
+{
+	check_ret = ret;
+	check_manifest = *manifest;
+	k_sem_give(&check_done);
+}
+
+/* Fetched on the download thread, the caller only waits for the result */
+ZTEST(esphome_ota_http_tests, test_esphome_ota_http_check_async)
+{
+	zassert_ok(esphome_ota_http_check_async(SERVER "/manifest.json", check_finished));
+	zassert_equal(esphome_ota_http_check_async(SERVER "/manifest.json", check_finished),
+		      -EBUSY);
+
+	zassert_ok(k_sem_take(&check_done, K_SECONDS(30)));
+	zassert_ok(check_ret);
+	zassert_str_equal(check_manifest.version, "2.0.0");
+
+	zassert_ok(esphome_ota_http_check_async(SERVER "/missing.json", check_finished));
+	zassert_ok(k_sem_take(&check_done, K_SECONDS(30)));
+	zassert_equal(check_ret, -EIO);
+}
+
+/* The server drops the first connection in the middle of the image */
+ZTEST(esphome_ota_http_tests, test_esphome_ota_http_install)
+{
+	const struct flash_area *fa;
+	struct esphome_ota_http_manifest manifest;
+	uint8_t buf[256];
+	size_t len;
+
+	zassert_ok(esphome_ota_http_check(SERVER "/manifest.json", &manifest));
+	zassert_ok(esphome_ota_http_install(SERVER "/manifest.json", &manifest));
+
+	zassert_ok(flash_area_open(FIXED_PARTITION_ID(slot1_partition), &fa));
+	for (size_t offset = 0; offset < IMAGE_SIZE; offset += len) {
+		len = MIN(sizeof(buf), IMAGE_SIZE - offset);
+		zassert_ok(flash_area_read(fa, offset, buf, len));
+		for (size_t i = 0; i < len; i++) {
+			zassert_equal(buf[i], image_byte(offset + i), "at %zu", offset + i);
+		}
+	}
+	flash_area_close(fa);
+}
+
+static K_SEM_DEFINE(update_done, 0, 1);
+static size_t update_received;
+static int update_ret;
+
+static void update_progress(size_t received, size_t size)
+{
+	zassert_equal(size, IMAGE_SIZE);
+	zassert_true(received > update_received);
+	update_received = received;
+}
+
+static void update_finished(int ret)
+{
+	update_ret = ret;
+	k_sem_give(&update_done);
+}
+
+static const struct esphome_ota_http_listener update_listener = {
+	.progress = update_progress,
+	.done = update_finished,
+};
+
+/* Downloaded on its own thread, the caller only waits for the result */
+ZTEST(esphome_ota_http_tests, test_esphome_ota_http_update_async)
+{
+	zassert_ok(esphome_ota_http_update_async(SERVER "/manifest.json", &update_listener));
+	zassert_equal(esphome_ota_http_update_async(SERVER "/manifest.json", &update_listener),
+		      -EBUSY);
+
+	zassert_ok(k_sem_take(&update_done, K_SECONDS(60)));
+	zassert_ok(update_ret);
+	zassert_equal(update_received, IMAGE_SIZE);
+}
+
+ZTEST_SUITE(esphome_ota_http_tests, NULL, NULL, NULL, NULL, NULL);
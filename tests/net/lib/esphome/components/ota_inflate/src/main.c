@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+
+#include <zephyr/ztest.h>
+
+#include "esphome_inflate.h"
+
+#define NUM_LINES       300
+#define NUM_BLOCK_LINES 16
+#define WINDOW          512
+
+/* The NUM_LINES lines "line <i % 20>\n", gzip compressed with a 512 bytes window */
+static const uint8_t compressed[] = {
+	0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xed, 0x8e,
+	0xb9, 0x0d, 0x80, 0x30, 0x00, 0xc4, 0xfa, 0x4c, 0xc1, 0x08, 0x39, 0x7e,
+	0x06, 0xa2, 0x88, 0x14, 0xb1, 0x7f, 0x89, 0xd0, 0x39, 0x35, 0x0b, 0x5c,
+	0xe5, 0xca, 0x96, 0x7b, 0x7b, 0xee, 0xa9, 0x96, 0xfe, 0x41, 0xc6, 0x6c,
+	0x2c, 0xc6, 0x6a, 0x6c, 0xc6, 0x6e, 0x1c, 0xc6, 0x69, 0x5c, 0xe8, 0x23,
+	0x43, 0x47, 0x84, 0x44, 0x49, 0xa4, 0x44, 0x4b, 0xc4, 0x44, 0x4d, 0xe4,
+	0x44, 0x2f, 0x57, 0xb9, 0xca, 0x55, 0xae, 0x72, 0x95, 0xab, 0x5c, 0xe5,
+	0xea, 0xe7, 0xea, 0x05, 0xf2, 0x88, 0x2c, 0xec, 0xca, 0x08, 0x00, 0x00,
+};
+
+/* The NUM_BLOCK_LINES lines "block <i % 7>\n" in a stored block */
+static const uint8_t stored[] = {
+	0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x03, 0x01, 0x80,
+	0x00, 0x7f, 0xff, 0x62, 0x6c, 0x6f, 0x63, 0x6b, 0x20, 0x30, 0x0a, 0x62,
+	0x6c, 0x6f, 0x63, 0x6b, 0x20, 0x31, 0x0a, 0x62, 0x6c, 0x6f, 0x63, 0x6b,
+	0x20, 0x32, 0x0a, 0x62, 0x6c, 0x6f, 0x63, 0x6b, 0x20, 0x33, 0x0a, 0x62,
+	0x6c, 0x6f, 0x63, 0x6b, 0x20, 0x34, 0x0a, 0x62, 0x6c, 0x6f, 0x63, 0x6b,
+	0x20, 0x35, 0x0a, 0x62, 0x6c, 0x6f, 0x63, 0x6b, 0x20, 0x36, 0x0a, 0x62,
+	0x6c, 0x6f, 0x63, 0x6b, 0x20, 0x30, 0x0a, 0x62, 0x6c, 0x6f, 0x63, 0x6b,
+	0x20, 0x31, 0x0a, 0x62, 0x6c, 0x6f, 0x63, 0x6b, 0x20, 0x32, 0x0a, 0x62,
+	0x6c, 0x6f, 0x63, 0x6b, 0x20, 0x33, 0x0a, 0x62, 0x6c, 0x6f, 0x63, 0x6b,
+	0x20, 0x34, 0x0a, 0x62, 0x6c, 0x6f, 0x63, 0x6b, 0x20, 0x35, 0x0a, 0x62,
+	0x6c, 0x6f, 0x63, 0x6b, 0x20, 0x36, 0x0a, 0x62, 0x6c, 0x6f, 0x63, 0x6b,
+	0x20, 0x30, 0x0a, 0x62, 0x6c, 0x6f, 0x63, 0x6b, 0x20, 0x31, 0x0a, 0x1c,
+	0x25, 0x03, 0xe7, 0x80, 0x00, 0x00, 0x00,
+};
+
+/* The same lines compressed with the fixed Huffman codes */
+static const uint8_t fixed[] = {
+	0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x4b, 0xca,
+	0xc9, 0x4f, 0xce, 0x56, 0x30, 0xe0, 0x4a, 0x02, 0xd3, 0x86, 0x50, 0xda,
+	0x08, 0x4a, 0x1b, 0x43, 0x69, 0x13, 0x28, 0x6d, 0x0a, 0xa5, 0xcd, 0xa0,
+	0x34, 0xe5, 0xfa, 0x00, 0x1c, 0x25, 0x03, 0xe7, 0x80, 0x00, 0x00, 0x00,
+};
+
+struct inflate_test {
+	const uint8_t *in;
+	size_t in_len;
+	size_t chunk;
+	uint8_t out[4096];
+	size_t out_len;
+	uint8_t window[WINDOW];
+	struct esphome_inflate inflate;
+};
+
+static struct inflate_test test;
+
+static int fill(void *user_data, const uint8_t **data, size_t *len)
+{
+	struct inflate_test *t = user_data;
+
+	*len = MIN(t->chunk, t->in_len);
+	*data = t->in;
+	t->in += *len;
+	t->in_len -= *len;
+
+	return 0;
+}
+
+static int flush(void *user_data, const uint8_t *data, size_t len)
+{
+	struct inflate_test *t = user_data;
+
+	zassert_true(t->out_len + len <= sizeof(t->out));
+	memcpy(&t->out[t->out_len], data, len);
+	t->out_len += len;
+
+	return 0;
+}
+
+static ssize_t inflate(const uint8_t *in, size_t len, size_t chunk, size_t window_size)
+{
+	memset(&test, 0, sizeof(test));
+	test.in = in;
+	test.in_len = len;
+	test.chunk = chunk;
+	test.inflate.fill = fill;
+	test.inflate.flush = flush;
+	test.inflate.user_data = &test;
+	test.inflate.window = test.window;
+	test.inflate.window_size = window_size;
+
+	return esphome_inflate_gzip(&test.inflate);
+}
+
+ZTEST_SUITE(esphome_ota_inflate_tests, NULL, NULL, NULL, NULL, NULL);
+
+ZTEST(esphome_ota_inflate_tests, test_esphome_ota_inflate)
+{
+	static const size_t chunks[] = {1, 7, sizeof(compressed)};
+	char expected[16];
+	size_t offset = 0;
+	ssize_t ret;
+	int len;
+
+	for (int i = 0; i < ARRAY_SIZE(chunks); i++) {
+		ret = inflate(compressed, sizeof(compressed), chunks[i], WINDOW);
+		zassert_equal(ret, test.out_len, "chunks of %zu: %zd", chunks[i], ret);
+	}
+
+	/* The window wrapped several times */
+	zassert_true(test.out_len > 4 * WINDOW);
+
+	for (int i = 0; i < NUM_LINES; i++) {
+		len = snprintf(expected, sizeof(expected), "line %d\n", i % 20);
+		zassert_mem_equal(&test.out[offset], expected, len, "line %d", i);
+		offset += len;
+	}
+	zassert_equal(offset, test.out_len);
+}
+
+ZTEST(esphome_ota_inflate_tests, test_esphome_ota_inflate_block_types)
+{
+	static const struct {
+		const uint8_t *data;
+		size_t len;
+	} streams[] = {
+		{stored, sizeof(stored)},
+		{fixed, sizeof(fixed)},
+	};
+	char expected[16 * NUM_BLOCK_LINES];
+	size_t len = 0;
+	ssize_t ret;
+
+	for (int i = 0; i < NUM_BLOCK_LINES; i++) {
+		len += snprintf(&expected[len], sizeof(expected) - len, "block %d\n", i % 7);
+	}
+
+	for (int i = 0; i < ARRAY_SIZE(streams); i++) {
+		ret = inflate(streams[i].data, streams[i].len, 3, WINDOW);
+		zassert_equal(ret, len, "stream %d: %zd", i, ret);
+		zassert_mem_equal(test.out, expected, len, "stream %d", i);
+	}
+}
+
+ZTEST(esphome_ota_inflate_tests, test_esphome_ota_inflate_errors)
+{
+	uint8_t corrupted[sizeof(compressed)];
+
+	/* Truncated */
+	zassert_equal(inflate(compressed, sizeof(compressed) - 1, 16, WINDOW), -EBADMSG);
+
+	/* Referencing further back than the window */
+	zassert_equal(inflate(compressed, sizeof(compressed), 16, 64), -EBADMSG);
+
+	/* Wrong CRC */
+	memcpy(corrupted, compressed, sizeof(compressed));
+	corrupted[sizeof(corrupted) - 8] ^= 0xff;
+	zassert_equal(inflate(corrupted, sizeof(corrupted), 16, WINDOW), -EBADMSG);
+
+	/* Not gzip */
+	corrupted[0] = 0;
+	zassert_equal(inflate(corrupted, sizeof(corrupted), 16, WINDOW), -EBADMSG);
+}
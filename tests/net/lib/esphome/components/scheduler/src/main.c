@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/ztest.h>
+
+#include <esphome/esphome.h>
+#include <esphome/scheduler.h>
+
+#define INTERVAL_MS 20
+
+static const char test_component[] = "test";
+
+static atomic_t calls;
+static int order[4];
+static atomic_t order_len;
+
+static void count_cb(void *user_data)
+{
+	ARG_UNUSED(user_data);
+
+	atomic_inc(&calls);
+}
+
+static void order_cb(void *user_data)
+{
+	order[atomic_inc(&order_len)] = POINTER_TO_INT(user_data);
+}
+
+static void self_cancel_cb(void *user_data)
+{
+	ARG_UNUSED(user_data);
+
+	if (atomic_inc(&calls) == 2) {
+		esphome_cancel_interval(test_component, "self");
+	}
+}
+
+static void scheduler_before(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	atomic_clear(&calls);
+	atomic_clear(&order_len);
+}
+
+ZTEST_SUITE(esphome_scheduler_tests, NULL, NULL, scheduler_before, NULL, NULL);
+
+ZTEST(esphome_scheduler_tests, test_esphome_scheduler_interval)
+{
+	zassert_ok(esphome_set_interval(test_component, "interval", INTERVAL_MS, count_cb, NULL));
+
+	k_sleep(K_MSEC(5 * INTERVAL_MS + INTERVAL_MS / 2));
+	zassert_true(esphome_cancel_interval(test_component, "interval"));
+	zassert_equal(atomic_get(&calls), 5);
+
+	/* Nothing runs once cancelled */
+	k_sleep(K_MSEC(2 * INTERVAL_MS));
+	zassert_equal(atomic_get(&calls), 5);
+	zassert_false(esphome_cancel_interval(test_component, "interval"));
+}
+
+ZTEST(esphome_scheduler_tests, test_esphome_scheduler_timeout)
+{
+	zassert_ok(esphome_set_timeout(test_component, "timeout", INTERVAL_MS, count_cb, NULL));
+
+	k_sleep(K_MSEC(INTERVAL_MS / 2));
+	zassert_equal(atomic_get(&calls), 0);
+
+	k_sleep(K_MSEC(2 * INTERVAL_MS));
+	zassert_equal(atomic_get(&calls), 1);
+
+	/* A timeout that has run can't be cancelled */
+	zassert_false(esphome_cancel_timeout(test_component, "timeout"));
+}
+
+ZTEST(esphome_scheduler_tests, test_esphome_scheduler_order)
+{
+	/* Registered out of order, run by deadline */
+	zassert_ok(esphome_set_timeout(test_component, "c", 3 * INTERVAL_MS, order_cb,
+				       INT_TO_POINTER(3)));
+	zassert_ok(esphome_set_timeout(test_component, "a", INTERVAL_MS, order_cb,
+				       INT_TO_POINTER(1)));
+	zassert_ok(esphome_set_timeout(test_component, "d", 4 * INTERVAL_MS, order_cb,
+				       INT_TO_POINTER(4)));
+	zassert_ok(esphome_set_timeout(test_component, "b", 2 * INTERVAL_MS, order_cb,
+				       INT_TO_POINTER(2)));
+
+	k_sleep(K_MSEC(5 * INTERVAL_MS));
+
+	zassert_equal(atomic_get(&order_len), 4);
+	for (int i = 0; i < 4; i++) {
+		zassert_equal(order[i], i + 1);
+	}
+}
+
+ZTEST(esphome_scheduler_tests, test_esphome_scheduler_replace)
+{
+	/* Same component and name, the second timeout replaces the first one */
+	zassert_ok(esphome_set_timeout(test_component, "replace", INTERVAL_MS, count_cb, NULL));
+	zassert_ok(esphome_set_timeout(test_component, "replace", 3 * INTERVAL_MS, count_cb,
+				       NULL));
+
+	k_sleep(K_MSEC(2 * INTERVAL_MS));
+	zassert_equal(atomic_get(&calls), 0);
+
+	k_sleep(K_MSEC(2 * INTERVAL_MS));
+	zassert_equal(atomic_get(&calls), 1);
+
+	/* A different component doesn't collide */
+	zassert_ok(esphome_set_timeout(test_component, "key", INTERVAL_MS, count_cb, NULL));
+	zassert_ok(esphome_set_timeout(&calls, "key", INTERVAL_MS, count_cb, NULL));
+	k_sleep(K_MSEC(2 * INTERVAL_MS));
+	zassert_equal(atomic_get(&calls), 3);
+}
+
+ZTEST(esphome_scheduler_tests, test_esphome_scheduler_cancel_from_callback)
+{
+	zassert_ok(esphome_set_interval(test_component, "self", INTERVAL_MS, self_cancel_cb,
+					NULL));
+
+	k_sleep(K_MSEC(6 * INTERVAL_MS));
+	zassert_equal(atomic_get(&calls), 3);
+}
+
+ZTEST(esphome_scheduler_tests, test_esphome_scheduler_full)
+{
+	static const char *const names[] = {"0", "1", "2", "3", "4", "5", "6", "7"};
+	int ret = 0;
+	int i;
+
+	/* Once booted, the on_loop interval of esphome.c holds one of the timers */
+	k_sleep(K_MSEC(1));
+	for (i = 0; i < ARRAY_SIZE(names) && !ret; i++) {
+		ret = esphome_set_timeout(test_component, names[i], 10 * INTERVAL_MS, count_cb,
+					  NULL);
+	}
+	zassert_equal(ret, -ENOMEM);
+	zassert_equal(i, CONFIG_ESPHOME_SCHEDULER_MAX_TIMERS);
+
+	for (i = 0; i < ARRAY_SIZE(names); i++) {
+		esphome_cancel_timeout(test_component, names[i]);
+	}
+	zassert_equal(atomic_get(&calls), 0);
+}
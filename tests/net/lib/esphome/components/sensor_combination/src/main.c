@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/ztest.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/sensor/sensor_waveform.h>
+
+#include <esphome/esphome.h>
+#include <esphome/components/sensor.h>
+
+#define NUM_SOURCES 3
+#define NUM_UPDATES 300
+
+struct esphome_sensor_combination_tests_fixture {
+	const struct device *emuls[NUM_SOURCES];
+	const struct device *sources[NUM_SOURCES];
+	const struct device *min;
+	const struct device *max;
+	const struct device *mean;
+	const struct device *range;
+	const struct device *sum;
+};
+
+static void *sensor_combination_setup(void)
+{
+	static struct esphome_sensor_combination_tests_fixture fixture = {
+		.emuls = {
+			DEVICE_DT_GET(DT_NODELABEL(emul0)),
+			DEVICE_DT_GET(DT_NODELABEL(emul1)),
+			DEVICE_DT_GET(DT_NODELABEL(emul2)),
+		},
+		.sources = {
+			DEVICE_DT_GET(DT_NODELABEL(temp0)),
+			DEVICE_DT_GET(DT_NODELABEL(temp1)),
+			DEVICE_DT_GET(DT_NODELABEL(temp2)),
+		},
+		.min = DEVICE_DT_GET(DT_NODELABEL(comb_min)),
+		.max = DEVICE_DT_GET(DT_NODELABEL(comb_max)),
+		.mean = DEVICE_DT_GET(DT_NODELABEL(comb_mean)),
+		.range = DEVICE_DT_GET(DT_NODELABEL(comb_range)),
+		.sum = DEVICE_DT_GET(DT_NODELABEL(comb_sum)),
+	};
+	return &fixture;
+}
+
+ZTEST_SUITE(esphome_sensor_combination_tests, NULL, sensor_combination_setup, NULL, NULL, NULL);
+
+static void check_aggregates(struct esphome_sensor_combination_tests_fixture *fixture)
+{
+	int64_t min = INT64_MAX;
+	int64_t max = INT64_MIN;
+	int64_t sum = 0;
+	int64_t state;
+
+	for (int i = 0; i < NUM_SOURCES; i++) {
+		struct esphome_sensor_data *data = fixture->sources[i]->data;
+
+		min = MIN(min, data->state);
+		max = MAX(max, data->state);
+		sum += data->state;
+	}
+
+	zassert_ok(esphome_sensor_read_micro(fixture->min, &state));
+	zassert_equal(state, min);
+	zassert_ok(esphome_sensor_read_micro(fixture->max, &state));
+	zassert_equal(state, max);
+	zassert_ok(esphome_sensor_read_micro(fixture->mean, &state));
+	zassert_equal(state, sum / NUM_SOURCES);
+	zassert_ok(esphome_sensor_read_micro(fixture->range, &state));
+	zassert_equal(state, max - min);
+	zassert_ok(esphome_sensor_read_micro(fixture->sum, &state));
+	zassert_equal(state, sum);
+}
+
+ZTEST_F(esphome_sensor_combination_tests, test_esphome_sensor_combination_incremental)
+{
+	uint32_t fetch_count[NUM_SOURCES];
+	int64_t state;
+
+	for (int i = 0; i < NUM_SOURCES; i++) {
+		zassert_ok(esphome_sensor_update(fixture->sources[i], &state));
+	}
+	check_aggregates(fixture);
+
+	for (int i = 0; i < NUM_SOURCES; i++) {
+		fetch_count[i] = sensor_waveform_get_fetch_count(fixture->emuls[i]);
+	}
+
+	/* Update the sources one at a time, in an irregular order */
+	for (int i = 0; i < NUM_UPDATES; i++) {
+		zassert_ok(esphome_sensor_update(fixture->sources[(i * 7 / 3) % NUM_SOURCES],
+						 &state));
+		check_aggregates(fixture);
+		k_sleep(K_MSEC(1));
+	}
+
+	/* Reading the aggregates never reads the sources */
+	for (int i = 0; i < NUM_SOURCES; i++) {
+		fetch_count[i] = sensor_waveform_get_fetch_count(fixture->emuls[i]) -
+				 fetch_count[i];
+	}
+	zassert_equal(fetch_count[0] + fetch_count[1] + fetch_count[2], NUM_UPDATES);
+}
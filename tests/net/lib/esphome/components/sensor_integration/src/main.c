@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/ztest.h>
+#include <zephyr/device.h>
+#include <zephyr/settings/settings.h>
+
+#include <esphome/esphome.h>
+#include <esphome/components/sensor.h>
+
+#define POWER      2000000
+#define PERIOD_MS  100
+#define NUM_PERIOD 10
+/* A sleep may last an extra tick, i.e. an extra ms on native_sim */
+#define TOLERANCE  (POWER * NUM_PERIOD / MSEC_PER_SEC)
+
+#define MSEC_PER_DAY (24 * 60 * 60 * MSEC_PER_SEC)
+
+#ifdef CONFIG_ESPHOME_SENSOR_INTEGRATION_SETTINGS
+/* Saved before the first update, the left and daily totals start from it */
+#define RESTORED    5000000
+/* The daily total was saved that long before the end of its day */
+#define DAY_LEFT_MS (5 * MSEC_PER_SEC)
+#define SAVE_MS     (CONFIG_ESPHOME_SENSOR_INTEGRATION_SAVE_INTERVAL * MSEC_PER_SEC)
+
+/* Layout of the persisted total with ESPHOME_SENSOR_FIXED_POINT */
+struct integration_total {
+	int64_t total;
+	int64_t remainder;
+	uint32_t day_elapsed;
+};
+
+static int saved_set(const char *key, size_t len, settings_read_cb read_cb, void *cb_arg,
+		     void *param)
+{
+	ssize_t ret;
+
+	zassert_equal(len, sizeof(struct integration_total));
+	ret = read_cb(cb_arg, param, len);
+
+	return ret < 0 ? ret : 0;
+}
+
+static void load_saved(const struct device *dev, struct integration_total *saved)
+{
+	char key[64];
+
+	snprintk(key, sizeof(key), "esphome/sensor/integration/%s", dev->name);
+	zassert_ok(settings_load_subtree_direct(key, saved_set, saved));
+}
+
+static int64_t saved_total(const struct device *dev)
+{
+	struct integration_total saved = {0};
+
+	load_saved(dev, &saved);
+
+	return saved.total;
+}
+#else
+#define RESTORED    0
+/* The day started at boot */
+#define DAY_LEFT_MS MSEC_PER_DAY
+#endif
+
+/* Uptime the day of the daily total ends at */
+static int64_t day_end;
+
+struct esphome_sensor_integration_tests_fixture {
+	const struct device *power;
+	const struct device *integrations[4];
+};
+
+static void *sensor_integration_setup(void)
+{
+	static struct esphome_sensor_integration_tests_fixture fixture = {
+		.power = DEVICE_DT_GET(DT_NODELABEL(power)),
+		.integrations = {
+			DEVICE_DT_GET(DT_NODELABEL(trapezoid)),
+			DEVICE_DT_GET(DT_NODELABEL(left)),
+			DEVICE_DT_GET(DT_NODELABEL(right)),
+			DEVICE_DT_GET(DT_NODELABEL(daily)),
+		},
+	};
+
+#ifdef CONFIG_ESPHOME_SENSOR_INTEGRATION_SETTINGS
+	struct integration_total restored = {.total = RESTORED};
+	struct integration_total restored_daily = {
+		.total = RESTORED,
+		.day_elapsed = MSEC_PER_DAY - DAY_LEFT_MS,
+	};
+
+	/* Saved before the reset, loaded by the first update */
+	zassert_ok(settings_subsys_init());
+	zassert_ok(settings_save_one("esphome/sensor/integration/integration_left", &restored,
+				     sizeof(restored)));
+	zassert_ok(settings_save_one("esphome/sensor/integration/total_daily", &restored_daily,
+				     sizeof(restored_daily)));
+#endif
+
+	return &fixture;
+}
+
+ZTEST_SUITE(esphome_sensor_integration_tests, NULL, sensor_integration_setup, NULL, NULL, NULL);
+
+ZTEST_F(esphome_sensor_integration_tests, test_esphome_sensor_integration_constant)
+{
+	int64_t expected = POWER * NUM_PERIOD * PERIOD_MS / MSEC_PER_SEC;
+	int64_t restored[] = {0, RESTORED, 0, RESTORED};
+	int64_t state;
+
+	/* The first update loads the totals, the restored day goes on from there */
+	day_end = IS_ENABLED(CONFIG_ESPHOME_SENSOR_INTEGRATION_SETTINGS) ?
+			  k_uptime_get() + DAY_LEFT_MS : MSEC_PER_DAY;
+	zassert_ok(esphome_sensor_update(fixture->power, &state));
+	for (int i = 0; i < NUM_PERIOD; i++) {
+		k_sleep(K_MSEC(PERIOD_MS));
+		zassert_ok(esphome_sensor_update(fixture->power, &state));
+	}
+
+	for (int i = 0; i < ARRAY_SIZE(fixture->integrations); i++) {
+		zassert_ok(esphome_sensor_read_micro(fixture->integrations[i], &state));
+		zassert_within(state, expected + restored[i], TOLERANCE, "%s: %lld",
+			       fixture->integrations[i]->name, state);
+	}
+}
+
+/* Runs after test_esphome_sensor_integration_constant, the totals are loaded */
+ZTEST_F(esphome_sensor_integration_tests, test_esphome_sensor_integration_daily_reset)
+{
+	const struct device *trapezoid = fixture->integrations[0];
+	const struct device *daily = fixture->integrations[3];
+	/* The previous test ended with an update */
+	int64_t last_update = k_uptime_get();
+	int64_t before;
+	int64_t state;
+
+	zassert_ok(esphome_sensor_read_micro(trapezoid, &before));
+
+	/* Cross the end of the day, this doesn't wait in real time on native_sim */
+	k_sleep(K_MSEC(day_end - k_uptime_get() + NUM_PERIOD * PERIOD_MS));
+	zassert_ok(esphome_sensor_update(fixture->power, &state));
+
+	/* Only the time after the rollover counts for the new day */
+	zassert_ok(esphome_sensor_read_micro(daily, &state));
+	zassert_within(state, POWER * (k_uptime_get() - day_end) / MSEC_PER_SEC, TOLERANCE,
+		       "%s: %lld", daily->name, state);
+
+	/* The other totals go on */
+	zassert_ok(esphome_sensor_read_micro(trapezoid, &state));
+	zassert_within(state - before, POWER * (k_uptime_get() - last_update) / MSEC_PER_SEC,
+		       TOLERANCE, "%s: %lld", trapezoid->name, state);
+}
+
+/* Runs after test_esphome_sensor_integration_daily_reset */
+ZTEST_F(esphome_sensor_integration_tests, test_esphome_sensor_integration_save)
+{
+#ifdef CONFIG_ESPHOME_SENSOR_INTEGRATION_SETTINGS
+	const struct device *trapezoid = fixture->integrations[0];
+	struct integration_total saved = {0};
+	int64_t previous;
+	int64_t total;
+	int64_t state;
+
+	/* Let the save scheduled by the previous test run */
+	k_sleep(K_MSEC(SAVE_MS + PERIOD_MS));
+	previous = saved_total(trapezoid);
+	zassert_ok(esphome_sensor_read_micro(trapezoid, &total));
+	zassert_equal(previous, total);
+
+	/* The first update schedules the save, the next ones don't postpone it */
+	zassert_ok(esphome_sensor_update(fixture->power, &state));
+	k_sleep(K_MSEC(SAVE_MS / 2));
+	zassert_ok(esphome_sensor_update(fixture->power, &state));
+	zassert_ok(esphome_sensor_read_micro(trapezoid, &total));
+	zassert_true(total > previous);
+	zassert_equal(saved_total(trapezoid), previous, "Saved before the interval");
+
+	k_sleep(K_MSEC(SAVE_MS / 2 + PERIOD_MS));
+	zassert_equal(saved_total(trapezoid), total, "Not saved after the interval");
+
+	/* The time elapsed in the day is saved, a reset doesn't restart it */
+	load_saved(fixture->integrations[3], &saved);
+	zassert_within(saved.day_elapsed, k_uptime_get() - day_end, SAVE_MS,
+		       "%u ms elapsed", saved.day_elapsed);
+#else
+	ztest_test_skip();
+#endif
+}
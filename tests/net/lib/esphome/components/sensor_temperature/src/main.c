@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/ztest.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/sensor/sensor_waveform.h>
+
+#include <esphome/esphome.h>
+#include <esphome/components/sensor.h>
+
+#define EMUL_NODE DT_NODELABEL(emul)
+
+#define BENCH_ITERATIONS 1000
+
+struct esphome_sensor_temperature_tests_fixture {
+	const struct device *emul;
+	const struct device *dev;
+};
+
+static void *sensor_temperature_setup(void)
+{
+	static struct esphome_sensor_temperature_tests_fixture fixture = {
+		.emul = DEVICE_DT_GET(EMUL_NODE),
+		.dev = DEVICE_DT_GET(DT_PATH(temperature)),
+	};
+	return &fixture;
+}
+
+static void sensor_temperature_before(void *f)
+{
+	struct esphome_sensor_temperature_tests_fixture *fixture = f;
+
+	sensor_waveform_reset(fixture->emul);
+}
+
+ZTEST_SUITE(esphome_sensor_temperature_tests, NULL, sensor_temperature_setup,
+	    sensor_temperature_before, NULL, NULL);
+
+ZTEST_F(esphome_sensor_temperature_tests, test_esphome_sensor_waveform_ramp)
+{
+	int64_t offset = DT_PROP(EMUL_NODE, offset);
+	int64_t amplitude = DT_PROP(EMUL_NODE, amplitude);
+	uint32_t samples = DT_PROP(EMUL_NODE, sample_rate) * DT_PROP(EMUL_NODE, period_ms) /
+			   MSEC_PER_SEC;
+
+	zassert_equal(sensor_waveform_value(fixture->emul, 0), offset);
+	zassert_equal(sensor_waveform_value(fixture->emul, samples / 2), offset + amplitude / 2);
+	/* The ramp restarts at every period */
+	zassert_equal(sensor_waveform_value(fixture->emul, samples), offset);
+}
+
+ZTEST_F(esphome_sensor_temperature_tests, test_esphome_sensor_temperature_read)
+{
+	uint32_t count;
+	int64_t state;
+	int ret;
+
+	k_sleep(K_MSEC(250));
+
+	count = sensor_waveform_get_fetch_count(fixture->emul);
+	ret = esphome_sensor_read_micro(fixture->dev, &state);
+	zassert_equal(ret, 0);
+	zassert_equal(sensor_waveform_get_fetch_count(fixture->emul), count + 1);
+	zassert_equal(state, sensor_waveform_value(fixture->emul,
+						   sensor_waveform_get_sample(fixture->emul)));
+}
+
+ZTEST_F(esphome_sensor_temperature_tests, test_esphome_sensor_temperature_data_ready)
+{
+	struct esphome_sensor_data *data = fixture->dev->data;
+
+	data->data_rdy = false;
+	k_sleep(K_MSEC(2 * MSEC_PER_SEC / DT_PROP(EMUL_NODE, sample_rate)));
+	zassert_true(data->data_rdy);
+}
+
+ZTEST_F(esphome_sensor_temperature_tests, test_esphome_sensor_temperature_fetch_latency)
+{
+	uint32_t start;
+	uint32_t elapsed;
+	int64_t state;
+
+	start = k_cycle_get_32();
+	zassert_equal(esphome_sensor_read_micro(fixture->dev, &state), 0);
+	elapsed = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+
+	zassert_true(elapsed >= DT_PROP(EMUL_NODE, fetch_latency_us), "read took %u us",
+		     elapsed);
+}
+
+ZTEST_F(esphome_sensor_temperature_tests, test_esphome_sensor_temperature_benchmark)
+{
+	esphome_sensor_value_t state;
+	uint32_t start;
+	uint32_t elapsed;
+
+	start = k_cycle_get_32();
+	for (int i = 0; i < BENCH_ITERATIONS; i++) {
+		esphome_sensor_update(fixture->dev, &state);
+	}
+	elapsed = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+
+	TC_PRINT("sensor pipeline: %u us per sample (%u us emulated fetch latency)\n",
+		 elapsed / BENCH_ITERATIONS, DT_PROP(EMUL_NODE, fetch_latency_us));
+}
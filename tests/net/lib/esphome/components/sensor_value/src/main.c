@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/ztest.h>
+#include <zephyr/device.h>
+
+#include <esphome/esphome.h>
+#include <esphome/components/sensor.h>
+
+#define BENCH_ITERATIONS 1000
+/* Weight of the new sample in the moving average used as filter stage */
+#define BENCH_FILTER_SHIFT 3
+
+struct esphome_sensor_value_tests_fixture {
+	const struct device *dev;
+};
+
+static void *sensor_value_setup(void)
+{
+	static struct esphome_sensor_value_tests_fixture fixture = {
+		.dev = DEVICE_DT_GET(DT_PATH(timestamp)),
+	};
+	return &fixture;
+}
+
+ZTEST_SUITE(esphome_sensor_value_tests, NULL, sensor_value_setup, NULL, NULL, NULL);
+
+ZTEST_F(esphome_sensor_value_tests, test_esphome_sensor_read_paths_match)
+{
+	float state;
+	int64_t micro;
+	int ret;
+
+	ret = esphome_sensor_read(fixture->dev, &state);
+	zassert_equal(ret, 0);
+
+	ret = esphome_sensor_read_micro(fixture->dev, &micro);
+	zassert_equal(ret, 0);
+
+	/* Both reads are a few microseconds apart */
+	zassert_within((int64_t)(state * 1000000.0f), micro, 10000);
+}
+
+ZTEST_F(esphome_sensor_value_tests, test_esphome_sensor_update_stores_state)
+{
+	struct esphome_sensor_data *data = fixture->dev->data;
+	esphome_sensor_value_t state;
+	int ret;
+
+	ret = esphome_sensor_update(fixture->dev, &state);
+	zassert_equal(ret, 0);
+	zassert_true(data->has_state);
+	zassert_equal(data->state, state);
+}
+
+ZTEST_F(esphome_sensor_value_tests, test_esphome_sensor_benchmark_value_paths)
+{
+	volatile float float_result;
+	volatile int64_t micro_result;
+	uint32_t float_cycles;
+	uint32_t micro_cycles;
+	uint32_t start;
+	float float_filtered = 0;
+	int64_t micro_filtered = 0;
+
+	start = k_cycle_get_32();
+	for (int i = 0; i < BENCH_ITERATIONS; i++) {
+		float state;
+
+		esphome_sensor_read(fixture->dev, &state);
+		float_filtered += (state - float_filtered) / (1 << BENCH_FILTER_SHIFT);
+	}
+	float_result = float_filtered;
+	float_cycles = k_cycle_get_32() - start;
+
+	start = k_cycle_get_32();
+	for (int i = 0; i < BENCH_ITERATIONS; i++) {
+		int64_t state;
+
+		esphome_sensor_read_micro(fixture->dev, &state);
+		micro_filtered += (state - micro_filtered) >> BENCH_FILTER_SHIFT;
+	}
+	/* The micro-unit path only converts to float once, when encoding */
+	micro_result = (int64_t)((float)micro_filtered / 1000000.0f);
+	micro_cycles = k_cycle_get_32() - start;
+
+	ARG_UNUSED(float_result);
+	ARG_UNUSED(micro_result);
+
+	TC_PRINT("float path: %u cycles per sample\n", float_cycles / BENCH_ITERATIONS);
+	TC_PRINT("micro-unit path: %u cycles per sample\n", micro_cycles / BENCH_ITERATIONS);
+}
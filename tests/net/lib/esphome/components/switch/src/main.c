@@ -0,0 +1,371 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/ztest.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/gpio/gpio_fake.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/crc.h>
+
+#include <esphome/esphome.h>
+#include <esphome/components/switch.h>
+
+#include <zephyr/fff.h>
+DEFINE_FFF_GLOBALS;
+
+/* Pins of switch0, switch1 and switch3 on gpio_fake0 */
+#define PORT0_PINS (BIT(0) | BIT(3) | BIT(5))
+
+/* Pins of the interlocked switch4 and switch5 on gpio_fake1 */
+#define UP_PIN         BIT(4)
+#define DOWN_PIN       BIT(6)
+#define INTERLOCK_WAIT 50
+
+#ifdef CONFIG_ESPHOME_SWITCH_RESTORE
+#define SWITCH_SETTINGS_KEY "esphome/switch/state"
+#define SAVE_DELAY          CONFIG_ESPHOME_SWITCH_RESTORE_SAVE_DELAY
+
+/* Layout of the saved states */
+struct switch_record {
+	uint32_t key;
+	uint8_t state;
+} __packed;
+
+/* A settings backend in RAM, counting the writes */
+static struct switch_record stored[8];
+static size_t stored_len;
+static int saves;
+
+static uint32_t switch_key(const char *object_id)
+{
+	return crc32_ieee(object_id, strlen(object_id));
+}
+
+static ssize_t stored_read(void *cb_arg, void *data, size_t len)
+{
+	len = MIN(len, stored_len);
+	memcpy(data, stored, len);
+
+	return len;
+}
+
+static int stored_load(struct settings_store *cs, const struct settings_load_arg *arg)
+{
+	if (!stored_len) {
+		return 0;
+	}
+
+	return settings_call_set_handler(SWITCH_SETTINGS_KEY, stored_len, stored_read, NULL, arg);
+}
+
+static int stored_save(struct settings_store *cs, const char *name, const char *value,
+		       size_t val_len)
+{
+	zassert_str_equal(name, SWITCH_SETTINGS_KEY);
+	zassert_true(val_len <= sizeof(stored));
+
+	memcpy(stored, value, val_len);
+	stored_len = val_len;
+	saves++;
+
+	return 0;
+}
+
+static const struct settings_store_itf stored_itf = {
+	.csi_load = stored_load,
+	.csi_save = stored_save,
+};
+
+static struct settings_store stored_store = {
+	.cs_itf = &stored_itf,
+};
+
+/* Called by the first settings_subsys_init(), the restore at boot */
+int settings_backend_init(void)
+{
+	/* Saved before the reboot, along with a switch removed since then */
+	stored[0] = (struct switch_record){.key = switch_key("Restore_off"), .state = 1};
+	stored[1] = (struct switch_record){.key = 0xdeadbeef, .state = 1};
+	stored[2] = (struct switch_record){.key = switch_key("Restore_inverted"), .state = 0};
+	stored_len = 3 * sizeof(stored[0]);
+
+	settings_src_register(&stored_store);
+	settings_dst_register(&stored_store);
+
+	return 0;
+}
+
+static int stored_state(const char *object_id)
+{
+	for (size_t i = 0; i < stored_len / sizeof(stored[0]); i++) {
+		if (stored[i].key == switch_key(object_id)) {
+			return stored[i].state;
+		}
+	}
+
+	return -ENOENT;
+}
+#endif /* CONFIG_ESPHOME_SWITCH_RESTORE */
+
+struct esphome_switch_tests_fixture {
+	const struct device *port0;
+	const struct device *port1;
+	const struct device *devs[4];
+	const struct device *up;
+	const struct device *down;
+	const struct device *restore_off;
+	const struct device *restore_inverted;
+	const struct device *restore_on;
+};
+
+static void *switch_setup(void)
+{
+	static struct esphome_switch_tests_fixture fixture = {
+		.port0 = DEVICE_DT_GET(DT_NODELABEL(gpio_fake0)),
+		.port1 = DEVICE_DT_GET(DT_NODELABEL(gpio_fake1)),
+		.devs = {
+			DEVICE_DT_GET(DT_NODELABEL(switch0)),
+			DEVICE_DT_GET(DT_NODELABEL(switch1)),
+			DEVICE_DT_GET(DT_NODELABEL(switch2)),
+			DEVICE_DT_GET(DT_NODELABEL(switch3)),
+		},
+		.up = DEVICE_DT_GET(DT_NODELABEL(switch4)),
+		.down = DEVICE_DT_GET(DT_NODELABEL(switch5)),
+		.restore_off = DEVICE_DT_GET(DT_NODELABEL(restore_off)),
+		.restore_inverted = DEVICE_DT_GET(DT_NODELABEL(restore_inverted)),
+		.restore_on = DEVICE_DT_GET(DT_NODELABEL(restore_on)),
+	};
+	return &fixture;
+}
+
+ZTEST_SUITE(esphome_switch_tests, NULL, switch_setup, NULL, NULL, NULL);
+
+ZTEST_F(esphome_switch_tests, test_esphome_switch_restore_mode_boot)
+{
+	int state;
+
+	/* SWITCH_ALWAYS_OFF, the default */
+	zassert_equal(esphome_switch_get_state(fixture->devs[0], &state), 0);
+	zassert_equal(state, 0);
+
+	/* SWITCH_ALWAYS_ON */
+	zassert_equal(esphome_switch_get_state(fixture->devs[2], &state), 0);
+	zassert_equal(state, 1);
+
+	/* SWITCH_RESTORE_DISABLED, the switch is left untouched */
+	zassert_equal(esphome_switch_get_state(fixture->devs[3], &state), -EINVAL);
+
+	/* The saved states, or the defaults without the settings */
+	zassert_ok(esphome_switch_get_state(fixture->restore_off, &state));
+	zassert_equal(state, IS_ENABLED(CONFIG_ESPHOME_SWITCH_RESTORE));
+	zassert_ok(esphome_switch_get_state(fixture->restore_inverted, &state));
+	zassert_equal(state, IS_ENABLED(CONFIG_ESPHOME_SWITCH_RESTORE));
+
+	/* Nothing saved, the default */
+	zassert_ok(esphome_switch_get_state(fixture->restore_on, &state));
+	zassert_equal(state, 1);
+}
+
+ZTEST_F(esphome_switch_tests, test_esphome_switch_restore_save)
+{
+#ifdef CONFIG_ESPHOME_SWITCH_RESTORE
+	/* Let the save of the states restored at boot run */
+	k_sleep(K_MSEC(2 * SAVE_DELAY));
+	saves = 0;
+
+	/* A scene toggling the switches, several times */
+	for (int i = 0; i < 3; i++) {
+		zassert_ok(esphome_switch_toggle(fixture->restore_off));
+		zassert_ok(esphome_switch_toggle(fixture->restore_inverted));
+		zassert_ok(esphome_switch_toggle(fixture->restore_on));
+	}
+	k_sleep(K_MSEC(SAVE_DELAY / 2));
+	zassert_equal(saves, 0, "Saved before the delay");
+
+	/* All the changes are saved with a single write */
+	k_sleep(K_MSEC(SAVE_DELAY));
+	zassert_equal(saves, 1, "%d writes", saves);
+
+	/* The removed switch is dropped, the inverted one saves its actual state */
+	zassert_equal(stored_len, 3 * sizeof(stored[0]));
+	zassert_equal(stored_state("Restore_off"), 0);
+	zassert_equal(stored_state("Restore_inverted"), 0);
+	zassert_equal(stored_state("Restore_on"), 0);
+	zassert_equal(stored_state("Switch_0"), -ENOENT, "Not a RESTORE_* switch");
+
+	/* Back to the saved state, nothing to write */
+	zassert_ok(esphome_switch_toggle(fixture->restore_off));
+	zassert_ok(esphome_switch_toggle(fixture->restore_off));
+	k_sleep(K_MSEC(2 * SAVE_DELAY));
+	zassert_equal(saves, 1, "%d writes", saves);
+#else
+	ztest_test_skip();
+#endif
+}
+
+ZTEST_F(esphome_switch_tests, test_esphome_switch_set_states_by_port)
+{
+	const int states[] = {1, 0, 1, 1};
+	int state;
+	int ret;
+
+	ret = esphome_switch_set_states(fixture->devs, states, ARRAY_SIZE(states));
+	zassert_equal(ret, 0);
+
+	/* One call per port, and no call per pin */
+	zassert_equal(gpio_fake_port_set_masked_raw_fake.call_count, 2);
+	zassert_equal(gpio_fake_port_set_bits_raw_fake.call_count, 0);
+	zassert_equal(gpio_fake_port_clear_bits_raw_fake.call_count, 0);
+
+	/* switch3 is active low, so its pin is cleared to turn it on */
+	zassert_equal(gpio_fake_port_set_masked_raw_fake.arg0_history[0], fixture->port0);
+	zassert_equal(gpio_fake_port_set_masked_raw_fake.arg1_history[0], PORT0_PINS);
+	zassert_equal(gpio_fake_port_set_masked_raw_fake.arg2_history[0] & PORT0_PINS, BIT(0));
+
+	zassert_equal(gpio_fake_port_set_masked_raw_fake.arg0_history[1], fixture->port1);
+	zassert_equal(gpio_fake_port_set_masked_raw_fake.arg1_history[1], BIT(1));
+	zassert_equal(gpio_fake_port_set_masked_raw_fake.arg2_history[1] & BIT(1), BIT(1));
+
+	for (int i = 0; i < ARRAY_SIZE(states); i++) {
+		ret = esphome_switch_get_state(fixture->devs[i], &state);
+		zassert_equal(ret, 0);
+		zassert_equal(state, states[i]);
+	}
+}
+
+ZTEST_F(esphome_switch_tests, test_esphome_switch_set_states_last_wins)
+{
+	const struct device *devs[] = {fixture->devs[0], fixture->devs[0]};
+	const int states[] = {1, 0};
+	int state;
+	int ret;
+
+	ret = esphome_switch_set_states(devs, states, ARRAY_SIZE(states));
+	zassert_equal(ret, 0);
+
+	zassert_equal(gpio_fake_port_set_masked_raw_fake.call_count, 1);
+	zassert_equal(gpio_fake_port_set_masked_raw_fake.arg1_history[0], BIT(0));
+	zassert_equal(gpio_fake_port_set_masked_raw_fake.arg2_history[0] & BIT(0), 0);
+
+	ret = esphome_switch_get_state(fixture->devs[0], &state);
+	zassert_equal(ret, 0);
+	zassert_equal(state, 0);
+}
+
+ZTEST_F(esphome_switch_tests, test_esphome_switch_set_states_error)
+{
+	const int states[] = {1, 1};
+	int ret;
+
+	gpio_fake_port_set_masked_raw_fake.return_val = -EIO;
+
+	ret = esphome_switch_set_states(fixture->devs, states, ARRAY_SIZE(states));
+	zassert_equal(ret, -EIO);
+	zassert_equal(gpio_fake_port_set_masked_raw_fake.call_count, 1);
+}
+
+static int64_t down_on_time;
+static int64_t up_off_time;
+
+static int record_set_bits(const struct device *port, gpio_port_pins_t pins)
+{
+	if (pins & DOWN_PIN) {
+		down_on_time = k_uptime_get();
+	}
+	return 0;
+}
+
+static int record_clear_bits(const struct device *port, gpio_port_pins_t pins)
+{
+	if (pins & UP_PIN) {
+		up_off_time = k_uptime_get();
+	}
+	return 0;
+}
+
+static void interlock_reset(struct esphome_switch_tests_fixture *fixture)
+{
+	zassert_ok(esphome_switch_turn_off(fixture->up));
+	zassert_ok(esphome_switch_turn_off(fixture->down));
+
+	down_on_time = 0;
+	up_off_time = 0;
+	gpio_fake_port_set_bits_raw_fake.custom_fake = record_set_bits;
+	gpio_fake_port_clear_bits_raw_fake.custom_fake = record_clear_bits;
+}
+
+ZTEST_F(esphome_switch_tests, test_esphome_switch_interlock_wait)
+{
+	int state;
+
+	interlock_reset(fixture);
+
+	/* Nothing else is on in the group, so the switch turns on right away */
+	zassert_ok(esphome_switch_turn_on(fixture->up));
+	zassert_ok(esphome_switch_get_state(fixture->up, &state));
+	zassert_equal(state, 1);
+
+	/* The up switch is turned off at once, down only after the wait time */
+	zassert_ok(esphome_switch_turn_on(fixture->down));
+	zassert_ok(esphome_switch_get_state(fixture->up, &state));
+	zassert_equal(state, 0);
+	zassert_ok(esphome_switch_get_state(fixture->down, &state));
+	zassert_equal(state, 0);
+	zassert_not_equal(up_off_time, 0);
+	zassert_equal(down_on_time, 0);
+
+	k_sleep(K_MSEC(2 * INTERLOCK_WAIT));
+
+	zassert_ok(esphome_switch_get_state(fixture->down, &state));
+	zassert_equal(state, 1);
+	zassert_ok(esphome_switch_get_state(fixture->up, &state));
+	zassert_equal(state, 0);
+	zassert_true(down_on_time - up_off_time >= INTERLOCK_WAIT, "waited %lld ms",
+		     down_on_time - up_off_time);
+}
+
+ZTEST_F(esphome_switch_tests, test_esphome_switch_interlock_cancel)
+{
+	int state;
+
+	interlock_reset(fixture);
+
+	zassert_ok(esphome_switch_turn_on(fixture->up));
+	zassert_ok(esphome_switch_turn_on(fixture->down));
+
+	/* Turning it off during the wait cancels the pending turn on */
+	zassert_ok(esphome_switch_turn_off(fixture->down));
+	k_sleep(K_MSEC(2 * INTERLOCK_WAIT));
+
+	zassert_equal(down_on_time, 0);
+	zassert_ok(esphome_switch_get_state(fixture->up, &state));
+	zassert_equal(state, 0);
+	zassert_ok(esphome_switch_get_state(fixture->down, &state));
+	zassert_equal(state, 0);
+}
+
+ZTEST_F(esphome_switch_tests, test_esphome_switch_interlock_set_states)
+{
+	const struct device *devs[] = {fixture->up, fixture->down};
+	const int states[] = {1, 1};
+	int state;
+
+	interlock_reset(fixture);
+
+	/* The interlocked switches are not set together, even on the same port */
+	zassert_ok(esphome_switch_set_states(devs, states, ARRAY_SIZE(states)));
+	zassert_equal(gpio_fake_port_set_masked_raw_fake.call_count, 0);
+
+	k_sleep(K_MSEC(2 * INTERLOCK_WAIT));
+
+	zassert_ok(esphome_switch_get_state(fixture->up, &state));
+	zassert_equal(state, 0);
+	zassert_ok(esphome_switch_get_state(fixture->down, &state));
+	zassert_equal(state, 1);
+}
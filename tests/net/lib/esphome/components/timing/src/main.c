@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/ztest.h>
+#include <zephyr/kernel.h>
+
+#include <esphome/timing.h>
+
+/* Above CONFIG_ESPHOME_TIMING_WARN_THRESHOLD */
+#define SLOW_US 30000
+#define FAST_US 1000
+
+static const char slow_component[] = "slow";
+static const char fast_component[] = "fast";
+
+ZTEST_SUITE(esphome_timing_tests, NULL, NULL, NULL, NULL, NULL);
+
+static void run(const char *component, uint32_t us)
+{
+	uint32_t start = esphome_timing_start();
+
+	k_busy_wait(us);
+	esphome_timing_end(component, component, start);
+}
+
+ZTEST(esphome_timing_tests, test_esphome_timing_account)
+{
+	struct esphome_timing_stats stats;
+
+	zassert_equal(esphome_timing_get(slow_component, &stats), -ENOENT);
+
+	run(slow_component, SLOW_US);
+	run(fast_component, FAST_US);
+	run(fast_component, FAST_US);
+
+	zassert_ok(esphome_timing_get(slow_component, &stats));
+	zassert_equal(stats.name, slow_component);
+	zassert_equal(stats.count, 1);
+	zassert_true(stats.max_us >= SLOW_US, "max %u us", stats.max_us);
+	zassert_equal(stats.total_us, stats.max_us);
+
+	zassert_ok(esphome_timing_get(fast_component, &stats));
+	zassert_equal(stats.count, 2);
+	zassert_true(stats.max_us >= FAST_US && stats.max_us < SLOW_US, "max %u us",
+		     stats.max_us);
+	zassert_true(stats.total_us >= 2 * FAST_US);
+}
+
+static void count_components(const void *component, const struct esphome_timing_stats *stats,
+			     void *user_data)
+{
+	int *count = user_data;
+
+	(*count)++;
+}
+
+ZTEST(esphome_timing_tests, test_esphome_timing_full)
+{
+	static const char components[CONFIG_ESPHOME_TIMING_MAX_COMPONENTS + 1][2];
+	struct esphome_timing_stats stats;
+	int count = 0;
+
+	/* Runs after test_esphome_timing_account, the components that don't fit are dropped */
+	for (int i = 0; i < ARRAY_SIZE(components); i++) {
+		run(components[i], 0);
+	}
+
+	esphome_timing_foreach(count_components, &count);
+	zassert_equal(count, CONFIG_ESPHOME_TIMING_MAX_COMPONENTS);
+	zassert_equal(esphome_timing_get(components[CONFIG_ESPHOME_TIMING_MAX_COMPONENTS], &stats),
+		      -ENOENT);
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/ztest.h>
+#include <zephyr/device.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/sys/base64.h>
+
+#include <esphome/components/entity.h>
+#include <esphome/components/update.h>
+#include <esphome/scheduler.h>
+
+#define IMAGE_SIZE 6000
+#define IMAGE_MD5  "a15475d8a403f306ca70d614b892ef67"
+/* Well under half the heap, the message and its decoded arguments are both allocated */
+#define PIECE_SIZE 512
+
+static uint8_t image_byte(size_t i)
+{
+	return i * 7 + i / 256;
+}
+
+static int call_service(const struct device *api_dev, const char *name,
+			ExecuteServiceArgument **args, size_t n_args)
+{
+	ExecuteServiceRequest request = EXECUTE_SERVICE_REQUEST__INIT;
+
+	request.key = fnv1_hash(name);
+	request.n_args = n_args;
+	request.args = args;
+
+	return esphome_update_execute_service(api_dev, &request);
+}
+
+static int ota_begin(const struct device *api_dev, int32_t size, const char *md5)
+{
+	ExecuteServiceArgument size_arg = EXECUTE_SERVICE_ARGUMENT__INIT;
+	ExecuteServiceArgument md5_arg = EXECUTE_SERVICE_ARGUMENT__INIT;
+	ExecuteServiceArgument *args[] = {&size_arg, &md5_arg};
+
+	size_arg.int_ = size;
+	md5_arg.string_ = (char *)md5;
+
+	return call_service(api_dev, ESPHOME_UPDATE_SERVICE_BEGIN, args, ARRAY_SIZE(args));
+}
+
+static int ota_write(const struct device *api_dev, size_t offset, size_t len)
+{
+	ExecuteServiceArgument data_arg = EXECUTE_SERVICE_ARGUMENT__INIT;
+	ExecuteServiceArgument *args[] = {&data_arg};
+	char encoded[(PIECE_SIZE + 2) / 3 * 4 + 1];
+	uint8_t piece[PIECE_SIZE];
+	size_t encoded_len;
+
+	for (size_t i = 0; i < len; i++) {
+		piece[i] = image_byte(offset + i);
+	}
+	zassert_ok(base64_encode(encoded, sizeof(encoded), &encoded_len, piece, len));
+	data_arg.string_ = encoded;
+
+	return call_service(api_dev, ESPHOME_UPDATE_SERVICE_WRITE, args, ARRAY_SIZE(args));
+}
+
+static int ota_end(const struct device *api_dev)
+{
+	return call_service(api_dev, ESPHOME_UPDATE_SERVICE_END, NULL, 0);
+}
+
+struct esphome_update_tests_fixture {
+	const struct device *api0;
+	const struct device *api1;
+	const struct device *dev;
+	struct esphome_update_data *data;
+};
+
+static void *update_setup(void)
+{
+	static struct esphome_update_tests_fixture fixture = {
+		.api0 = DEVICE_DT_GET(DT_NODELABEL(esphome0)),
+		.api1 = DEVICE_DT_GET(DT_NODELABEL(esphome1)),
+		.dev = DEVICE_DT_GET(DT_NODELABEL(update)),
+	};
+
+	fixture.data = fixture.dev->data;
+
+	return &fixture;
+}
+
+static void update_after(void *f)
+{
+	struct esphome_update_tests_fixture *fixture = f;
+
+	/* Release the upload slot for the next test */
+	esphome_update_connection_closed(fixture->api0);
+	esphome_update_connection_closed(fixture->api1);
+}
+
+ZTEST_SUITE(esphome_update_tests, NULL, update_setup, NULL, update_after, NULL);
+
+ZTEST_F(esphome_update_tests, test_esphome_update_upload)
+{
+	const struct flash_area *fa;
+	uint8_t buf[256];
+	size_t len;
+
+	zassert_ok(ota_begin(fixture->api0, IMAGE_SIZE, IMAGE_MD5));
+	zassert_equal(fixture->data->api_dev, fixture->api0);
+	zassert_equal(fixture->data->size, IMAGE_SIZE);
+
+	for (size_t offset = 0; offset < IMAGE_SIZE; offset += len) {
+		len = MIN(PIECE_SIZE, IMAGE_SIZE - offset);
+		zassert_ok(ota_write(fixture->api0, offset, len));
+		zassert_within(fixture->data->progress, 100.0f * (offset + len) / IMAGE_SIZE,
+			       0.01f);
+	}
+
+	zassert_ok(ota_end(fixture->api0));
+	zassert_is_null(fixture->data->api_dev);
+
+	/* The device would reboot into the new image */
+	zassert_true(esphome_cancel_timeout(fixture->dev, "reboot"));
+
+	zassert_ok(flash_area_open(FIXED_PARTITION_ID(slot1_partition), &fa));
+	for (size_t offset = 0; offset < IMAGE_SIZE; offset += len) {
+		len = MIN(sizeof(buf), IMAGE_SIZE - offset);
+		zassert_ok(flash_area_read(fa, offset, buf, len));
+		for (size_t i = 0; i < len; i++) {
+			zassert_equal(buf[i], image_byte(offset + i), "at %zu", offset + i);
+		}
+	}
+	flash_area_close(fa);
+}
+
+ZTEST_F(esphome_update_tests, test_esphome_update_single_connection)
+{
+	zassert_ok(ota_begin(fixture->api0, IMAGE_SIZE, IMAGE_MD5));
+
+	/* The other connection can neither start another update nor continue this one */
+	zassert_equal(ota_begin(fixture->api1, IMAGE_SIZE, IMAGE_MD5), -EBUSY);
+	zassert_equal(ota_write(fixture->api1, 0, PIECE_SIZE), -EPERM);
+	zassert_equal(ota_end(fixture->api1), -EPERM);
+
+	/* Nor abort it by closing */
+	esphome_update_connection_closed(fixture->api1);
+	zassert_equal(fixture->data->api_dev, fixture->api0);
+
+	zassert_ok(ota_write(fixture->api0, 0, PIECE_SIZE));
+}
+
+ZTEST_F(esphome_update_tests, test_esphome_update_abort_on_close)
+{
+	zassert_ok(ota_begin(fixture->api0, IMAGE_SIZE, IMAGE_MD5));
+	zassert_ok(ota_write(fixture->api0, 0, PIECE_SIZE));
+
+	esphome_update_connection_closed(fixture->api0);
+	zassert_is_null(fixture->data->api_dev);
+	zassert_equal(fixture->data->progress, 0.0f);
+	zassert_equal(ota_write(fixture->api0, PIECE_SIZE, PIECE_SIZE), -EPERM);
+
+	/* The slot is free again, an update ended early is rejected */
+	zassert_ok(ota_begin(fixture->api1, IMAGE_SIZE, IMAGE_MD5));
+	zassert_ok(ota_write(fixture->api1, 0, PIECE_SIZE));
+	zassert_equal(ota_end(fixture->api1), -EMSGSIZE);
+	zassert_is_null(fixture->data->api_dev);
+	zassert_false(esphome_cancel_timeout(fixture->dev, "reboot"));
+}
+
+ZTEST_F(esphome_update_tests, test_esphome_update_bad_request)
+{
+	ExecuteServiceArgument size_arg = EXECUTE_SERVICE_ARGUMENT__INIT;
+	ExecuteServiceArgument *args[] = {&size_arg};
+
+	size_arg.int_ = IMAGE_SIZE;
+	zassert_equal(call_service(fixture->api0, ESPHOME_UPDATE_SERVICE_BEGIN, args, 1), -EINVAL);
+	zassert_equal(ota_begin(fixture->api0, 0, IMAGE_MD5), -EINVAL);
+	zassert_equal(call_service(fixture->api0, "unknown", NULL, 0), -ENOENT);
+	zassert_is_null(fixture->data->api_dev);
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2025 Alexandre Bailon
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/ztest.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/crc.h>
+
+#include "wifi_credentials.h"
+
+#define HOME   0
+#define OFFICE 1
+
+static struct wifi_credentials_ap saved[2];
+
+static uint32_t ssid_crc(const char *ssid)
+{
+	/* The length of the credentials includes the terminating null */
+	return crc32_ieee(ssid, strlen(ssid) + 1);
+}
+
+static int saved_set(const char *key, size_t len, settings_read_cb read_cb, void *cb_arg,
+		     void *param)
+{
+	ssize_t ret;
+
+	zassert_equal(len, sizeof(saved));
+	ret = read_cb(cb_arg, saved, len);
+
+	return ret < 0 ? ret : 0;
+}
+
+static void *wifi_credentials_setup(void)
+{
+	/* Home is cached, the Office entry was recorded for another network */
+	struct wifi_credentials_ap ap[2] = {
+		[HOME] = {.ssid_crc = ssid_crc("Home"), .channel = 6, .valid = true},
+		[OFFICE] = {.ssid_crc = ssid_crc("Old office"), .channel = 11, .valid = true},
+	};
+
+	/* Loaded by the first request */
+	zassert_ok(settings_subsys_init());
+	zassert_ok(settings_save_one(WIFI_CREDENTIALS_SETTINGS_KEY, ap, sizeof(ap)));
+
+	return NULL;
+}
+
+ZTEST_SUITE(esphome_wifi_credentials_tests, NULL, wifi_credentials_setup, NULL, NULL, NULL);
+
+static void expect_next(const char *ssid, int channel)
+{
+	struct wifi_connect_req_params params;
+
+	wifi_credentials_get_next(&params);
+	zassert_mem_equal(params.ssid, ssid, strlen(ssid) + 1);
+	zassert_equal(params.channel, channel, "%s on channel %d", ssid, params.channel);
+	zassert_equal(params.band, WIFI_FREQ_BAND_2_4_GHZ);
+}
+
+ZTEST(esphome_wifi_credentials_tests, test_esphome_wifi_credentials_rotation)
+{
+	/* Only the cached channel is scanned, then every channel for the same network */
+	expect_next("Home", 6);
+	zassert_true(wifi_credentials_failed());
+	expect_next("Home", WIFI_CHANNEL_ANY);
+	zassert_false(wifi_credentials_failed());
+
+	/* The entry doesn't match the SSID checksum, it is ignored */
+	expect_next("Office", WIFI_CHANNEL_ANY);
+	zassert_false(wifi_credentials_failed());
+
+	expect_next("Home", 6);
+	zassert_true(wifi_credentials_failed());
+}
+
+/* Runs after test_esphome_wifi_credentials_rotation, the Home fallback is pending */
+ZTEST(esphome_wifi_credentials_tests, test_esphome_wifi_credentials_save)
+{
+	struct wifi_iface_status status = {
+		.channel = 1,
+		.band = WIFI_FREQ_BAND_2_4_GHZ,
+	};
+
+	expect_next("Home", WIFI_CHANNEL_ANY);
+	zassert_false(wifi_credentials_failed());
+	expect_next("Office", WIFI_CHANNEL_ANY);
+	wifi_credentials_connected(&status);
+
+	/* The rotation restarts from the credential that worked, on its new channel */
+	expect_next("Office", 1);
+
+	/* Saved from the system work queue */
+	k_sleep(K_MSEC(100));
+	zassert_ok(settings_load_subtree_direct(WIFI_CREDENTIALS_SETTINGS_KEY, saved_set, NULL));
+	zassert_equal(saved[HOME].channel, 6);
+	zassert_equal(saved[OFFICE].ssid_crc, ssid_crc("Office"));
+	zassert_equal(saved[OFFICE].channel, 1);
+	zassert_true(saved[OFFICE].valid);
+}